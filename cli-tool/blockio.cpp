@@ -0,0 +1,290 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#include "blockio.hpp"
+
+#include <cassert>
+
+
+
+namespace {
+
+	/** The size of the first extent of every output of DeviceWriters. */
+	constexpr size_t FIRST_EXTENT_SIZE = 64 << 10;
+
+}
+
+
+
+namespace xorinator::runtime {
+
+	PrefetchingReader::PrefetchingReader(std::istream& src, size_t blockSize, unsigned depth):
+			src_(&src),
+			blockSize_(blockSize),
+			free_(std::max(1u, depth)),
+			done_(false),
+			stopping_(false)
+	{
+		if(depth > 0) {
+			thread_ = std::thread(&PrefetchingReader::readLoop_, this); }
+	}
+
+
+	PrefetchingReader::~PrefetchingReader() {
+		{
+			auto lock = std::lock_guard(mtx_);
+			stopping_ = true;
+		}
+		freeCv_.notify_all();
+		if(thread_.joinable()) {
+			thread_.join(); }
+	}
+
+
+	void PrefetchingReader::readLoop_() {
+		try {
+			bool eof = false;
+			while(! eof) {
+				Block block;
+				{
+					auto lock = std::unique_lock(mtx_);
+					freeCv_.wait(lock, [this]() { return stopping_ || ! free_.empty(); });
+					if(stopping_) return;
+					block = std::move(free_.back());
+					free_.pop_back();
+				}
+				block.resize(blockSize_);
+				src_->read(block.data(), block.size());
+				if(src_->bad()) {
+					throw std::ios_base::failure("could not read an input"); }
+				block.resize(src_->gcount());
+				eof = block.size() < blockSize_;
+				{
+					auto lock = std::lock_guard(mtx_);
+					ready_.push_back(std::move(block));
+					done_ = eof;
+				}
+				readyCv_.notify_one();
+			}
+		} catch(...) {
+			auto lock = std::lock_guard(mtx_);
+			error_ = std::current_exception();
+			done_ = true;
+			readyCv_.notify_one();
+		}
+	}
+
+
+	const std::vector<char>& PrefetchingReader::next() {
+		if(! thread_.joinable()) {
+			current_.clear();
+			if(! done_) {
+				current_.resize(blockSize_);
+				src_->read(current_.data(), current_.size());
+				if(src_->bad()) {
+					throw std::ios_base::failure("could not read an input"); }
+				current_.resize(src_->gcount());
+				done_ = current_.size() < blockSize_;
+			}
+			return current_;
+		}
+		auto lock = std::unique_lock(mtx_);
+		if(current_.capacity() > 0) {
+			free_.push_back(std::move(current_));
+			current_ = { };
+			freeCv_.notify_one();
+		}
+		readyCv_.wait(lock, [this]() { return done_ || ! ready_.empty(); });
+		if(ready_.empty()) {
+			if(error_) std::rethrow_exception(error_);
+			current_.clear();
+			return current_;
+		}
+		current_ = std::move(ready_.front());
+		ready_.pop_front();
+		return current_;
+	}
+
+
+
+	DeviceWriters::ExtentBuf::ExtentBuf(DeviceWriters& owner, size_t target, size_t extentSize):
+			owner_(&owner),
+			target_(target),
+			extentSize_(extentSize),
+			nextExtentSize_(std::min<size_t>(extentSize, FIRST_EXTENT_SIZE))
+	{ }
+
+
+	void DeviceWriters::ExtentBuf::submit_() {
+		if(pptr() > pbase()) {
+			extent_.resize(pptr() - pbase());
+			owner_->push_(target_, std::move(extent_));
+		}
+		extent_ = owner_->takeBuffer_(target_, nextExtentSize_);
+		nextExtentSize_ = std::min(nextExtentSize_ * 2, extentSize_);
+		setp(extent_.data(), extent_.data() + extent_.size());
+	}
+
+
+	DeviceWriters::ExtentBuf::int_type DeviceWriters::ExtentBuf::overflow(int_type c) {
+		submit_();
+		if(! traits_type::eq_int_type(c, traits_type::eof())) {
+			*pptr() = traits_type::to_char_type(c);
+			pbump(1);
+		}
+		return traits_type::not_eof(c);
+	}
+
+
+	int DeviceWriters::ExtentBuf::sync() {
+		if(pptr() > pbase())  submit_();
+		return 0;
+	}
+
+
+	std::streamsize DeviceWriters::ExtentBuf::xsputn(const char_type* src, std::streamsize n) {
+		std::streamsize done = 0;
+		while(done < n) {
+			if(pptr() == epptr())  submit_();
+			auto chunk = std::min<std::streamsize>(n - done, epptr() - pptr());
+			std::copy(src + done, src + done + chunk, pptr());
+			pbump(int(chunk));
+			done += chunk;
+		}
+		return done;
+	}
+
+
+	DeviceWriters::DeviceWriters(
+			std::vector<std::ostream*> targets, const std::vector<uint64_t>& deviceIds,
+			size_t soloExtent, size_t sharedExtent
+	):
+			targets_(std::move(targets)),
+			targetDevices_(targets_.size())
+	{
+		assert(deviceIds.size() == targets_.size());
+		std::vector<uint64_t> ids;
+		std::vector<size_t> shareCounts;
+		for(size_t i=0; i < targets_.size(); ++i) {
+			auto found = std::find(ids.begin(), ids.end(), deviceIds[i]);
+			targetDevices_[i] = found - ids.begin();
+			if(found == ids.end()) {
+				ids.push_back(deviceIds[i]);
+				shareCounts.push_back(0);
+			}
+			++ shareCounts[targetDevices_[i]];
+		}
+		for(size_t d=0; d < ids.size(); ++d) {
+			auto& device = devices_.emplace_back(std::make_unique<Device>());
+			device->maxQueued = 2 * shareCounts[d];
+			device->busy = false;
+			device->stopping = false;
+		}
+		for(size_t i=0; i < targets_.size(); ++i) {
+			bool shared = shareCounts[targetDevices_[i]] > 1;
+			bufs_.push_back(std::make_unique<ExtentBuf>(*this, i, shared? sharedExtent : soloExtent));
+			streams_.push_back(std::make_unique<std::ostream>(bufs_.back().get()));
+		}
+		for(auto& device : devices_) {
+			device->thread = std::thread(&DeviceWriters::writeLoop_, this, std::ref(*device)); }
+	}
+
+
+	DeviceWriters::~DeviceWriters() {
+		for(auto& device : devices_) {
+			{
+				auto lock = std::lock_guard(device->mtx);
+				device->stopping = true;
+			}
+			device->cv.notify_all();
+		}
+		for(auto& device : devices_) {
+			device->thread.join(); }
+	}
+
+
+	void DeviceWriters::writeLoop_(Device& device) {
+		auto lock = std::unique_lock(device.mtx);
+		while(true) {
+			device.cv.wait(lock, [&]() { return device.stopping || ! device.queue.empty(); });
+			if(device.queue.empty()) return;
+			auto extent = std::move(device.queue.front());
+			device.queue.pop_front();
+			device.busy = true;
+			device.cv.notify_all();
+			lock.unlock();
+			try {
+				targets_[extent.target]->write(extent.data.data(), extent.data.size());
+			} catch(...) {
+				auto errorLock = std::lock_guard(errorMtx_);
+				if(! error_) error_ = std::current_exception();
+			}
+			lock.lock();
+			device.free.push_back(std::move(extent.data));
+			device.busy = false;
+			device.cv.notify_all();
+		}
+	}
+
+
+	std::vector<char> DeviceWriters::takeBuffer_(size_t target, size_t size) {
+		auto& device = *devices_[targetDevices_[target]];
+		std::vector<char> r;
+		{
+			auto lock = std::lock_guard(device.mtx);
+			if(! device.free.empty()) {
+				r = std::move(device.free.back());
+				device.free.pop_back();
+			}
+		}
+		r.resize(size);
+		return r;
+	}
+
+
+	void DeviceWriters::push_(size_t target, std::vector<char> data) {
+		rethrow_();
+		auto& device = *devices_[targetDevices_[target]];
+		{
+			auto lock = std::unique_lock(device.mtx);
+			device.cv.wait(lock, [&]() { return device.queue.size() < device.maxQueued; });
+			device.queue.push_back({ target, std::move(data) });
+		}
+		device.cv.notify_all();
+	}
+
+
+	void DeviceWriters::rethrow_() {
+		auto lock = std::lock_guard(errorMtx_);
+		if(error_) std::rethrow_exception(error_);
+	}
+
+
+	void DeviceWriters::finish() {
+		for(auto& stream : streams_) {
+			stream->flush(); }
+		for(auto& device : devices_) {
+			auto lock = std::unique_lock(device->mtx);
+			device->cv.wait(lock, [&]() { return device->queue.empty() && ! device->busy; });
+		}
+		rethrow_();
+	}
+
+}
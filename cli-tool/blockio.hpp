@@ -0,0 +1,163 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <memory>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+
+
+
+namespace xorinator::runtime {
+
+	/** Reads a stream in fixed-size blocks on a dedicated thread, staying
+	 * up to `depth` blocks ahead of the consumer; when several streams are
+	 * read at once, they are read concurrently.
+	 * If `depth` is 0, no thread is started, and every block is read by
+	 * ::next: for inputs of a block or less, which are read as soon as
+	 * they are requested anyway, a thread costs more than it saves. */
+	class PrefetchingReader {
+	private:
+		using Block = std::vector<char>;
+
+		std::istream* src_;
+		size_t blockSize_;
+		std::mutex mtx_;
+		std::condition_variable readyCv_;
+		std::condition_variable freeCv_;
+		std::deque<Block> ready_;
+		std::vector<Block> free_;
+		Block current_;
+		std::exception_ptr error_;
+		bool done_;
+		bool stopping_;
+		std::thread thread_;
+
+		void readLoop_();
+
+	public:
+		PrefetchingReader(std::istream& src, size_t blockSize, unsigned depth = 2);
+		~PrefetchingReader();
+
+		PrefetchingReader(const PrefetchingReader&) = delete;
+		PrefetchingReader& operator=(const PrefetchingReader&) = delete;
+
+		/** Returns the next block, which is shorter than the block size
+		 * only at the end of the stream (and empty after it).
+		 * Exceptions thrown while reading are rethrown here, and a read
+		 * that leaves the stream bad throws std::ios_base::failure: an
+		 * error is never taken for the end of the stream. */
+		const std::vector<char>& next();
+	};
+
+
+
+	/** Writes a set of output streams through one writer thread per
+	 * storage device: the data written to every output is collected
+	 * into extents, and the writer of each device writes the extents of
+	 * its outputs in order. Outputs that share a device use extents of
+	 * `sharedExtent` bytes, so that they are written sequentially for a
+	 * while each, rather than in small interleaved writes (which makes
+	 * rotational disks seek back and forth); the others use extents of
+	 * `soloExtent` bytes. The first extents of every output are smaller,
+	 * and double in size up to those, so that small outputs don't cost
+	 * as much memory as large ones. */
+	class DeviceWriters {
+	private:
+		struct Extent {
+			size_t target;
+			std::vector<char> data;
+		};
+
+		struct Device {
+			std::mutex mtx;
+			std::condition_variable cv;
+			std::deque<Extent> queue;
+			std::vector<std::vector<char>> free;
+			size_t maxQueued;
+			bool busy;
+			bool stopping;
+			std::thread thread;
+		};
+
+		class ExtentBuf : public std::streambuf {
+		private:
+			DeviceWriters* owner_;
+			size_t target_;
+			size_t extentSize_;
+			size_t nextExtentSize_;
+			std::vector<char> extent_;
+
+			void submit_();
+
+		protected:
+			int_type overflow(int_type) override;
+			int sync() override;
+			std::streamsize xsputn(const char_type*, std::streamsize) override;
+
+		public:
+			ExtentBuf(DeviceWriters& owner, size_t target, size_t extentSize);
+		};
+
+		std::vector<std::ostream*> targets_;
+		std::vector<size_t> targetDevices_;
+		std::vector<std::unique_ptr<Device>> devices_;
+		std::vector<std::unique_ptr<ExtentBuf>> bufs_;
+		std::vector<std::unique_ptr<std::ostream>> streams_;
+		std::mutex errorMtx_;
+		std::exception_ptr error_;
+
+		void writeLoop_(Device&);
+		std::vector<char> takeBuffer_(size_t target, size_t size);
+		void push_(size_t target, std::vector<char> data);
+		void rethrow_();
+
+	public:
+		/** `deviceIds[i]` identifies the device of `targets[i]`. */
+		DeviceWriters(
+			std::vector<std::ostream*> targets, const std::vector<uint64_t>& deviceIds,
+			size_t soloExtent, size_t sharedExtent );
+		~DeviceWriters();
+
+		DeviceWriters(const DeviceWriters&) = delete;
+		DeviceWriters& operator=(const DeviceWriters&) = delete;
+
+		/** The stream that writes to the i-th target. */
+		std::ostream& stream(size_t i) { return *streams_[i]; }
+
+		size_t deviceCount() const { return devices_.size(); }
+
+		/** Writes everything that was written to the streams, and waits
+		 * for the writers to be idle; exceptions thrown while writing
+		 * are rethrown here. */
+		void finish();
+	};
+
+}
@@ -0,0 +1,280 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#include "checkpoint.hpp"
+
+#include "integrity.hpp"
+#include "sha256.hpp"
+
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <filesystem>
+#include <chrono>
+
+#ifdef XORINATOR_POSIX_IO
+	extern "C" {
+		#include <fcntl.h>
+		#include <unistd.h>
+		#include <sys/file.h>
+	}
+#endif
+
+
+
+namespace {
+
+	using xorinator::checkpoint::JournalException;
+
+	#ifdef XORINATOR_POSIX_IO
+
+		constexpr std::array<char, 8> MAGIC = { 'x', 'o', 'r', 'c', 'k', 'p', 't', '\0' };
+		constexpr uint32_t FORMAT_VERSION = 1;
+		constexpr size_t HEADER_SIZE = 48;
+
+
+		[[noreturn]] void throwErrno(const std::string& what, const std::string& path) {
+			throw JournalException(what + " \"" + path + "\": " + std::strerror(errno)); }
+
+
+		template<typename T>
+		void putLe(unsigned char* dst, T value) {
+			for(unsigned i=0; i < sizeof(T); ++i) {
+				dst[i] = value >> (i * 8); }
+		}
+
+		template<typename T>
+		T getLe(const unsigned char* src) {
+			T r = 0;
+			for(unsigned i=0; i < sizeof(T); ++i) {
+				r = r | (T(src[i]) << (i * 8)); }
+			return r;
+		}
+
+
+		size_t slotSize(size_t outputCount) {
+			return 8 + (8 * outputCount) + 4; }
+
+
+		/** Serializes a commit into a slot, checksum included. */
+		std::vector<unsigned char> encodeSlot(uint64_t sequence, const std::vector<uint64_t>& offsets) {
+			auto r = std::vector<unsigned char>(slotSize(offsets.size()));
+			putLe<uint64_t>(r.data(), sequence);
+			for(size_t i=0; i < offsets.size(); ++i) {
+				putLe<uint64_t>(r.data() + 8 + (8 * i), offsets[i]); }
+			putLe<uint32_t>(r.data() + r.size() - 4, xorinator::integrity::crc32c(0, r.data(), r.size() - 4));
+			return r;
+		}
+
+
+		void writeAll(int fd, const unsigned char* src, size_t size, uint64_t offset, const std::string& path) {
+			while(size > 0) {
+				auto wr = ::pwrite(fd, src, size, offset);
+				if(wr < 0) {
+					if(errno == EINTR)  continue;
+					throwErrno("could not write", path);
+				}
+				src += wr;
+				offset += wr;
+				size -= wr;
+			}
+		}
+
+
+		/** Creates a journal with a header and an initial commit, then
+		 * moves it to its path, so that no partial journal can be found
+		 * there after a crash. */
+		void createJournal(const std::string& path, const xorinator::checkpoint::Fingerprint& fingerprint, size_t outputCount) {
+			auto tmpPath = path + ".tmp";
+			auto content = std::vector<unsigned char>(HEADER_SIZE);
+			std::copy(MAGIC.begin(), MAGIC.end(), content.begin());
+			putLe<uint32_t>(content.data() + 8, FORMAT_VERSION);
+			putLe<uint32_t>(content.data() + 12, outputCount);
+			std::copy(fingerprint.begin(), fingerprint.end(), content.begin() + 16);
+			auto slot = encodeSlot(0, std::vector<uint64_t>(outputCount, 0));
+			content.insert(content.end(), slot.begin(), slot.end());
+			content.insert(content.end(), slot.size(), 0);
+
+			int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+			if(fd < 0)  throwErrno("could not create", tmpPath);
+			try {
+				writeAll(fd, content.data(), content.size(), 0, tmpPath);
+				if(0 != ::fsync(fd))  throwErrno("could not sync", tmpPath);
+			} catch(...) {
+				::close(fd);
+				throw;
+			}
+			::close(fd);
+			if(0 != ::rename(tmpPath.c_str(), path.c_str()))  throwErrno("could not create", path);
+		}
+
+	#endif
+
+}
+
+
+
+namespace xorinator::checkpoint {
+
+	std::string journalPath(const std::string& outputPath) {
+		return outputPath + ".resume"; }
+
+
+	Fingerprint operationFingerprint(const cli::CommandLine& cmdln) {
+		namespace fs = std::filesystem;
+		const bool mux = cmdln.cmdType == cli::CmdType::eMultiplex;
+		auto hash = Sha256();
+		auto hashInt = [&](uint64_t value) {
+			unsigned char buffer[8];
+			for(unsigned i=0; i < sizeof(buffer); ++i) {
+				buffer[i] = value >> (i * 8); }
+			hash.update(buffer, sizeof(buffer));
+		};
+		auto hashPath = [&](const std::string& path, bool input) {
+			auto absolute = fs::absolute(path).string();
+			hashInt(absolute.size());
+			hash.update(absolute.data(), absolute.size());
+			if(input) {
+				std::error_code ec;
+				auto size = fs::file_size(path, ec);
+				hashInt(ec? 0 : size);
+				auto mtime = fs::last_write_time(path, ec);
+				hashInt(ec? 0 : mtime.time_since_epoch().count());
+			}
+		};
+
+		hashInt(uint64_t(cmdln.cmdType));
+		hashInt(cmdln.rngKeys.size());
+		hashInt(cmdln.litterSize);
+		hashPath(cmdln.firstArg, mux);
+		for(const auto& path : cmdln.variadicArgs) {
+			hashPath(path, ! mux); }
+		for(const auto& path : cmdln.roKeys) {
+			hashPath(path, true); }
+		return hash.finish();
+	}
+
+
+	#ifdef XORINATOR_POSIX_IO
+
+		Journal::Journal(std::string path, const Fingerprint& fingerprint, size_t outputCount):
+				path_(std::move(path)),
+				fd_(-1),
+				sequence_(0),
+				offsets_(outputCount, 0)
+		{
+			fd_ = ::open(path_.c_str(), O_RDWR | O_CLOEXEC);
+			if((fd_ < 0) && (errno == ENOENT)) {
+				createJournal(path_, fingerprint, outputCount);
+				fd_ = ::open(path_.c_str(), O_RDWR | O_CLOEXEC);
+			}
+			if(fd_ < 0)  throwErrno("could not open the checkpoint journal", path_);
+			try {
+				if(0 != ::flock(fd_, LOCK_EX | LOCK_NB)) {
+					throwErrno("could not lock the checkpoint journal", path_); }
+
+				const size_t slotLen = slotSize(outputCount);
+				auto content = std::vector<unsigned char>(HEADER_SIZE + (2 * slotLen));
+				size_t done = 0;
+				while(done < content.size()) {
+					auto rd = ::pread(fd_, content.data() + done, content.size() - done, done);
+					if(rd < 0) {
+						if(errno == EINTR)  continue;
+						throwErrno("could not read", path_);
+					}
+					if(rd == 0) break;
+					done += rd;
+				}
+				if((done < HEADER_SIZE) || ! std::equal(MAGIC.begin(), MAGIC.end(), content.begin())) {
+					throw JournalException('"' + path_ + "\" is not a checkpoint journal"); }
+				if(getLe<uint32_t>(content.data() + 8) != FORMAT_VERSION) {
+					throw JournalException("unsupported checkpoint journal version in \"" + path_ + '"'); }
+				if(
+						(getLe<uint32_t>(content.data() + 12) != outputCount) ||
+						! std::equal(fingerprint.begin(), fingerprint.end(), content.begin() + 16)
+				) {
+					throw JournalException(
+						"the checkpoint journal \"" + path_ + "\" belongs to another operation; "
+						"remove it to start over"); }
+
+				bool found = false;
+				for(unsigned s=0; s < 2; ++s) {
+					const unsigned char* slot = content.data() + HEADER_SIZE + (s * slotLen);
+					if(done < HEADER_SIZE + ((s + 1) * slotLen)) continue;
+					if(getLe<uint32_t>(slot + slotLen - 4) != integrity::crc32c(0, slot, slotLen - 4)) continue;
+					uint64_t sequence = getLe<uint64_t>(slot);
+					if(found && (sequence <= sequence_)) continue;
+					found = true;
+					sequence_ = sequence;
+					for(size_t i=0; i < outputCount; ++i) {
+						offsets_[i] = getLe<uint64_t>(slot + 8 + (8 * i)); }
+				}
+				if(! found) {
+					throw JournalException("the checkpoint journal \"" + path_ + "\" is corrupted"); }
+			} catch(...) {
+				::close(fd_);
+				throw;
+			}
+		}
+
+
+		Journal::~Journal() {
+			if(fd_ >= 0)  ::close(fd_);
+		}
+
+
+		void Journal::commit(const std::vector<uint64_t>& offsets) {
+			if(offsets.size() != offsets_.size()) {
+				throw std::logic_error("checkpoint with the wrong number of offsets"); }
+			auto slot = encodeSlot(sequence_ + 1, offsets);
+			writeAll(fd_, slot.data(), slot.size(), HEADER_SIZE + (((sequence_ + 1) % 2) * slot.size()), path_);
+			int r;
+			do {
+				r = ::fdatasync(fd_);
+			} while((r != 0) && (errno == EINTR));
+			if(r != 0)  throwErrno("could not sync", path_);
+			sequence_ += 1;
+			offsets_ = offsets;
+		}
+
+
+		void Journal::remove() {
+			if(0 != ::unlink(path_.c_str()))  throwErrno("could not remove", path_);
+			::close(fd_);
+			fd_ = -1;
+		}
+
+	#else
+
+		Journal::Journal(std::string path, const Fingerprint&, size_t outputCount):
+				path_(std::move(path)), fd_(-1), sequence_(0), offsets_(outputCount, 0)
+		{
+			throw JournalException("checkpoint journals are not supported on this platform");
+		}
+
+		Journal::~Journal() { }
+
+		void Journal::commit(const std::vector<uint64_t>&) { }
+
+		void Journal::remove() { }
+
+	#endif
+
+}
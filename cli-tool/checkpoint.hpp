@@ -0,0 +1,96 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+
+#include "clparser.hpp"
+
+
+
+/** A checkpoint journal records how far an operation got in writing
+ * its outputs, so that an interrupted operation can be resumed with
+ * the "--resume" option instead of starting over.
+ *
+ * The journal "FILE.resume" of the first output "FILE" begins with a
+ * header identifying the operation by a fingerprint of its arguments,
+ * followed by two slots that hold the committed offset of every
+ * output; each commit overwrites the older slot, with a sequence
+ * number and a checksum, so that a commit torn by a crash leaves the
+ * previous one intact. Every integer is stored in little-endian
+ * byte order. */
+namespace xorinator::checkpoint {
+
+	class JournalException : public std::runtime_error {
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+
+	using Fingerprint = std::array<uint8_t, 32>;
+
+
+	/** Returns the path of the journal of an operation whose first
+	 * output is at the given path. */
+	std::string journalPath(const std::string& outputPath);
+
+	/** Identifies the multiplexing or demultiplexing operation of a
+	 * command line by its subcommand, the absolute paths of its files,
+	 * and the size and modification time of its inputs. "--key"
+	 * arguments are only counted, so that nothing derived from them is
+	 * stored next to the outputs. */
+	Fingerprint operationFingerprint(const cli::CommandLine&);
+
+
+	class Journal {
+	private:
+		std::string path_;
+		int fd_;
+		uint64_t sequence_;
+		std::vector<uint64_t> offsets_;
+
+	public:
+		/** Opens the journal at the given path, creating it (with every
+		 * offset set to 0) if it doesn't exist. Throws a JournalException
+		 * if the journal belongs to another operation. */
+		Journal(std::string path, const Fingerprint&, size_t outputCount);
+		~Journal();
+
+		Journal(const Journal&) = delete;
+		Journal& operator=(const Journal&) = delete;
+
+		/** The offsets of the last commit. */
+		const std::vector<uint64_t>& offsets() const { return offsets_; }
+
+		/** Durably records the given offsets; the data before them must
+		 * have already reached the storage device. */
+		void commit(const std::vector<uint64_t>& offsets);
+
+		/** Deletes the journal of a completed operation. */
+		void remove();
+	};
+
+}
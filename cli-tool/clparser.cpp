@@ -26,6 +26,7 @@
 #include <cstring>
 #include <cassert>
 #include <cmath>
+#include <limits>
 
 
 
@@ -49,6 +50,61 @@ namespace {
 	}
 
 
+	/** Parses the value of a numeric option, or throws an
+	 * InvalidCommandLineException if it isn't a valid number. */
+	template<typename uint>
+	uint require_uint(const std::string& str) {
+		auto uintValue = parse_uint<uint>(str);
+		if(! uintValue) {
+			throw xorinator::cli::InvalidCommandLineException(
+				"invalid positive number \"" + str + '"');
+		}
+		return uintValue.value();
+	}
+
+
+	/** Parses a size, optionally followed by one of the binary
+	 * suffixes "K", "M", "G" and "T". */
+	uint64_t parse_size(const std::string& str) {
+		static constexpr std::string_view suffixes = "KMGT";
+		auto suffix = str.empty()? std::string_view::npos : suffixes.find(str.back());
+		if(suffix == std::string_view::npos) {
+			return require_uint<uint64_t>(str); }
+		uint64_t r = require_uint<uint64_t>(str.substr(0, str.size() - 1));
+		unsigned shift = 10 * (suffix + 1);
+		if(r > (std::numeric_limits<uint64_t>::max() >> shift)) {
+			throw xorinator::cli::InvalidCommandLineException("size \"" + str + "\" is too large"); }
+		return r << shift;
+	}
+
+
+	/** Parses a "BEGIN:END" byte range, where either bound may be omitted. */
+	void parse_range(const std::string& str, uint64_t& begin, uint64_t& end) {
+		auto colon = str.find(':');
+		if(colon == std::string::npos) {
+			throw xorinator::cli::InvalidCommandLineException(
+				"invalid range \"" + str + "\" (expected BEGIN:END)"); }
+		auto beginStr = str.substr(0, colon);
+		auto endStr = str.substr(colon + 1);
+		begin = beginStr.empty()? 0 : require_uint<uint64_t>(beginStr);
+		end = endStr.empty()? std::numeric_limits<uint64_t>::max() : require_uint<uint64_t>(endStr);
+		if(begin > end) {
+			throw xorinator::cli::InvalidCommandLineException(
+				"invalid range \"" + str + "\" (the beginning follows the end)"); }
+	}
+
+
+	/** Parses a "--durability" mode. */
+	xorinator::cli::Durability parse_durability(const std::string& str) {
+		using xorinator::cli::Durability;
+		if(str == "none") return Durability::eNone;
+		if(str == "end") return Durability::eEnd;
+		if(str == "periodic") return Durability::ePeriodic;
+		throw xorinator::cli::InvalidCommandLineException(
+			"invalid durability mode \"" + str + "\" (expected \"none\", \"end\" or \"periodic\")");
+	}
+
+
 	/** If the long option is in a single argument, split it and return the
 	 * value portion of it; otherwise, increment the cursor and return the next
 	 * argument. If the key does not match the one provided, `std::nullopt`
@@ -119,8 +175,7 @@ namespace {
 			size_t& cursor,
 			std::vector<std::string>& rngKeysDynV,
 			std::vector<std::string>& roKeysDynV,
-			xorinator::cli::OptionBits::IntType& options,
-			size_t& litterSize
+			xorinator::cli::CommandLine& cmdln
 	) {
 		using xorinator::cli::OptionBits;
 		if((argvxx[cursor].size() < 3) || (! argvxx[cursor].starts_with("--"))) return false;
@@ -132,19 +187,61 @@ namespace {
 			roKeysDynV.push_back(optValue.value());
 		} else
 		if(optValue = get_long_option_value("--litter", argvxx, cursor)) {
-			auto uintValue = parse_uint<size_t>(optValue.value());
-			if(uintValue) {
-				litterSize = uintValue.value();
-			} else {
-				throw xorinator::cli::InvalidCommandLineException(
-					"invalid positive number \"" + optValue.value() + '"');
-			}
+			cmdln.litterSize = require_uint<size_t>(optValue.value());
+		} else
+		if(optValue = get_long_option_value("--jobs", argvxx, cursor)) {
+			cmdln.jobCount = require_uint<size_t>(optValue.value());
+		} else
+		if(optValue = get_long_option_value("--chunk-size", argvxx, cursor)) {
+			cmdln.chunkSize = require_uint<size_t>(optValue.value());
+		} else
+		if(optValue = get_long_option_value("--threshold", argvxx, cursor)) {
+			cmdln.threshold = require_uint<size_t>(optValue.value());
+		} else
+		if(optValue = get_long_option_value("--range", argvxx, cursor)) {
+			parse_range(optValue.value(), cmdln.rangeBegin, cmdln.rangeEnd);
+		} else
+		if(optValue = get_long_option_value("--size", argvxx, cursor)) {
+			cmdln.size = parse_size(optValue.value());
+		} else
+		if(optValue = get_long_option_value("--reservoir", argvxx, cursor)) {
+			cmdln.reservoir = optValue.value();
+		} else
+		if(optValue = get_long_option_value("--delta", argvxx, cursor)) {
+			cmdln.deltaIndex = optValue.value();
+		} else
+		if(optValue = get_long_option_value("--socket", argvxx, cursor)) {
+			cmdln.socketPath = optValue.value();
+		} else
+		if(optValue = get_long_option_value("--durability", argvxx, cursor)) {
+			cmdln.durability = parse_durability(optValue.value());
 		} else
 		if(argvxx[cursor] == "--quiet") {
-			options = options | OptionBits::eQuiet;
+			cmdln.options = cmdln.options | OptionBits::eQuiet;
 		} else
 		if(argvxx[cursor] == "--force") {
-			options = options | OptionBits::eForce;
+			cmdln.options = cmdln.options | OptionBits::eForce;
+		} else
+		if(argvxx[cursor] == "--recursive") {
+			cmdln.options = cmdln.options | OptionBits::eRecursive;
+		} else
+		if(argvxx[cursor] == "--container") {
+			cmdln.options = cmdln.options | OptionBits::eContainer;
+		} else
+		if(argvxx[cursor] == "--index") {
+			cmdln.options = cmdln.options | OptionBits::eIndex;
+		} else
+		if(argvxx[cursor] == "--compress") {
+			cmdln.options = cmdln.options | OptionBits::eCompress;
+		} else
+		if(argvxx[cursor] == "--resume") {
+			cmdln.options = cmdln.options | OptionBits::eResume;
+		} else
+		if(argvxx[cursor] == "--append") {
+			cmdln.options = cmdln.options | OptionBits::eAppend;
+		} else
+		if(argvxx[cursor] == "--raw") {
+			cmdln.options = cmdln.options | OptionBits::eRaw;
 		} else {
 			throw xorinator::cli::InvalidCommandLineException(
 				"unrecognized option \"" + std::string(argvxx[cursor]) + '"');
@@ -162,8 +259,7 @@ namespace {
 			size_t& cursor,
 			std::vector<std::string>& rngKeysDynV,
 			std::vector<std::string>& roKeysDynV,
-			xorinator::cli::OptionBits::IntType& options,
-			size_t& litterSize
+			xorinator::cli::CommandLine& cmdln
 	) {
 		using xorinator::cli::OptionBits;
 		if(
@@ -180,20 +276,32 @@ namespace {
 			roKeysDynV.push_back(optValue.value());
 		} else
 		if(optValue = get_short_option_value('g', argvxx, cursor)) {
-			auto uintValue = parse_uint<size_t>(optValue.value());
-			if(uintValue) {
-				litterSize = uintValue.value();
-			} else {
-				throw xorinator::cli::InvalidCommandLineException(
-					"invalid positive number \"" + optValue.value() + '"');
-			}
+			cmdln.litterSize = require_uint<size_t>(optValue.value());
+		} else
+		if(optValue = get_short_option_value('j', argvxx, cursor)) {
+			cmdln.jobCount = require_uint<size_t>(optValue.value());
+		} else
+		if(optValue = get_short_option_value('t', argvxx, cursor)) {
+			cmdln.threshold = require_uint<size_t>(optValue.value());
 		} else
 		for(char option : std::string_view(argvxx[cursor].begin() + 1, argvxx[cursor].end())) {
 			if(option == 'q') {
-				options = options | OptionBits::eQuiet;
+				cmdln.options = cmdln.options | OptionBits::eQuiet;
 			} else
 			if(option == 'f') {
-				options = options | OptionBits::eForce;
+				cmdln.options = cmdln.options | OptionBits::eForce;
+			} else
+			if(option == 'r') {
+				cmdln.options = cmdln.options | OptionBits::eRecursive;
+			} else
+			if(option == 'c') {
+				cmdln.options = cmdln.options | OptionBits::eContainer;
+			} else
+			if(option == 'i') {
+				cmdln.options = cmdln.options | OptionBits::eIndex;
+			} else
+			if(option == 'z') {
+				cmdln.options = cmdln.options | OptionBits::eCompress;
 			} else {
 				throw xorinator::cli::InvalidCommandLineException(
 					"unrecognized option \"" + std::string(argvxx[cursor]) + '"');
@@ -212,12 +320,11 @@ namespace {
 			size_t& cursor,
 			std::vector<std::string>& rngKeysDynV,
 			std::vector<std::string>& roKeysDynV,
-			xorinator::cli::OptionBits::IntType& options,
-			size_t& litterSize
+			xorinator::cli::CommandLine& cmdln
 	) {
 		return
-			check_option_short(argvxx, cursor, rngKeysDynV, roKeysDynV, options, litterSize) ||
-			check_option_long(argvxx, cursor, rngKeysDynV, roKeysDynV, options, litterSize);
+			check_option_short(argvxx, cursor, rngKeysDynV, roKeysDynV, cmdln) ||
+			check_option_long(argvxx, cursor, rngKeysDynV, roKeysDynV, cmdln);
 	}
 
 
@@ -228,6 +335,20 @@ namespace {
 			return xorinator::cli::CmdType::eMultiplex; }
 		if(sv == "demultiplex" || sv == "demux" || sv == "dmx" || sv == "d") {
 			return xorinator::cli::CmdType::eDemultiplex; }
+		if(sv == "verify" || sv == "vfy" || sv == "v") {
+			return xorinator::cli::CmdType::eVerify; }
+		if(sv == "reshare" || sv == "rsh") {
+			return xorinator::cli::CmdType::eReshare; }
+		if(sv == "split-share" || sv == "split") {
+			return xorinator::cli::CmdType::eSplitShare; }
+		if(sv == "collapse" || sv == "merge") {
+			return xorinator::cli::CmdType::eCollapse; }
+		if(sv == "fill-reservoir" || sv == "fill") {
+			return xorinator::cli::CmdType::eFillReservoir; }
+		if(sv == "generate" || sv == "gen") {
+			return xorinator::cli::CmdType::eGenerate; }
+		if(sv == "serve") {
+			return xorinator::cli::CmdType::eServe; }
 		return xorinator::cli::CmdType::eError;
 	}
 
@@ -240,6 +361,13 @@ namespace xorinator::cli {
 	CommandLine::CommandLine():
 			cmdType(CmdType::eNone),
 			litterSize(0),
+			jobCount(0),
+			chunkSize(0),
+			threshold(0),
+			rangeBegin(0),
+			rangeEnd(std::numeric_limits<uint64_t>::max()),
+			size(0),
+			durability(Durability::eNone),
 			firstLiteralArg(1),
 			options(OptionBits::eNone)
 	{ }
@@ -248,6 +376,13 @@ namespace xorinator::cli {
 	CommandLine::CommandLine(int argc, char const * const * argv):
 			cmdType(CmdType::eNone),
 			litterSize(0),
+			jobCount(0),
+			chunkSize(0),
+			threshold(0),
+			rangeBegin(0),
+			rangeEnd(std::numeric_limits<uint64_t>::max()),
+			size(0),
+			durability(Durability::eNone),
 			firstLiteralArg(argc + 1),
 			options(0)
 	{
@@ -274,9 +409,9 @@ namespace xorinator::cli {
 						if(argsDynV.size() > 0)  firstLiteralArg = argsDynV.size() - 1;
 						else  firstLiteralArg = 0;
 					}
-					else if(! check_option(argvxx, cursor, rngKeysDynV, roKeysDynV, options, litterSize)) {
+					else if(! check_option(argvxx, cursor, rngKeysDynV, roKeysDynV, *this)) {
 						/* If ::check_option returns `true`, then `cursor`, `rngKeysDynV`,
-						 * `roKeysDynV` and `cursor` are modified by said function. */
+						 * `roKeysDynV` and the option members are modified by said function. */
 						argsDynV.push_back(std::string(argvxx[cursor]));
 					}
 				}
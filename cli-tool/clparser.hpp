@@ -64,10 +64,10 @@ namespace xorinator {
 
 		SV_CONSTEXPR StaticVector(const StaticVector& cp):
 				size_(cp.size_),
-				container_((size <= 0)? nullptr : new T[size])
+				container_((size_ <= 0)? nullptr : new T[size_])
 		{
 			for(SizeType i=0; const auto& elem : cp) {
-				container_[i++] = std::move(elem); }
+				container_[i++] = elem; }
 		}
 
 		SV_CONSTEXPR StaticVector(StaticVector&& mv):
@@ -123,21 +123,35 @@ namespace xorinator {
 
 namespace xorinator::cli {
 
-	enum class CmdType { eNone, eError, eMultiplex, eDemultiplex };
+	enum class CmdType { eNone, eError, eMultiplex, eDemultiplex, eVerify, eReshare, eSplitShare, eCollapse, eFillReservoir, eGenerate, eServe };
 
 
 	struct OptionBits {
-		using IntType = uint_fast8_t;
+		using IntType = uint_fast16_t;
 		constexpr static IntType eNone = 0;
 		#define OPTION_BIT_(NAME_, POS_) constexpr static IntType NAME_ = 1 << POS_;
 			OPTION_BIT_(eQuiet, 0)
 			OPTION_BIT_(eForce, 1)
+			OPTION_BIT_(eRecursive, 2)
+			OPTION_BIT_(eContainer, 3)
+			OPTION_BIT_(eIndex, 4)
+			OPTION_BIT_(eCompress, 5)
+			OPTION_BIT_(eResume, 6)
+			OPTION_BIT_(eAppend, 7)
+			OPTION_BIT_(eRaw, 8)
 		#undef OPTION_BIT_
 	};
 
 	using Options = OptionBits::IntType;
 
 
+	/** How new files are committed to the storage device, as given by
+	 * the "--durability" option: not at all (eNone), once every file has
+	 * been written (eEnd), or continuously while writing them, and once
+	 * more at the end (ePeriodic). */
+	enum class Durability { eNone, eEnd, ePeriodic };
+
+
 	class InvalidCommandLineException : public std::runtime_error {
 	public:
 		InvalidCommandLineException(std::string msg): std::runtime_error(msg) { }
@@ -160,6 +174,30 @@ namespace xorinator::cli {
 		StaticVector<std::string> roKeys;
 		/** Maximum amount of random surplus data written by multiplexing operations. */
 		size_t litterSize;
+		/** Number of worker threads for batch operations; 0 lets the
+		 * runtime pick one per hardware thread. */
+		size_t jobCount;
+		/** Chunk size for new share containers; 0 selects the default one. */
+		size_t chunkSize;
+		/** Number of shares needed to demultiplex a new threshold share
+		 * set; 0 makes every share necessary. */
+		size_t threshold;
+		/** Byte range given by the "--range" option; `rangeEnd` is the
+		 * maximum uint64_t value when the range is open-ended. */
+		uint64_t rangeBegin;
+		uint64_t rangeEnd;
+		/** Size given by the "--size" option; 0 if not given. */
+		uint64_t size;
+		/** Pad reservoir given by the "--reservoir" option; empty if not given. */
+		std::string reservoir;
+		/** Block index of the "--delta" option; empty if not given. */
+		std::string deltaIndex;
+		/** Unix socket of the "--socket" option, which "serve" listens
+		 * on and other subcommands send their operation to; empty if
+		 * not given. */
+		std::string socketPath;
+		/** Durability mode given by the "--durability" option. */
+		Durability durability;
 		/** First argument that follows the literal argument marker (`--`).
 		 * If the literal marker is not present, `firstLiteralArg` is
 		 * arbitrarily higher than the argument count. */
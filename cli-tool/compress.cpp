@@ -0,0 +1,304 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#include "compress.hpp"
+
+#include <array>
+#include <cstring>
+#include <algorithm>
+
+
+
+namespace {
+
+	using namespace xorinator::compress;
+
+	constexpr std::array<char, 4> MAGIC = { 'X', 'L', 'Z', '1' };
+	constexpr uint32_t FRAME_STORED = uint32_t(1) << 31;
+	constexpr size_t FRAME_HEADER_SIZE = 4;
+
+	constexpr size_t MIN_MATCH = 4;
+	/** The last match must start at least this many bytes before the end of a block. */
+	constexpr size_t MATCH_FIND_LIMIT = 12;
+	/** The last bytes of a block are always literals. */
+	constexpr size_t LAST_LITERALS = 5;
+	constexpr size_t MAX_OFFSET = 65535;
+	constexpr unsigned HASH_BITS = 12;
+
+
+	uint32_t read32(const uint8_t* p) {
+		uint32_t r;
+		std::memcpy(&r, p, sizeof(r));
+		return r;
+	}
+
+	uint32_t hash4(uint32_t word) {
+		return (word * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+
+	uint8_t* putLength(uint8_t* dst, size_t length) {
+		while(length >= 255) {
+			*(dst++) = 255;
+			length -= 255;
+		}
+		*(dst++) = uint8_t(length);
+		return dst;
+	}
+
+
+	uint8_t* putSequence(uint8_t* dst, const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength) {
+		uint8_t* token = dst++;
+		*token = uint8_t(std::min<size_t>(literalCount, 15) << 4);
+		if(literalCount >= 15) {
+			dst = putLength(dst, literalCount - 15); }
+		std::memcpy(dst, literals, literalCount);
+		dst += literalCount;
+		if(matchLength > 0) {
+			*(dst++) = uint8_t(offset);
+			*(dst++) = uint8_t(offset >> 8);
+			size_t code = matchLength - MIN_MATCH;
+			*token = *token | uint8_t(std::min<size_t>(code, 15));
+			if(code >= 15) {
+				dst = putLength(dst, code - 15); }
+		}
+		return dst;
+	}
+
+
+	size_t getLength(const uint8_t* src, size_t size, size_t& cursor) {
+		size_t r = 0;
+		uint8_t byte;
+		do {
+			if(cursor >= size) {
+				throw CompressionFormatException("truncated compressed block"); }
+			byte = src[cursor++];
+			r += byte;
+		} while(byte == 255);
+		return r;
+	}
+
+
+	template<typename uint_t>
+	void putLe(char* dst, uint_t value) {
+		for(size_t i=0; i < sizeof(uint_t); ++i) {
+			dst[i] = char(uint8_t(value >> (i * 8))); }
+	}
+
+	template<typename uint_t>
+	uint_t getLe(const char* src) {
+		uint_t r = 0;
+		for(size_t i=0; i < sizeof(uint_t); ++i) {
+			r = r | (uint_t(uint8_t(src[i])) << (i * 8)); }
+		return r;
+	}
+
+}
+
+
+
+namespace xorinator::compress {
+
+	size_t compressBlock(const uint8_t* src, size_t size, uint8_t* dst) {
+		uint8_t* out = dst;
+		size_t anchor = 0;
+		if(size > MATCH_FIND_LIMIT) {
+			std::array<uint16_t, 1 << HASH_BITS> table = { };
+			const size_t findLimit = size - MATCH_FIND_LIMIT;
+			const size_t matchLimit = size - LAST_LITERALS;
+			size_t pos = 1;
+			while(pos < findLimit) {
+				uint32_t word = read32(src + pos);
+				auto& slot = table[hash4(word)];
+				size_t candidate = slot;
+				slot = uint16_t(pos);
+				if((candidate < pos) && (pos - candidate <= MAX_OFFSET) && (read32(src + candidate) == word)) {
+					size_t length = MIN_MATCH;
+					while((pos + length < matchLimit) && (src[candidate + length] == src[pos + length])) {
+						++ length; }
+					out = putSequence(out, src + anchor, pos - anchor, pos - candidate, length);
+					pos += length;
+					anchor = pos;
+				} else {
+					/* Skip faster through data that doesn't compress. */
+					pos += 1 + ((pos - anchor) >> 6);
+				}
+			}
+		}
+		out = putSequence(out, src + anchor, size - anchor, 0, 0);
+		return out - dst;
+	}
+
+
+	size_t decompressBlock(const uint8_t* src, size_t size, uint8_t* dst, size_t dstCapacity) {
+		size_t in = 0;
+		size_t out = 0;
+		while(true) {
+			if(in >= size) {
+				throw CompressionFormatException("truncated compressed block"); }
+			uint8_t token = src[in++];
+			size_t literalCount = token >> 4;
+			if(literalCount == 15) {
+				literalCount += getLength(src, size, in); }
+			if((literalCount > size - in) || (literalCount > dstCapacity - out)) {
+				throw CompressionFormatException("malformed compressed block"); }
+			std::memcpy(dst + out, src + in, literalCount);
+			in += literalCount;
+			out += literalCount;
+			if(in == size) break;
+
+			if(size - in < 2) {
+				throw CompressionFormatException("truncated compressed block"); }
+			size_t offset = size_t(src[in]) | (size_t(src[in+1]) << 8);
+			in += 2;
+			size_t matchLength = token & 15;
+			if(matchLength == 15) {
+				matchLength += getLength(src, size, in); }
+			matchLength += MIN_MATCH;
+			if((offset == 0) || (offset > out) || (matchLength > dstCapacity - out)) {
+				throw CompressionFormatException("malformed compressed block"); }
+			for(size_t i=0; i < matchLength; ++i) {
+				dst[out + i] = dst[out + i - offset]; } // Matches may overlap with their own output
+			out += matchLength;
+		}
+		return out;
+	}
+
+
+
+	CompressingInputBuf::CompressingInputBuf(std::istream& src):
+			src_(&src),
+			raw_(BLOCK_SIZE),
+			frame_(MAGIC.size() + FRAME_HEADER_SIZE + compressBound(BLOCK_SIZE)),
+			started_(false),
+			ended_(false)
+	{
+		setg(frame_.data(), frame_.data(), frame_.data());
+	}
+
+
+	CompressingInputBuf::int_type CompressingInputBuf::underflow() {
+		if(gptr() < egptr()) return traits_type::to_int_type(*gptr());
+		if(ended_) return traits_type::eof();
+		size_t frameBegin = 0;
+		if(! started_) {
+			std::copy(MAGIC.begin(), MAGIC.end(), frame_.begin());
+			frameBegin = MAGIC.size();
+			started_ = true;
+		}
+		src_->read(raw_.data(), raw_.size());
+		size_t rawSize = src_->gcount();
+		char* payload = frame_.data() + frameBegin + FRAME_HEADER_SIZE;
+		uint32_t header;
+		if(rawSize == 0) {
+			header = 0;
+			ended_ = true;
+		} else {
+			size_t compressedSize = compressBlock(
+				reinterpret_cast<const uint8_t*>(raw_.data()), rawSize,
+				reinterpret_cast<uint8_t*>(payload));
+			if(compressedSize < rawSize) {
+				header = compressedSize;
+			} else {
+				std::memcpy(payload, raw_.data(), rawSize);
+				header = rawSize | FRAME_STORED;
+			}
+		}
+		putLe<uint32_t>(frame_.data() + frameBegin, header);
+		setg(frame_.data(), frame_.data(), payload + (header & ~FRAME_STORED));
+		return traits_type::to_int_type(*gptr());
+	}
+
+
+
+	DecompressingOutputBuf::DecompressingOutputBuf(std::ostream& dst):
+			dst_(&dst),
+			block_(BLOCK_SIZE),
+			started_(false),
+			ended_(false)
+	{ }
+
+
+	void DecompressingOutputBuf::process_() {
+		size_t cursor = 0;
+		if(! started_) {
+			if(pending_.size() < MAGIC.size()) return;
+			if(! std::equal(MAGIC.begin(), MAGIC.end(), pending_.begin())) {
+				throw CompressionFormatException("the data is not a compressed stream"); }
+			cursor = MAGIC.size();
+			started_ = true;
+		}
+		while((! ended_) && (pending_.size() - cursor >= FRAME_HEADER_SIZE)) {
+			uint32_t header = getLe<uint32_t>(pending_.data() + cursor);
+			size_t payloadSize = header & ~FRAME_STORED;
+			if(payloadSize > compressBound(BLOCK_SIZE)) {
+				throw CompressionFormatException("malformed compressed frame"); }
+			if(pending_.size() - cursor - FRAME_HEADER_SIZE < payloadSize) break;
+			const char* payload = pending_.data() + cursor + FRAME_HEADER_SIZE;
+			if(payloadSize == 0) {
+				ended_ = true;
+			} else
+			if(header & FRAME_STORED) {
+				if(payloadSize > BLOCK_SIZE) {
+					throw CompressionFormatException("malformed compressed frame"); }
+				dst_->write(payload, payloadSize);
+			} else {
+				size_t size = decompressBlock(
+					reinterpret_cast<const uint8_t*>(payload), payloadSize,
+					reinterpret_cast<uint8_t*>(block_.data()), block_.size());
+				dst_->write(block_.data(), size);
+			}
+			cursor += FRAME_HEADER_SIZE + payloadSize;
+		}
+		if(ended_ && (cursor < pending_.size())) {
+			throw CompressionFormatException("the compressed stream is followed by unexpected data"); }
+		pending_.erase(pending_.begin(), pending_.begin() + cursor);
+	}
+
+
+	DecompressingOutputBuf::int_type DecompressingOutputBuf::overflow(int_type c) {
+		if(! traits_type::eq_int_type(c, traits_type::eof())) {
+			char ch = traits_type::to_char_type(c);
+			xsputn(&ch, 1);
+		}
+		return traits_type::not_eof(c);
+	}
+
+
+	std::streamsize DecompressingOutputBuf::xsputn(const char* src, std::streamsize size) {
+		pending_.insert(pending_.end(), src, src + size);
+		process_();
+		return size;
+	}
+
+
+	int DecompressingOutputBuf::sync() {
+		dst_->flush();
+		return dst_->good()? 0 : -1;
+	}
+
+
+	void DecompressingOutputBuf::finish() {
+		if(! ended_) {
+			throw CompressionFormatException("the compressed stream is truncated"); }
+		dst_->flush();
+	}
+
+}
@@ -0,0 +1,145 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#pragma once
+
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+
+
+
+/** A dependency-free LZ4-class compression stage, applied to the input
+ * of multiplexing operations and undone after demultiplexing.
+ *
+ * A compressed stream begins with the 4-byte magic "XLZ1", followed by
+ * frames: every frame is a 32-bit little-endian header and a payload of
+ * the size given by its low 31 bits, which decodes to at most BLOCK_SIZE
+ * bytes. If the high bit of the header is set the payload is stored as
+ * is, otherwise it is a block in the LZ4 block format. A frame with an
+ * empty payload ends the stream. */
+namespace xorinator::compress {
+
+	constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+
+	class CompressionFormatException : public std::runtime_error {
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+
+	/** The largest size a block of the given size can be compressed to. */
+	constexpr size_t compressBound(size_t size) {
+		return size + (size / 255) + 16; }
+
+	/** Compresses `size <= BLOCK_SIZE` bytes into `dst`, which must hold
+	 * at least `compressBound(size)` bytes; returns the compressed size. */
+	size_t compressBlock(const uint8_t* src, size_t size, uint8_t* dst);
+
+	/** Decompresses a block into `dst`, which can hold `dstCapacity` bytes;
+	 * returns the decompressed size, or throws a CompressionFormatException
+	 * if the block is malformed. */
+	size_t decompressBlock(const uint8_t* src, size_t size, uint8_t* dst, size_t dstCapacity);
+
+
+	/** A stream buffer that reads a stream, and yields its compressed form. */
+	class CompressingInputBuf : public std::streambuf {
+	private:
+		std::istream* src_;
+		std::vector<char> raw_;
+		std::vector<char> frame_;
+		bool started_;
+		bool ended_;
+
+	protected:
+		int_type underflow() override;
+
+	public:
+		CompressingInputBuf(std::istream& src);
+
+		CompressingInputBuf(CompressingInputBuf&&) = delete;
+	};
+
+
+	/** A stream buffer that decompresses everything written to it into
+	 * another stream. */
+	class DecompressingOutputBuf : public std::streambuf {
+	private:
+		std::ostream* dst_;
+		std::vector<char> pending_;
+		std::vector<char> block_;
+		bool started_;
+		bool ended_;
+
+		void process_();
+
+	protected:
+		int_type overflow(int_type) override;
+		std::streamsize xsputn(const char*, std::streamsize) override;
+		int sync() override;
+
+	public:
+		DecompressingOutputBuf(std::ostream& dst);
+
+		DecompressingOutputBuf(DecompressingOutputBuf&&) = delete;
+
+		/** Throws a CompressionFormatException if the compressed stream
+		 * hasn't been completely written. */
+		void finish();
+	};
+
+
+	/** A std::istream that yields the compressed form of another stream. */
+	class CompressingIStream : public std::istream {
+	private:
+		CompressingInputBuf buf_;
+
+	public:
+		CompressingIStream(std::istream& src):
+				std::istream(nullptr),
+				buf_(src)
+		{
+			rdbuf(&buf_);
+		}
+	};
+
+
+	/** A std::ostream that decompresses its content into another stream. */
+	class DecompressingOStream : public std::ostream {
+	private:
+		DecompressingOutputBuf buf_;
+
+	public:
+		DecompressingOStream(std::ostream& dst):
+				std::ostream(nullptr),
+				buf_(dst)
+		{
+			rdbuf(&buf_);
+		}
+
+		void finish() { buf_.finish(); }
+	};
+
+}
@@ -0,0 +1,299 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#include "container.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cassert>
+#include <bit>
+
+
+
+namespace {
+
+	constexpr std::array<char, 4> MAGIC = { 'X', 'O', 'R', 'C' };
+
+
+	template<typename uint_t>
+	void putLe(char* dst, uint_t value) {
+		for(size_t i=0; i < sizeof(uint_t); ++i) {
+			dst[i] = char(uint8_t(value >> (i * 8))); }
+	}
+
+	template<typename uint_t>
+	uint_t getLe(const char* src) {
+		uint_t r = 0;
+		for(size_t i=0; i < sizeof(uint_t); ++i) {
+			r = r | (uint_t(uint8_t(src[i])) << (i * 8)); }
+		return r;
+	}
+
+
+	/** Reads exactly `size` bytes, returning how many bytes were read. */
+	size_t readFully(std::istream& src, char* dst, size_t size) {
+		src.read(dst, size);
+		return src.gcount();
+	}
+
+}
+
+
+
+namespace xorinator::container {
+
+	void ShareHeader::write(std::ostream& os) const {
+		std::array<char, SIZE> buffer = { };
+		std::copy(MAGIC.begin(), MAGIC.end(), buffer.begin());
+		buffer[4] = char(formatVersion);
+		buffer[5] = char(keystreamVersion);
+		putLe<uint16_t>(buffer.data() +  6, flags);
+		putLe<uint16_t>(buffer.data() +  8, shareIndex);
+		putLe<uint16_t>(buffer.data() + 10, shareCount);
+		putLe<uint32_t>(buffer.data() + 12, chunkSize);
+		putLe<uint64_t>(buffer.data() + 16, shareMask);
+		std::copy(setId.begin(), setId.end(), buffer.begin() + 24);
+		os.write(buffer.data(), buffer.size());
+	}
+
+
+	ShareHeader ShareHeader::read(std::istream& is, const std::string& name) {
+		std::array<char, SIZE> buffer;
+		return parse(buffer.data(), readFully(is, buffer.data(), buffer.size()), name);
+	}
+
+
+	ShareHeader ShareHeader::parse(const char* src, size_t size, const std::string& name) {
+		if(size < SIZE) {
+			throw ContainerFormatException('"' + name + "\" is too short to be a share container"); }
+		if(! std::equal(MAGIC.begin(), MAGIC.end(), src)) {
+			throw ContainerFormatException('"' + name + "\" is not a share container"); }
+		ShareHeader r;
+		r.formatVersion    = uint8_t(src[4]);
+		r.keystreamVersion = uint8_t(src[5]);
+		r.flags            = getLe<uint16_t>(src +  6);
+		r.shareIndex       = getLe<uint16_t>(src +  8);
+		r.shareCount       = getLe<uint16_t>(src + 10);
+		r.chunkSize        = getLe<uint32_t>(src + 12);
+		r.shareMask        = getLe<uint64_t>(src + 16);
+		std::copy(src + 24, src + 40, r.setId.begin());
+		if(r.formatVersion != FORMAT_VERSION) {
+			throw ContainerFormatException(
+				'"' + name + "\" has an unsupported container version (" +
+				std::to_string(r.formatVersion) + ')');
+		}
+		if(
+				(r.chunkSize == 0) || (r.chunkSize > MAX_CHUNK_SIZE) || (r.shareCount == 0) || (r.shareCount > MAX_SHARES) ||
+				(r.shareIndex >= r.shareCount) || (r.shareMask == 0) ||
+				((r.flags & ~(FLAG_EXTERNAL_PADS | FLAG_THRESHOLD | FLAG_COMPRESSED) & ((1 << THRESHOLD_SHIFT) - 1)) != 0) ||
+				((r.flags & FLAG_THRESHOLD) && ((r.threshold() < 2) || (r.threshold() > r.shareCount))) ||
+				((! (r.flags & FLAG_THRESHOLD)) && ((r.flags >> THRESHOLD_SHIFT) != 0))
+		) {
+			throw ContainerFormatException('"' + name + "\" has a malformed container header"); }
+		return r;
+	}
+
+
+	uint64_t ShareHeader::chunkOffset(uint64_t chunkIndex) const {
+		return SIZE + (chunkIndex * (ChunkHeader::SIZE + chunkSize));
+	}
+
+
+	unsigned ShareHeader::threshold() const {
+		return (flags & FLAG_THRESHOLD)? (flags >> THRESHOLD_SHIFT) : 0;
+	}
+
+
+	std::pair<unsigned, uint64_t> ShareHeader::splitNode() const {
+		const bool split = (shareCount < MAX_SHARES) && ((shareMask >> shareCount) != 0);
+		if(! split)  return { unsigned(std::countr_zero(shareMask)), 0 };
+		const unsigned bit = 63 - std::countl_zero(shareMask);
+		return { (bit - shareCount) % shareCount, ((bit - shareCount) / shareCount) + 1 };
+	}
+
+
+	uint64_t ShareHeader::payloadSize(uint64_t fileSize) const {
+		if(fileSize <= SIZE) return 0;
+		uint64_t body = fileSize - SIZE;
+		uint64_t fullChunks = body / (ChunkHeader::SIZE + chunkSize);
+		uint64_t rem = body % (ChunkHeader::SIZE + chunkSize);
+		return (fullChunks * chunkSize) + ((rem > ChunkHeader::SIZE)? (rem - ChunkHeader::SIZE) : 0);
+	}
+
+
+	unsigned nodeBit(unsigned shareCount, unsigned root, uint64_t node) {
+		assert(root < shareCount);
+		if(node == 0)  return root;
+		if(node > MAX_SHARES)  return MAX_SHARES;
+		return std::min<uint64_t>(shareCount + ((node - 1) * shareCount) + root, MAX_SHARES);
+	}
+
+
+	bool isCompleteMask(unsigned shareCount, uint64_t mask) {
+		const uint64_t original = (shareCount >= MAX_SHARES)? ~uint64_t(0) : ((uint64_t(1) << shareCount) - 1);
+		if((mask & original) != original)  return false;
+		for(unsigned bit = shareCount; bit < MAX_SHARES; ++bit) {
+			if(((mask >> bit) & 1) == 0)  continue;
+			const unsigned root = (bit - shareCount) % shareCount;
+			const uint64_t node = ((bit - shareCount) / shareCount) + 1;
+			const unsigned sibling = nodeBit(shareCount, root, (node % 2 == 1)? (node + 1) : (node - 1));
+			if((sibling >= MAX_SHARES) || (((mask >> sibling) & 1) == 0))  return false;
+		}
+		return true;
+	}
+
+
+	void ChunkHeader::write(std::ostream& os) const {
+		std::array<char, SIZE> buffer = { };
+		putLe<uint64_t>(buffer.data() + 0, index);
+		putLe<uint32_t>(buffer.data() + 8, payloadSize);
+		os.write(buffer.data(), buffer.size());
+	}
+
+
+	bool ChunkHeader::read(std::istream& is, const std::string& name) {
+		std::array<char, SIZE> buffer;
+		size_t got = readFully(is, buffer.data(), buffer.size());
+		if(got == 0) return false;
+		if(got != buffer.size()) {
+			throw ContainerFormatException('"' + name + "\" has a truncated chunk header"); }
+		parse(buffer.data());
+		return true;
+	}
+
+
+	void ChunkHeader::parse(const char* src) {
+		index = getLe<uint64_t>(src + 0);
+		payloadSize = getLe<uint32_t>(src + 8);
+	}
+
+
+
+	ChunkedOutputBuf::ChunkedOutputBuf(std::ostream& dst, const ShareHeader& hdr):
+			dst_(&dst),
+			chunk_(hdr.chunkSize),
+			nextChunk_(0)
+	{
+		hdr.write(*dst_);
+		setp(chunk_.data(), chunk_.data() + chunk_.size());
+	}
+
+
+	ChunkedOutputBuf::~ChunkedOutputBuf() {
+		try {
+			finish();
+		} catch(...) {
+			/* Errors have already been reported through the destination
+			 * stream's state, if anyone cared to check. */
+		}
+	}
+
+
+	void ChunkedOutputBuf::emitChunk_() {
+		auto size = pptr() - pbase();
+		if(size > 0) {
+			ChunkHeader { nextChunk_++, uint32_t(size) }.write(*dst_);
+			dst_->write(pbase(), size);
+		}
+		setp(chunk_.data(), chunk_.data() + chunk_.size());
+	}
+
+
+	ChunkedOutputBuf::int_type ChunkedOutputBuf::overflow(int_type c) {
+		if(dst_ == nullptr) return traits_type::eof();
+		emitChunk_();
+		if(! traits_type::eq_int_type(c, traits_type::eof())) {
+			*pptr() = traits_type::to_char_type(c);
+			pbump(1);
+		}
+		return traits_type::not_eof(c);
+	}
+
+
+	std::streamsize ChunkedOutputBuf::xsputn(const char* src, std::streamsize size) {
+		if(dst_ == nullptr) return 0;
+		std::streamsize written = 0;
+		while(written < size) {
+			if(pptr() == epptr()) {
+				emitChunk_(); }
+			auto n = std::min<std::streamsize>(size - written, epptr() - pptr());
+			std::memcpy(pptr(), src + written, n);
+			pbump(n);
+			written += n;
+		}
+		return written;
+	}
+
+
+	int ChunkedOutputBuf::sync() {
+		/* Partial chunks may only be written at the end of the share,
+		 * so syncing only flushes what has already been chunked. */
+		if(dst_ == nullptr) return 0;
+		dst_->flush();
+		return dst_->good()? 0 : -1;
+	}
+
+
+	void ChunkedOutputBuf::finish() {
+		if(dst_ == nullptr) return;
+		emitChunk_();
+		dst_->flush();
+		dst_ = nullptr;
+		setp(nullptr, nullptr);
+	}
+
+
+
+	ChunkedInputBuf::ChunkedInputBuf(std::istream& src, const ShareHeader& hdr, std::string name):
+			src_(&src),
+			name_(std::move(name)),
+			chunk_(hdr.chunkSize),
+			chunkSize_(hdr.chunkSize),
+			nextChunk_(0),
+			lastChunk_(false)
+	{
+		setg(chunk_.data(), chunk_.data(), chunk_.data());
+	}
+
+
+	ChunkedInputBuf::int_type ChunkedInputBuf::underflow() {
+		if(gptr() < egptr()) return traits_type::to_int_type(*gptr());
+		ChunkHeader hdr;
+		if(! hdr.read(*src_, name_)) return traits_type::eof();
+		if(lastChunk_) {
+			throw ContainerFormatException('"' + name_ + "\" has data after its last chunk"); }
+		if(hdr.index != nextChunk_) {
+			throw ContainerFormatException(
+				'"' + name_ + "\" has chunk " + std::to_string(hdr.index) +
+				" where chunk " + std::to_string(nextChunk_) + " was expected");
+		}
+		if((hdr.payloadSize == 0) || (hdr.payloadSize > chunkSize_)) {
+			throw ContainerFormatException(
+				'"' + name_ + "\" has a malformed chunk (" + std::to_string(hdr.index) + ')'); }
+		if(readFully(*src_, chunk_.data(), hdr.payloadSize) != hdr.payloadSize) {
+			throw ContainerFormatException(
+				'"' + name_ + "\" has a truncated chunk (" + std::to_string(hdr.index) + ')'); }
+		++ nextChunk_;
+		lastChunk_ = hdr.payloadSize < chunkSize_;
+		setg(chunk_.data(), chunk_.data(), chunk_.data() + hdr.payloadSize);
+		return traits_type::to_int_type(*gptr());
+	}
+
+}
@@ -0,0 +1,235 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#pragma once
+
+#include <array>
+#include <utility>
+#include <vector>
+#include <string>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <stdexcept>
+#include <cstdint>
+
+
+
+namespace xorinator::container {
+
+	/** Version of the container format written by this build. */
+	constexpr uint8_t FORMAT_VERSION = 1;
+
+	/** The share set was multiplexed without "--key" arguments. */
+	constexpr uint8_t KEYSTREAM_NONE = 0;
+	/** The share set was multiplexed with "--key" arguments, using
+	 * the RngKey<512> / std::mt19937_64 keystream. */
+	constexpr uint8_t KEYSTREAM_RNGKEY_V1 = 1;
+
+	/** The share set needs one or more "--nogen" files to be demultiplexed. */
+	constexpr uint16_t FLAG_EXTERNAL_PADS = 1 << 0;
+	/** The share set is a k-of-n threshold set over GF(2^8), rather than
+	 * a XOR set; the threshold is stored in the high byte of the flags,
+	 * and the evaluation point of a share is its index plus one. */
+	constexpr uint16_t FLAG_THRESHOLD = 1 << 1;
+	/** The share set was multiplexed with the "--compress" option. */
+	constexpr uint16_t FLAG_COMPRESSED = 1 << 2;
+	constexpr unsigned THRESHOLD_SHIFT = 8;
+
+	constexpr uint32_t DEFAULT_CHUNK_SIZE = 1024 * 1024;
+	/** Chunks are read whole into memory: headers with a larger chunk
+	 * size are rejected, rather than trusted with an allocation. */
+	constexpr uint32_t MAX_CHUNK_SIZE = 64 * 1024 * 1024;
+
+	/** Container headers can describe at most this many shares per set. */
+	constexpr unsigned MAX_SHARES = 64;
+
+	using SetId = std::array<uint8_t, 16>;
+
+
+	/** Share masks begin with one bit for each of the `shareCount`
+	 * shares the set was created with. Splitting a share grows a binary
+	 * tree rooted at the original share, whose nodes are numbered like a
+	 * heap: node 0 is the original share, and the children of node `k`
+	 * are `2k + 1` and `2k + 2`. The bits of the nodes follow the bits
+	 * of the original shares, interleaved across the trees, so that
+	 * splits of different shares never take the same bit.
+	 * Returns the bit of the given node, or MAX_SHARES if the mask has
+	 * no room for it. */
+	unsigned nodeBit(unsigned shareCount, unsigned root, uint64_t node);
+
+	/** Returns whether a share mask covers a whole set: every original
+	 * share, and both children of every split node it has. */
+	bool isCompleteMask(unsigned shareCount, uint64_t mask);
+
+
+	class ContainerFormatException : public std::runtime_error {
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+
+	/** The header at the beginning of every share container.
+	 * Every integer is stored in little-endian byte order. */
+	struct ShareHeader {
+		static constexpr size_t SIZE = 40;
+
+		uint8_t formatVersion;
+		uint8_t keystreamVersion;
+		uint16_t flags;
+		/** Index of the share in its set; for merged shares, the lowest
+		 * index of the merged ones, and for split shares, the index of
+		 * the share they were split from. */
+		uint16_t shareIndex;
+		/** Number of shares the set was created with. */
+		uint16_t shareCount;
+		uint32_t chunkSize;
+		/** One bit for every share of the set, or node of a split share
+		 * (see ::nodeBit), that this share contains. */
+		uint64_t shareMask;
+		SetId setId;
+
+		void write(std::ostream&) const;
+
+		/** Reads and validates a header, throwing a ContainerFormatException
+		 * if the stream doesn't begin with one. */
+		static ShareHeader read(std::istream&, const std::string& name);
+
+		/** Like ::read, for the first `size` bytes of a file that were
+		 * read beforehand. */
+		static ShareHeader parse(const char* src, size_t size, const std::string& name);
+
+		/** Offset of the given chunk's header, from the beginning of the share. */
+		uint64_t chunkOffset(uint64_t chunkIndex) const;
+
+		/** Number of payload bytes in a container file of the given size. */
+		uint64_t payloadSize(uint64_t fileSize) const;
+
+		/** Number of shares needed to demultiplex a threshold set, or 0
+		 * for a XOR set. */
+		unsigned threshold() const;
+
+		/** The original share and the split tree node (see ::nodeBit)
+		 * that this share stands for: the deepest node of its mask. */
+		std::pair<unsigned, uint64_t> splitNode() const;
+	};
+
+
+	/** The header preceding each chunk's payload. Every chunk has a
+	 * payload of ShareHeader::chunkSize bytes, except the last one. */
+	struct ChunkHeader {
+		static constexpr size_t SIZE = 16;
+
+		uint64_t index;
+		uint32_t payloadSize;
+
+		void write(std::ostream&) const;
+
+		/** Reads a chunk header; returns `false` on a clean end of stream,
+		 * throws a ContainerFormatException on a truncated one. */
+		bool read(std::istream&, const std::string& name);
+
+		/** Decodes a chunk header from its SIZE bytes. */
+		void parse(const char* src);
+	};
+
+
+	/** A stream buffer that writes a share header, then splits everything
+	 * written to it into chunks. */
+	class ChunkedOutputBuf : public std::streambuf {
+	private:
+		std::ostream* dst_;
+		std::vector<char> chunk_;
+		uint64_t nextChunk_;
+
+		void emitChunk_();
+
+	protected:
+		int_type overflow(int_type) override;
+		std::streamsize xsputn(const char*, std::streamsize) override;
+		int sync() override;
+
+	public:
+		ChunkedOutputBuf(std::ostream& dst, const ShareHeader&);
+		~ChunkedOutputBuf();
+
+		ChunkedOutputBuf(ChunkedOutputBuf&&) = delete;
+
+		/** Writes the last, possibly partial, chunk; nothing can be
+		 * written after it. */
+		void finish();
+	};
+
+
+	/** A stream buffer that reads the payload of a share container,
+	 * validating chunk headers as it goes. The share header must have
+	 * already been consumed. */
+	class ChunkedInputBuf : public std::streambuf {
+	private:
+		std::istream* src_;
+		std::string name_;
+		std::vector<char> chunk_;
+		uint32_t chunkSize_;
+		uint64_t nextChunk_;
+		bool lastChunk_;
+
+	protected:
+		int_type underflow() override;
+
+	public:
+		ChunkedInputBuf(std::istream& src, const ShareHeader&, std::string name);
+
+		ChunkedInputBuf(ChunkedInputBuf&&) = delete;
+	};
+
+
+	/** A std::ostream whose content is written as a share container,
+	 * in the same way std::ofstream writes to a file. */
+	class ChunkedOStream : public std::ostream {
+	private:
+		ChunkedOutputBuf buf_;
+
+	public:
+		ChunkedOStream(std::ostream& dst, const ShareHeader& hdr):
+				std::ostream(nullptr),
+				buf_(dst, hdr)
+		{
+			rdbuf(&buf_);
+		}
+
+		void finish() { buf_.finish(); }
+	};
+
+
+	/** A std::istream that reads the payload of a share container. */
+	class ChunkedIStream : public std::istream {
+	private:
+		ChunkedInputBuf buf_;
+
+	public:
+		ChunkedIStream(std::istream& src, const ShareHeader& hdr, std::string name):
+				std::istream(nullptr),
+				buf_(src, hdr, std::move(name))
+		{
+			rdbuf(&buf_);
+		}
+	};
+
+}
@@ -0,0 +1,67 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#pragma once
+
+/* Runtime CPU feature detection, for the few routines that have
+ * vectorized implementations: XORINATOR_X86_DISPATCH is defined when
+ * such implementations can be compiled (through per-function target
+ * attributes) and selected at runtime. */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define XORINATOR_X86_DISPATCH
+#endif
+
+
+
+namespace xorinator::cpu {
+
+	#ifdef XORINATOR_X86_DISPATCH
+
+		inline bool hasSse42() {
+			static const bool r = __builtin_cpu_supports("sse4.2");
+			return r;
+		}
+
+		inline bool hasSsse3() {
+			static const bool r = __builtin_cpu_supports("ssse3");
+			return r;
+		}
+
+		inline bool hasAvx2() {
+			static const bool r = __builtin_cpu_supports("avx2");
+			return r;
+		}
+
+		inline bool hasAvx512f() {
+			static const bool r = __builtin_cpu_supports("avx512f");
+			return r;
+		}
+
+	#else
+
+		constexpr bool hasSse42() { return false; }
+		constexpr bool hasSsse3() { return false; }
+		constexpr bool hasAvx2() { return false; }
+		constexpr bool hasAvx512f() { return false; }
+
+	#endif
+
+}
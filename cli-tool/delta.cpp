@@ -0,0 +1,218 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#include "delta.hpp"
+
+#include <array>
+#include <algorithm>
+#include <cassert>
+
+
+
+namespace {
+
+	using xorinator::delta::DeltaIndexException;
+	using xorinator::delta::Digest;
+
+	constexpr std::array<char, 8> MAGIC = { 'x', 'o', 'r', 'd', 'e', 'l', 't', 'a' };
+	constexpr uint32_t FORMAT_VERSION = 1;
+	constexpr size_t HEADER_SIZE = 64;
+
+	/** Records are read this many at a time. */
+	constexpr uint64_t RECORD_GROUP = 4096;
+
+
+	template<typename uint_t>
+	void putLe(char* dst, uint_t value) {
+		for(size_t i=0; i < sizeof(uint_t); ++i) {
+			dst[i] = char(uint8_t(value >> (i * 8))); }
+	}
+
+	template<typename uint_t>
+	uint_t getLe(const char* src) {
+		uint_t r = 0;
+		for(size_t i=0; i < sizeof(uint_t); ++i) {
+			r = r | (uint_t(uint8_t(src[i])) << (i * 8)); }
+		return r;
+	}
+
+}
+
+
+
+namespace xorinator::delta {
+
+	Digest blockDigest(const void* data, size_t size) {
+		Sha256 hash;
+		hash.update(data, size);
+		return hash.finish();
+	}
+
+
+
+	IndexWriter::IndexWriter(std::ostream& dst, size_t shareCount, uint32_t blockSize):
+			dst_(&dst),
+			blockSize_(blockSize),
+			dataSize_(0),
+			hashes_(shareCount + 1),
+			fills_(shareCount + 1, 0),
+			pending_(shareCount + 1)
+	{
+		assert(blockSize > 0);
+		std::array<char, HEADER_SIZE> placeholder = { };
+		dst_->write(placeholder.data(), placeholder.size());
+	}
+
+
+	void IndexWriter::writeRecord_(const Record& record) {
+		assert(record.size() == hashes_.size());
+		for(const auto& digest : record) {
+			contentHash_.update(digest.data(), digest.size());
+			dst_->write(reinterpret_cast<const char*>(digest.data()), digest.size());
+		}
+	}
+
+
+	void IndexWriter::writePending_() {
+		auto record = Record(pending_.size());
+		while(std::none_of(pending_.begin(), pending_.end(), [](const auto& p) { return p.empty(); })) {
+			for(size_t i=0; i < pending_.size(); ++i) {
+				record[i] = pending_[i].front();
+				pending_[i].pop_front();
+			}
+			writeRecord_(record);
+		}
+	}
+
+
+	void IndexWriter::update(size_t stream, const void* data, size_t size) {
+		auto cursor = reinterpret_cast<const char*>(data);
+		if(stream == 0) {
+			dataSize_ += size; }
+		while(size > 0) {
+			size_t n = std::min<size_t>(size, blockSize_ - fills_[stream]);
+			hashes_[stream].update(cursor, n);
+			fills_[stream] += n;
+			cursor += n;
+			size -= n;
+			if(fills_[stream] == blockSize_) {
+				pending_[stream].push_back(hashes_[stream].finish());
+				hashes_[stream] = Sha256();
+				fills_[stream] = 0;
+			}
+		}
+		writePending_();
+	}
+
+
+	void IndexWriter::append(const Record& record, uint32_t size) {
+		assert(size <= blockSize_);
+		writeRecord_(record);
+		dataSize_ += size;
+	}
+
+
+	void IndexWriter::finish() {
+		for(size_t i=0; i < hashes_.size(); ++i) {
+			if(fills_[i] > 0) {
+				pending_[i].push_back(hashes_[i].finish());
+				hashes_[i] = Sha256();
+				fills_[i] = 0;
+			}
+		}
+		writePending_();
+		for(const auto& p : pending_) {
+			if(! p.empty()) {
+				throw DeltaIndexException("the shares and the source of a block index have different sizes"); }
+		}
+		std::array<char, HEADER_SIZE> header = { };
+		std::copy(MAGIC.begin(), MAGIC.end(), header.begin());
+		putLe<uint32_t>(header.data() +  8, FORMAT_VERSION);
+		putLe<uint32_t>(header.data() + 12, blockSize_);
+		putLe<uint64_t>(header.data() + 16, dataSize_);
+		putLe<uint32_t>(header.data() + 24, hashes_.size() - 1);
+		auto digest = contentHash_.finish();
+		std::copy(digest.begin(), digest.end(), header.begin() + 32);
+		dst_->seekp(0);
+		dst_->write(header.data(), header.size());
+		dst_->seekp(0, std::ios_base::end);
+	}
+
+
+
+	IndexReader::IndexReader(const std::string& path):
+			file_(path, std::ios_base::binary),
+			name_(path),
+			groupFirst_(0)
+	{
+		std::array<char, HEADER_SIZE> header;
+		if(! file_.read(header.data(), header.size())) {
+			throw DeltaIndexException("could not read the block index \"" + path + '"'); }
+		if(! std::equal(MAGIC.begin(), MAGIC.end(), header.begin())) {
+			throw DeltaIndexException('"' + path + "\" is not a block index"); }
+		if(getLe<uint32_t>(header.data() + 8) != FORMAT_VERSION) {
+			throw DeltaIndexException('"' + path + "\" has an unsupported format"); }
+		blockSize_  = getLe<uint32_t>(header.data() + 12);
+		dataSize_   = getLe<uint64_t>(header.data() + 16);
+		shareCount_ = getLe<uint32_t>(header.data() + 24);
+		if((blockSize_ == 0) || (shareCount_ == 0)) {
+			throw DeltaIndexException('"' + path + "\" has a malformed header"); }
+
+		// Check every record against the header, so that later reads can trust them
+		const size_t recordSize = (shareCount_ + 1) * sizeof(Digest);
+		uint64_t left = blockCount() * recordSize;
+		Sha256 hash;
+		auto buffer = std::vector<char>(RECORD_GROUP * recordSize);
+		while(left > 0) {
+			size_t n = std::min<uint64_t>(left, buffer.size());
+			if(! file_.read(buffer.data(), n)) {
+				throw DeltaIndexException('"' + path + "\" is truncated"); }
+			hash.update(buffer.data(), n);
+			left -= n;
+		}
+		Digest stored;
+		std::copy_n(header.begin() + 32, stored.size(), stored.begin());
+		if((file_.peek() != std::ifstream::traits_type::eof()) || (hash.finish() != stored)) {
+			throw DeltaIndexException('"' + path + "\" is corrupted"); }
+		file_.clear();
+		file_.exceptions(std::ios_base::badbit);
+	}
+
+
+	const Record& IndexReader::record(uint64_t block) {
+		assert(block < blockCount());
+		if((block < groupFirst_) || (block >= groupFirst_ + group_.size())) {
+			const size_t recordSize = (shareCount_ + 1) * sizeof(Digest);
+			groupFirst_ = block - (block % RECORD_GROUP);
+			group_.resize(std::min(RECORD_GROUP, blockCount() - groupFirst_));
+			auto buffer = std::vector<char>(group_.size() * recordSize);
+			file_.seekg(HEADER_SIZE + (groupFirst_ * recordSize));
+			if(! file_.read(buffer.data(), buffer.size())) {
+				throw DeltaIndexException('"' + name_ + "\" is truncated"); }
+			for(size_t i=0; auto& record : group_) {
+				record.resize(shareCount_ + 1);
+				for(auto& digest : record) {
+					std::copy_n(buffer.data() + (i++ * sizeof(Digest)), sizeof(Digest), digest.begin()); }
+			}
+		}
+		return group_[block - groupFirst_];
+	}
+
+}
@@ -0,0 +1,131 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+
+#include "sha256.hpp"
+
+
+
+/** The block index of a "--delta" operation records, for every block of
+ * the source as it was last multiplexed, the SHA-256 digest of the block
+ * and of the same block of every share: the next operation rewrites the
+ * blocks whose source digest changed, after checking that the shares
+ * still hold what the index says.
+ *
+ * The index begins with a header holding the block size, the size of the
+ * source, the number of shares and the digest of everything after the
+ * header, followed by one record per block: the digest of the source
+ * block, then the digests of the share blocks in order. Every integer is
+ * stored in little-endian byte order. */
+namespace xorinator::delta {
+
+	constexpr uint32_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+
+	class DeltaIndexException : public std::runtime_error {
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+
+	using Digest = Sha256::Digest;
+
+	/** The digests of one block: the source first, then every share. */
+	using Record = std::vector<Digest>;
+
+	/** Returns the SHA-256 digest of a block of data. */
+	Digest blockDigest(const void* data, size_t size);
+
+
+	/** Writes a block index to a seekable stream, record by record. */
+	class IndexWriter {
+	private:
+		std::ostream* dst_;
+		uint32_t blockSize_;
+		uint64_t dataSize_;
+		std::vector<Sha256> hashes_;
+		std::vector<uint32_t> fills_;
+		std::vector<std::deque<Digest>> pending_;
+		Sha256 contentHash_;
+
+		void writeRecord_(const Record&);
+		void writePending_();
+
+	public:
+		/** Starts the index of a source multiplexed into `shareCount`
+		 * shares; the header is written by ::finish. */
+		IndexWriter(std::ostream& dst, size_t shareCount, uint32_t blockSize = DEFAULT_BLOCK_SIZE);
+
+		IndexWriter(const IndexWriter&) = delete;
+		IndexWriter& operator=(const IndexWriter&) = delete;
+
+		/** Hashes the next `size` bytes of a stream, 0 being the source
+		 * and `i+1` share `i`; every stream must be given as many bytes in
+		 * the end, but not necessarily in the same pieces. */
+		void update(size_t stream, const void* data, size_t size);
+
+		/** Appends the record of the next block, which is `size` bytes
+		 * long; it must not be used together with ::update. */
+		void append(const Record&, uint32_t size);
+
+		/** Hashes the last partial block of every stream, and writes the
+		 * header. */
+		void finish();
+	};
+
+
+	/** Reads the records of an index file on demand. */
+	class IndexReader {
+	private:
+		std::ifstream file_;
+		std::string name_;
+		uint32_t blockSize_;
+		uint64_t dataSize_;
+		size_t shareCount_;
+		uint64_t groupFirst_;
+		std::vector<Record> group_;
+
+	public:
+		/** Opens the index file at the given path, and checks its digest;
+		 * throws a DeltaIndexException if it is missing, malformed or
+		 * corrupted. */
+		explicit IndexReader(const std::string& path);
+
+		uint32_t blockSize() const { return blockSize_; }
+		uint64_t dataSize() const { return dataSize_; }
+		size_t shareCount() const { return shareCount_; }
+		uint64_t blockCount() const { return (dataSize_ + blockSize_ - 1) / blockSize_; }
+
+		/** Returns the record of the given block; records are read in
+		 * groups, so sequential reads are cheap. */
+		const Record& record(uint64_t block);
+	};
+
+}
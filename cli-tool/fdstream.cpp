@@ -0,0 +1,360 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#include "fdstream.hpp"
+
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+#include <ios>
+#include <algorithm>
+
+#ifdef XORINATOR_POSIX_IO
+	extern "C" {
+		#include <unistd.h>
+		#include <fcntl.h>
+		#include <sys/stat.h>
+	}
+#endif
+
+
+
+namespace {
+
+	constexpr size_t FD_BUFFER_SIZE = 64 * 1024;
+
+
+	/** Reports a failed read, so that the stream it happened under is
+	 * set to `badbit` rather than mistaking it for the end of its file. */
+	[[noreturn]] void throwReadError(int fd) {
+		throw std::ios_base::failure(
+			"could not read from file descriptor " + std::to_string(fd),
+			std::error_code(errno, std::generic_category()));
+	}
+
+}
+
+
+
+namespace xorinator::runtime {
+
+	std::optional<int> parseFdPath(const std::string& path) {
+		#ifdef XORINATOR_POSIX_IO
+			if((path.size() < 4) || (path.compare(0, 3, "fd:") != 0)) return std::nullopt;
+			long fd = 0;
+			for(size_t i=3; i < path.size(); ++i) {
+				if((path[i] < '0') || (path[i] > '9')) return std::nullopt;
+				fd = (fd * 10) + (path[i] - '0');
+				if(fd > 0xffff) return std::nullopt;
+			}
+			return int(fd);
+		#else
+			(void) path;
+			return std::nullopt;
+		#endif
+	}
+
+
+	bool syncFd(int fd) {
+		#ifdef XORINATOR_POSIX_IO
+			int r;
+			do {
+				r = ::fdatasync(fd);
+			} while((r != 0) && (errno == EINTR));
+			return (r == 0) || (errno == EINVAL) || (errno == EROFS);
+		#else
+			(void) fd;
+			return true;
+		#endif
+	}
+
+
+	bool syncPath(const std::string& path) {
+		#ifdef XORINATOR_POSIX_IO
+			int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if(fd < 0) return false;
+			bool r = syncFd(fd);
+			::close(fd);
+			return r;
+		#else
+			(void) path;
+			return true;
+		#endif
+	}
+
+
+	std::optional<uint64_t> remainingFileSize(int fd) {
+		#ifdef XORINATOR_POSIX_IO
+			struct stat st;
+			if((0 != ::fstat(fd, &st)) || ! S_ISREG(st.st_mode)) return std::nullopt;
+			auto offset = ::lseek(fd, 0, SEEK_CUR);
+			if(offset < 0) return std::nullopt;
+			return (offset < st.st_size)? uint64_t(st.st_size - offset) : 0;
+		#else
+			(void) fd;
+			return std::nullopt;
+		#endif
+	}
+
+
+	void preallocateFd(int fd, uint64_t size) {
+		#if defined(XORINATOR_POSIX_IO) && defined(__linux__)
+			auto offset = ::lseek(fd, 0, SEEK_CUR);
+			if((offset >= 0) && (size > 0)) {
+				::fallocate(fd, FALLOC_FL_KEEP_SIZE, offset, size); }
+		#else
+			(void) fd;
+			(void) size;
+		#endif
+	}
+
+
+	size_t readAt(int fd, void* dst, size_t size, uint64_t offset) {
+		#ifdef XORINATOR_POSIX_IO
+			auto cursor = reinterpret_cast<char*>(dst);
+			size_t done = 0;
+			while(done < size) {
+				auto rd = ::pread(fd, cursor + done, size - done, offset + done);
+				if(rd < 0) {
+					if(errno == EINTR)  continue;
+					throwReadError(fd);
+				}
+				if(rd == 0)  break;
+				done += rd;
+			}
+			return done;
+		#else
+			(void) fd;
+			(void) dst;
+			(void) size;
+			(void) offset;
+			throw std::ios_base::failure("positioned reads are not supported on this platform");
+		#endif
+	}
+
+
+	void writeAt(int fd, const void* src, size_t size, uint64_t offset) {
+		#ifdef XORINATOR_POSIX_IO
+			auto cursor = reinterpret_cast<const char*>(src);
+			while(size > 0) {
+				auto wr = ::pwrite(fd, cursor, size, offset);
+				if(wr < 0) {
+					if(errno == EINTR)  continue;
+					throw std::ios_base::failure(
+						"could not write to file descriptor " + std::to_string(fd),
+						std::error_code(errno, std::generic_category()));
+				}
+				cursor += wr;
+				offset += wr;
+				size -= wr;
+			}
+		#else
+			(void) fd;
+			(void) src;
+			(void) size;
+			(void) offset;
+			throw std::ios_base::failure("positioned writes are not supported on this platform");
+		#endif
+	}
+
+
+	FdStreamBuf::FdStreamBuf(int fd, bool output, bool owned):
+			fd_(fd),
+			buffer_(FD_BUFFER_SIZE),
+			output_(output),
+			owned_(owned),
+			writebackWindow_(0),
+			writebackBase_(0),
+			written_(0),
+			writebackBegin_(0)
+	{
+		#ifdef XORINATOR_POSIX_IO
+			if(::fcntl(fd_, F_GETFD) < 0) {
+				throw std::runtime_error("\"fd:" + std::to_string(fd_) + "\" is not an open file descriptor"); }
+		#endif
+		if(output_) {
+			setp(buffer_.data(), buffer_.data() + buffer_.size());
+		} else {
+			setg(buffer_.data(), buffer_.data(), buffer_.data());
+		}
+	}
+
+
+	FdStreamBuf::~FdStreamBuf() {
+		#ifdef XORINATOR_POSIX_IO
+			if(output_) flushBuffer_();
+			if(owned_) ::close(fd_);
+		#endif
+	}
+
+
+	bool FdStreamBuf::write_(const char* src, size_t size) {
+		#ifdef XORINATOR_POSIX_IO
+			size_t done = 0;
+			while(done < size) {
+				auto wr = ::write(fd_, src + done, size - done);
+				if(wr < 0) {
+					if(errno == EINTR) continue;
+					return false;
+				}
+				done += wr;
+			}
+			written_ += size;
+			if(writebackWindow_ > 0) writeback_();
+			return true;
+		#else
+			(void) src;
+			(void) size;
+			return false;
+		#endif
+	}
+
+
+	void FdStreamBuf::writeback_() {
+		#ifdef __linux__
+			/* Errors are ignored: writeback is only a hint, and whether
+			 * the data reached the device is checked by syncData. */
+			while(written_ - writebackBegin_ >= writebackWindow_) {
+				off64_t begin = writebackBase_ + writebackBegin_;
+				::sync_file_range(fd_, begin, writebackWindow_, SYNC_FILE_RANGE_WRITE);
+				if(writebackBegin_ >= writebackWindow_) {
+					::sync_file_range(fd_, begin - writebackWindow_, writebackWindow_,
+						SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER); }
+				writebackBegin_ += writebackWindow_;
+			}
+		#endif
+	}
+
+
+	void FdStreamBuf::setWriteback(uint64_t window) {
+		#ifdef __linux__
+			auto pos = ::lseek(fd_, 0, SEEK_CUR);
+			if((! output_) || (pos < 0)) return;
+			writebackWindow_ = window;
+			writebackBase_ = int64_t(pos) - int64_t(written_);
+			writebackBegin_ = written_;
+		#else
+			(void) window;
+		#endif
+	}
+
+
+	bool FdStreamBuf::syncData() {
+		return output_ && flushBuffer_() && syncFd(fd_);
+	}
+
+
+	bool FdStreamBuf::flushBuffer_() {
+		if(! write_(pbase(), pptr() - pbase())) return false;
+		setp(buffer_.data(), buffer_.data() + buffer_.size());
+		return true;
+	}
+
+
+	FdStreamBuf::int_type FdStreamBuf::underflow() {
+		#ifdef XORINATOR_POSIX_IO
+			if(output_) return traits_type::eof();
+			while(true) {
+				auto rd = ::read(fd_, buffer_.data(), buffer_.size());
+				if(rd < 0) {
+					if(errno == EINTR) continue;
+					throwReadError(fd_);
+				}
+				if(rd == 0) return traits_type::eof();
+				setg(buffer_.data(), buffer_.data(), buffer_.data() + rd);
+				return traits_type::to_int_type(*gptr());
+			}
+		#else
+			return traits_type::eof();
+		#endif
+	}
+
+
+	FdStreamBuf::int_type FdStreamBuf::overflow(int_type c) {
+		if((! output_) || ! flushBuffer_()) return traits_type::eof();
+		if(! traits_type::eq_int_type(c, traits_type::eof())) {
+			*pptr() = traits_type::to_char_type(c);
+			pbump(1);
+		}
+		return traits_type::not_eof(c);
+	}
+
+
+	int FdStreamBuf::sync() {
+		if(! output_) return 0;
+		return flushBuffer_()? 0 : -1;
+	}
+
+
+
+	std::streamsize FdStreamBuf::xsgetn(char_type* dst, std::streamsize n) {
+		std::streamsize done = std::min<std::streamsize>(n, egptr() - gptr());
+		std::copy(gptr(), gptr() + done, dst);
+		gbump(done);
+		#ifdef XORINATOR_POSIX_IO
+			while((! output_) && (n - done >= std::streamsize(buffer_.size()))) {
+				auto rd = ::read(fd_, dst + done, n - done);
+				if(rd < 0) {
+					if(errno == EINTR) continue;
+					throwReadError(fd_);
+				}
+				if(rd == 0) return done;
+				done += rd;
+			}
+		#endif
+		if(done < n) {
+			done += std::streambuf::xsgetn(dst + done, n - done); }
+		return done;
+	}
+
+
+	std::streamsize FdStreamBuf::xsputn(const char_type* src, std::streamsize n) {
+		if(output_ && (n >= std::streamsize(buffer_.size()))) {
+			if(! (flushBuffer_() && write_(src, n))) return 0;
+			return n;
+		}
+		return std::streambuf::xsputn(src, n);
+	}
+
+
+
+	FdStreamBuf::pos_type FdStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) {
+		#ifdef XORINATOR_POSIX_IO
+			if(output_) return pos_type(off_type(-1));
+			if(dir == std::ios_base::cur) {
+				off -= egptr() - gptr(); } // The descriptor is past the buffered data
+			int whence = (dir == std::ios_base::beg)? SEEK_SET : (dir == std::ios_base::cur)? SEEK_CUR : SEEK_END;
+			auto pos = ::lseek(fd_, off, whence);
+			if(pos < 0) return pos_type(off_type(-1));
+			setg(buffer_.data(), buffer_.data(), buffer_.data());
+			return pos_type(off_type(pos));
+		#else
+			(void) off;
+			(void) dir;
+			return pos_type(off_type(-1));
+		#endif
+	}
+
+
+	FdStreamBuf::pos_type FdStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which) {
+		return seekoff(off_type(pos), std::ios_base::beg, which);
+	}
+
+}
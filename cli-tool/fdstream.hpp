@@ -0,0 +1,156 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#pragma once
+
+#include <string>
+#include <optional>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+#include <cstdint>
+
+
+
+namespace xorinator::runtime {
+
+	/** Returns the file descriptor named by a "fd:N" path, or
+	 * `std::nullopt` if the path has another form (or if file
+	 * descriptors are not supported on this platform). */
+	std::optional<int> parseFdPath(const std::string& path);
+
+
+	/** Waits for the data written to a file descriptor to reach the
+	 * storage device; returns `false` if it could not be synced.
+	 * Descriptors that cannot be synced at all, such as pipes, are
+	 * trivially successful. */
+	bool syncFd(int fd);
+
+	/** Like ::syncFd, for the file at the given path. */
+	bool syncPath(const std::string& path);
+
+	/** Returns the number of bytes between the offset of a file
+	 * descriptor and the end of its file, or `std::nullopt` if it is not
+	 * a regular file. */
+	std::optional<uint64_t> remainingFileSize(int fd);
+
+	/** Reserves storage for the next `size` bytes written to a file
+	 * descriptor, without changing the size of its file, so that they
+	 * are allocated contiguously; only a hint, and only effective on
+	 * Linux file systems that support it. */
+	void preallocateFd(int fd, uint64_t size);
+
+	/** Reads up to `size` bytes at the given offset of a file
+	 * descriptor, without moving its offset, so that several threads can
+	 * share it; fewer bytes are only returned at the end of the file.
+	 * Throws std::ios_base::failure if the descriptor can't be read, or
+	 * if positioned reads are not supported on this platform. */
+	size_t readAt(int fd, void* dst, size_t size, uint64_t offset);
+
+	/** Writes `size` bytes at the given offset of a file descriptor,
+	 * like ::readAt. */
+	void writeAt(int fd, const void* src, size_t size, uint64_t offset);
+
+
+	/** A stream buffer that reads from, or writes to, a file descriptor,
+	 * and closes it when destroyed if it owns it; transfers larger than
+	 * its buffer bypass it. Input descriptors can be sought, if their
+	 * files can; a failed read throws std::ios_base::failure, which sets
+	 * `badbit` on the stream. */
+	class FdStreamBuf : public std::streambuf {
+	private:
+		int fd_;
+		std::vector<char> buffer_;
+		bool output_;
+		bool owned_;
+		uint64_t writebackWindow_;
+		int64_t writebackBase_;
+		uint64_t written_;
+		uint64_t writebackBegin_;
+
+		bool flushBuffer_();
+		bool write_(const char* src, size_t size);
+		void writeback_();
+
+	protected:
+		int_type underflow() override;
+		int_type overflow(int_type) override;
+		int sync() override;
+		std::streamsize xsgetn(char_type*, std::streamsize) override;
+		std::streamsize xsputn(const char_type*, std::streamsize) override;
+		pos_type seekoff(off_type, std::ios_base::seekdir, std::ios_base::openmode) override;
+		pos_type seekpos(pos_type, std::ios_base::openmode) override;
+
+	public:
+		FdStreamBuf(int fd, bool output, bool owned = true);
+		~FdStreamBuf();
+
+		FdStreamBuf(const FdStreamBuf&) = delete;
+		FdStreamBuf& operator=(const FdStreamBuf&) = delete;
+
+		int fd() const { return fd_; }
+
+		/** Starts writing back every `window` bytes as soon as they are
+		 * written, and waits for the window before it: the dirty pages
+		 * of the file never exceed two windows, instead of being written
+		 * back in bursts. Only has an effect on Linux, and on seekable
+		 * descriptors. */
+		void setWriteback(uint64_t window);
+
+		/** Flushes the buffer, then waits for the data to reach the
+		 * storage device; returns `false` on failure. */
+		bool syncData();
+	};
+
+
+	/** A std::istream that reads from a file descriptor. */
+	class FdIStream : public std::istream {
+	private:
+		FdStreamBuf buf_;
+
+	public:
+		FdIStream(int fd, bool owned = true):
+				std::istream(nullptr),
+				buf_(fd, false, owned)
+		{
+			rdbuf(&buf_);
+		}
+	};
+
+
+	/** A std::ostream that writes to a file descriptor. */
+	class FdOStream : public std::ostream {
+	private:
+		FdStreamBuf buf_;
+
+	public:
+		FdOStream(int fd, bool owned = true):
+				std::ostream(nullptr),
+				buf_(fd, true, owned)
+		{
+			rdbuf(&buf_);
+		}
+
+		~FdOStream() {
+			buf_.pubsync(); }
+	};
+
+}
@@ -0,0 +1,162 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#include "gf256.hpp"
+#include "cpu.hpp"
+
+#include <array>
+#include <cassert>
+
+#ifdef XORINATOR_X86_DISPATCH
+	#include <immintrin.h>
+#endif
+
+
+
+namespace {
+
+	struct Tables {
+		std::array<uint8_t, 512> exp;
+		std::array<uint8_t, 256> log;
+	};
+
+	constexpr Tables tables = []() {
+		Tables r = { };
+		unsigned x = 1;
+		for(unsigned i=0; i < 255; ++i) {
+			r.exp[i] = x;
+			r.exp[i + 255] = x;
+			r.log[x] = i;
+			x = x << 1;
+			if(x & 0x100)  x = x ^ 0x11d;
+		}
+		return r;
+	} ();
+
+
+	/** The products of a constant with every low nibble, and with every
+	 * high nibble: `c * x == lo[x & 0xf] ^ hi[x >> 4]`. */
+	struct NibbleTables {
+		alignas(16) std::array<uint8_t, 16> lo;
+		alignas(16) std::array<uint8_t, 16> hi;
+
+		explicit NibbleTables(uint8_t c) {
+			for(unsigned i=0; i < 16; ++i) {
+				lo[i] = xorinator::gf256::mul(c, i);
+				hi[i] = xorinator::gf256::mul(c, i << 4);
+			}
+		}
+	};
+
+
+	#ifdef XORINATOR_X86_DISPATCH
+
+		/** Returns the number of bytes processed, a multiple of 16. */
+		__attribute__((target("ssse3")))
+		size_t mulAddSsse3(uint8_t* dst, const uint8_t* src, size_t size, const NibbleTables& t) {
+			const __m128i lo = _mm_load_si128(reinterpret_cast<const __m128i*>(t.lo.data()));
+			const __m128i hi = _mm_load_si128(reinterpret_cast<const __m128i*>(t.hi.data()));
+			const __m128i mask = _mm_set1_epi8(0x0f);
+			size_t i = 0;
+			for(; i + 16 <= size; i += 16) {
+				__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+				__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+				__m128i pl = _mm_shuffle_epi8(lo, _mm_and_si128(s, mask));
+				__m128i ph = _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi64(s, 4), mask));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(d, _mm_xor_si128(pl, ph)));
+			}
+			return i;
+		}
+
+		/** Returns the number of bytes processed, a multiple of 32. */
+		__attribute__((target("avx2")))
+		size_t mulAddAvx2(uint8_t* dst, const uint8_t* src, size_t size, const NibbleTables& t) {
+			const __m256i lo = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(t.lo.data())));
+			const __m256i hi = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(t.hi.data())));
+			const __m256i mask = _mm256_set1_epi8(0x0f);
+			size_t i = 0;
+			for(; i + 32 <= size; i += 32) {
+				__m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+				__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+				__m256i pl = _mm256_shuffle_epi8(lo, _mm256_and_si256(s, mask));
+				__m256i ph = _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi64(s, 4), mask));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(d, _mm256_xor_si256(pl, ph)));
+			}
+			return i;
+		}
+
+	#endif
+
+}
+
+
+
+namespace xorinator::gf256 {
+
+	uint8_t mul(uint8_t a, uint8_t b) {
+		if((a == 0) || (b == 0)) return 0;
+		return tables.exp[unsigned(tables.log[a]) + tables.log[b]];
+	}
+
+
+	uint8_t inv(uint8_t a) {
+		assert(a != 0);
+		return tables.exp[255 - tables.log[a]];
+	}
+
+
+	void mulAdd(uint8_t* dst, const uint8_t* src, size_t size, uint8_t c) {
+		if(c == 0) return;
+		if(c == 1) {
+			for(size_t i=0; i < size; ++i) {
+				dst[i] ^= src[i]; }
+			return;
+		}
+		auto t = NibbleTables(c);
+		size_t done = 0;
+		#ifdef XORINATOR_X86_DISPATCH
+			if(cpu::hasAvx2()) {
+				done = mulAddAvx2(dst, src, size, t);
+			} else
+			if(cpu::hasSsse3()) {
+				done = mulAddSsse3(dst, src, size, t);
+			}
+		#endif
+		for(size_t i = done; i < size; ++i) {
+			dst[i] ^= t.lo[src[i] & 0xf] ^ t.hi[src[i] >> 4]; }
+	}
+
+
+	std::vector<uint8_t> lagrangeAtZero(const std::vector<uint8_t>& xs) {
+		auto r = std::vector<uint8_t>(xs.size());
+		for(size_t j=0; j < xs.size(); ++j) {
+			uint8_t num = 1;
+			uint8_t den = 1;
+			for(size_t m=0; m < xs.size(); ++m) {
+				if(m == j) continue;
+				num = mul(num, xs[m]);
+				den = mul(den, xs[m] ^ xs[j]);
+			}
+			r[j] = mul(num, inv(den));
+		}
+		return r;
+	}
+
+}
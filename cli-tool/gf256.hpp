@@ -0,0 +1,47 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+
+/** Arithmetic over GF(2^8), with the reducing polynomial
+ * x^8 + x^4 + x^3 + x^2 + 1 (0x11d): addition is XOR. */
+namespace xorinator::gf256 {
+
+	uint8_t mul(uint8_t, uint8_t);
+
+	/** Multiplicative inverse of a nonzero element. */
+	uint8_t inv(uint8_t);
+
+	/** Computes `dst[i] ^= c * src[i]` for every `i < size`, using
+	 * SSSE3 or AVX2 nibble table lookups when the CPU supports them. */
+	void mulAdd(uint8_t* dst, const uint8_t* src, size_t size, uint8_t c);
+
+	/** Returns the coefficients that interpolate a polynomial at 0 from
+	 * its values at the given (distinct, nonzero) points: the value at 0
+	 * is the sum of every value multiplied by its coefficient. */
+	std::vector<uint8_t> lagrangeAtZero(const std::vector<uint8_t>& xs);
+
+}
@@ -0,0 +1,372 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#include "integrity.hpp"
+#include "cpu.hpp"
+
+#include <array>
+#include <cstring>
+#include <cassert>
+
+#ifdef XORINATOR_X86_DISPATCH
+	#include <nmmintrin.h>
+#endif
+
+
+
+namespace {
+
+	constexpr std::array<char, 4> MAGIC = { 'X', 'O', 'R', 'I' };
+
+	/** Reversed CRC32C (Castagnoli) polynomial. */
+	constexpr uint32_t CRC32C_POLY = 0x82f63b78;
+
+
+	/** Lookup tables for the "slicing-by-8" software CRC32C. */
+	constexpr auto crcTables = []() {
+		std::array<std::array<uint32_t, 256>, 8> r = { };
+		for(uint32_t i=0; i < 256; ++i) {
+			uint32_t crc = i;
+			for(unsigned j=0; j < 8; ++j) {
+				crc = (crc >> 1) ^ ((crc & 1)? CRC32C_POLY : 0); }
+			r[0][i] = crc;
+		}
+		for(uint32_t i=0; i < 256; ++i) {
+			for(unsigned t=1; t < 8; ++t) {
+				r[t][i] = (r[t-1][i] >> 8) ^ r[0][r[t-1][i] & 0xff]; }
+		}
+		return r;
+	} ();
+
+
+	uint32_t crc32cSw(uint32_t crc, const uint8_t* data, size_t size) {
+		while(size >= 8) {
+			uint32_t lo = crc ^ (
+				uint32_t(data[0]) | (uint32_t(data[1]) << 8) |
+				(uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24) );
+			crc =
+				crcTables[7][lo & 0xff] ^ crcTables[6][(lo >> 8) & 0xff] ^
+				crcTables[5][(lo >> 16) & 0xff] ^ crcTables[4][lo >> 24] ^
+				crcTables[3][data[4]] ^ crcTables[2][data[5]] ^
+				crcTables[1][data[6]] ^ crcTables[0][data[7]];
+			data += 8;
+			size -= 8;
+		}
+		while(size > 0) {
+			crc = (crc >> 8) ^ crcTables[0][(crc ^ *data) & 0xff];
+			++data;
+			--size;
+		}
+		return crc;
+	}
+
+
+	#ifdef XORINATOR_X86_DISPATCH
+
+		__attribute__((target("sse4.2")))
+		uint32_t crc32cHw(uint32_t crc, const uint8_t* data, size_t size) {
+			#ifdef __x86_64__
+				uint64_t crc64 = crc;
+				while(size >= 8) {
+					uint64_t word;
+					std::memcpy(&word, data, sizeof(word));
+					crc64 = _mm_crc32_u64(crc64, word);
+					data += 8;
+					size -= 8;
+				}
+				crc = uint32_t(crc64);
+			#else
+				while(size >= 4) {
+					uint32_t word;
+					std::memcpy(&word, data, sizeof(word));
+					crc = _mm_crc32_u32(crc, word);
+					data += 4;
+					size -= 4;
+				}
+			#endif
+			while(size > 0) {
+				crc = _mm_crc32_u8(crc, *data);
+				++data;
+				--size;
+			}
+			return crc;
+		}
+
+	#endif
+
+
+	template<typename uint_t>
+	void putLe(char* dst, uint_t value) {
+		for(size_t i=0; i < sizeof(uint_t); ++i) {
+			dst[i] = char(uint8_t(value >> (i * 8))); }
+	}
+
+	template<typename uint_t>
+	uint_t getLe(const char* src) {
+		uint_t r = 0;
+		for(size_t i=0; i < sizeof(uint_t); ++i) {
+			r = r | (uint_t(uint8_t(src[i])) << (i * 8)); }
+		return r;
+	}
+
+
+	/** Computes the next level of an integrity tree. */
+	std::vector<uint32_t> parentLevel(const std::vector<uint32_t>& level) {
+		std::vector<uint32_t> r;
+		r.reserve((level.size() + 1) / 2);
+		for(size_t i=0; i < level.size(); i += 2) {
+			if(i+1 < level.size()) {
+				r.push_back(xorinator::integrity::hashNodes(level[i], level[i+1]));
+			} else {
+				r.push_back(level[i]);
+			}
+		}
+		return r;
+	}
+
+}
+
+
+
+namespace xorinator::integrity {
+
+	uint32_t crc32c(uint32_t crc, const void* data, size_t size) {
+		auto bytes = reinterpret_cast<const uint8_t*>(data);
+		crc = ~crc;
+		#ifdef XORINATOR_X86_DISPATCH
+			if(cpu::hasSse42()) {
+				return ~crc32cHw(crc, bytes, size); }
+		#endif
+		return ~crc32cSw(crc, bytes, size);
+	}
+
+
+	uint32_t hashNodes(uint32_t left, uint32_t right) {
+		std::array<char, 8> buffer;
+		putLe<uint32_t>(buffer.data() + 0, left);
+		putLe<uint32_t>(buffer.data() + 4, right);
+		return crc32c(0, buffer.data(), buffer.size());
+	}
+
+
+	std::string IntegrityIndex::pathFor(const std::string& sharePath) {
+		return sharePath + ".xidx";
+	}
+
+
+	void IntegrityIndex::write(std::ostream& os) const {
+		std::vector<std::vector<uint32_t>> levels;
+		if(! leaves.empty()) {
+			levels.push_back(leaves);
+			while(levels.back().size() > 1) {
+				levels.push_back(parentLevel(levels.back())); }
+		}
+		std::array<char, HEADER_SIZE> header = { };
+		std::copy(MAGIC.begin(), MAGIC.end(), header.begin());
+		header[4] = char(FORMAT_VERSION);
+		header[5] = char(HASH_CRC32C);
+		putLe<uint32_t>(header.data() +  8, blockSize);
+		putLe<uint32_t>(header.data() + 12, levels.empty()? 0 : levels.back().front());
+		putLe<uint64_t>(header.data() + 16, dataSize);
+		putLe<uint64_t>(header.data() + 24, leaves.size());
+		os.write(header.data(), header.size());
+		std::array<char, 4> node;
+		for(const auto& level : levels) {
+			for(uint32_t hash : level) {
+				putLe<uint32_t>(node.data(), hash);
+				os.write(node.data(), node.size());
+			}
+		}
+	}
+
+
+
+	IndexReader::IndexReader(const std::string& path):
+			file_(path, std::ios_base::binary),
+			name_(path)
+	{
+		std::array<char, IntegrityIndex::HEADER_SIZE> header;
+		if(! file_.read(header.data(), header.size())) {
+			throw IntegrityException("could not read the integrity index \"" + path + '"'); }
+		if(! std::equal(MAGIC.begin(), MAGIC.end(), header.begin())) {
+			throw IntegrityException('"' + path + "\" is not an integrity index"); }
+		if((uint8_t(header[4]) != FORMAT_VERSION) || (uint8_t(header[5]) != HASH_CRC32C)) {
+			throw IntegrityException('"' + path + "\" has an unsupported format"); }
+		blockSize_ = getLe<uint32_t>(header.data() +  8);
+		root_      = getLe<uint32_t>(header.data() + 12);
+		dataSize_  = getLe<uint64_t>(header.data() + 16);
+		uint64_t leafCount = getLe<uint64_t>(header.data() + 24);
+		if((blockSize_ == 0) || (leafCount != (dataSize_ + blockSize_ - 1) / blockSize_)) {
+			throw IntegrityException('"' + path + "\" has a malformed header"); }
+		uint64_t offset = IntegrityIndex::HEADER_SIZE;
+		for(uint64_t size = leafCount; size > 0; size = (size == 1)? 0 : (size + 1) / 2) {
+			levelOffsets_.push_back(offset);
+			levelSizes_.push_back(size);
+			offset += size * 4;
+		}
+		file_.exceptions(std::ios_base::badbit);
+	}
+
+
+	std::vector<uint32_t> IndexReader::readNodes_(unsigned level, uint64_t first, uint64_t last) {
+		assert(last <= levelSizes_[level]);
+		std::vector<char> buffer((last - first) * 4);
+		file_.clear();
+		file_.seekg(levelOffsets_[level] + (first * 4));
+		if(! file_.read(buffer.data(), buffer.size())) {
+			throw IntegrityException('"' + name_ + "\" is truncated"); }
+		std::vector<uint32_t> r(last - first);
+		for(size_t i=0; i < r.size(); ++i) {
+			r[i] = getLe<uint32_t>(buffer.data() + (i * 4)); }
+		return r;
+	}
+
+
+	std::vector<uint32_t> IndexReader::verifiedLeaves(uint64_t first, uint64_t last) {
+		if(first >= last) return { };
+		std::vector<uint32_t> r = readNodes_(0, first, last);
+		/* Widen the range so that it covers whole sibling pairs, compute
+		 * their parents, and compare them with the stored ones: once the
+		 * top level is reached, the range is the root. */
+		uint64_t lo = first, hi = last;
+		for(unsigned level = 0; level + 1 < levelSizes_.size(); ++level) {
+			uint64_t wideLo = lo & ~uint64_t(1);
+			uint64_t wideHi = std::min(levelSizes_[level], (hi + 1) & ~uint64_t(1));
+			auto nodes = readNodes_(level, wideLo, wideHi);
+			auto computed = parentLevel(nodes);
+			auto stored = readNodes_(level + 1, wideLo / 2, (wideHi + 1) / 2);
+			if(computed != stored) {
+				throw IntegrityException('"' + name_ + "\" is corrupted"); }
+			lo = wideLo / 2;
+			hi = (wideHi + 1) / 2;
+		}
+		if(readNodes_(levelSizes_.size() - 1, 0, 1).front() != root_) {
+			throw IntegrityException('"' + name_ + "\" is corrupted"); }
+		return r;
+	}
+
+
+	std::optional<uint64_t> verifyShare(std::istream& share, IndexReader& index, uint64_t begin, uint64_t end) {
+		const uint64_t blockSize = index.blockSize();
+		end = std::min(end, index.dataSize());
+		if(begin >= end) return std::nullopt;
+		uint64_t firstBlock = begin / blockSize;
+		uint64_t lastBlock = (end + blockSize - 1) / blockSize;
+		std::vector<char> buffer(blockSize);
+		/* Leaves are fetched in groups, so that huge ranges don't need
+		 * the whole index in memory. */
+		constexpr uint64_t leafGroup = 4096;
+		for(uint64_t groupFirst = firstBlock; groupFirst < lastBlock; groupFirst += leafGroup) {
+			uint64_t groupLast = std::min(lastBlock, groupFirst + leafGroup);
+			auto leaves = index.verifiedLeaves(groupFirst, groupLast);
+			share.clear();
+			share.seekg(groupFirst * blockSize);
+			for(uint64_t block = groupFirst; block < groupLast; ++block) {
+				uint64_t offset = block * blockSize;
+				size_t len = std::min(blockSize, index.dataSize() - offset);
+				share.read(buffer.data(), len);
+				if((size_t(share.gcount()) != len) || (crc32c(0, buffer.data(), len) != leaves[block - groupFirst])) {
+					return offset; }
+			}
+		}
+		return std::nullopt;
+	}
+
+
+
+	IndexBuilder::IndexBuilder(uint32_t blockSize):
+			index_ { blockSize, 0, { } },
+			blockCrc_(0),
+			blockFill_(0)
+	{ }
+
+
+	void IndexBuilder::update(const void* data, size_t size) {
+		auto cursor = reinterpret_cast<const char*>(data);
+		index_.dataSize += size;
+		while(size > 0) {
+			size_t n = std::min<size_t>(size, index_.blockSize - blockFill_);
+			blockCrc_ = crc32c(blockCrc_, cursor, n);
+			blockFill_ += n;
+			cursor += n;
+			size -= n;
+			if(blockFill_ == index_.blockSize) {
+				index_.leaves.push_back(blockCrc_);
+				blockCrc_ = 0;
+				blockFill_ = 0;
+			}
+		}
+	}
+
+
+	const IntegrityIndex& IndexBuilder::finish() {
+		if(blockFill_ > 0) {
+			index_.leaves.push_back(blockCrc_);
+			blockCrc_ = 0;
+			blockFill_ = 0;
+		}
+		return index_;
+	}
+
+
+
+	IndexingOutputBuf::IndexingOutputBuf(std::ostream& dst, uint32_t blockSize):
+			dst_(&dst),
+			buffer_(blockSize),
+			builder_(blockSize)
+	{
+		setp(buffer_.data(), buffer_.data() + buffer_.size());
+	}
+
+
+	void IndexingOutputBuf::forward_() {
+		/* The buffer may be flushed before being full, so blocks are not
+		 * necessarily aligned with it; the builder takes care of that. */
+		size_t size = pptr() - pbase();
+		dst_->write(pbase(), size);
+		builder_.update(pbase(), size);
+		setp(buffer_.data(), buffer_.data() + buffer_.size());
+	}
+
+
+	IndexingOutputBuf::int_type IndexingOutputBuf::overflow(int_type c) {
+		forward_();
+		if(! traits_type::eq_int_type(c, traits_type::eof())) {
+			*pptr() = traits_type::to_char_type(c);
+			pbump(1);
+		}
+		return traits_type::not_eof(c);
+	}
+
+
+	int IndexingOutputBuf::sync() {
+		forward_();
+		dst_->flush();
+		return dst_->good()? 0 : -1;
+	}
+
+
+	const IntegrityIndex& IndexingOutputBuf::finish() {
+		forward_();
+		dst_->flush();
+		return builder_.finish();
+	}
+
+}
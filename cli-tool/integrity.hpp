@@ -0,0 +1,172 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <ostream>
+#include <streambuf>
+#include <optional>
+#include <stdexcept>
+#include <cstdint>
+
+
+
+namespace xorinator::integrity {
+
+	constexpr uint32_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+	/** Version of the integrity index format written by this build. */
+	constexpr uint8_t FORMAT_VERSION = 1;
+
+	/** Identifier of the CRC32C (Castagnoli) hash function. */
+	constexpr uint8_t HASH_CRC32C = 1;
+
+
+	class IntegrityException : public std::runtime_error {
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+
+	/** Updates a CRC32C checksum, using the SSE4.2 instruction
+	 * when available. */
+	uint32_t crc32c(uint32_t crc, const void* data, size_t size);
+
+	/** Hashes two sibling nodes of an integrity tree into their parent. */
+	uint32_t hashNodes(uint32_t left, uint32_t right);
+
+
+	/** The integrity index of a share: a tree of CRC32C hashes, whose
+	 * leaves are the hashes of fixed-size blocks of the share.
+	 * Every node is the hash of its two children, or a copy of its only
+	 * child; the index file stores the root, then every level of the
+	 * tree from the leaves up, so that single leaves can be checked
+	 * against the root without reading the whole index. */
+	struct IntegrityIndex {
+		static constexpr size_t HEADER_SIZE = 32;
+
+		uint32_t blockSize;
+		uint64_t dataSize;
+		std::vector<uint32_t> leaves;
+
+		/** The path of the index file of the given share. */
+		static std::string pathFor(const std::string& sharePath);
+
+		void write(std::ostream&) const;
+	};
+
+
+	/** Reads the nodes of an index file on demand. */
+	class IndexReader {
+	private:
+		std::ifstream file_;
+		std::string name_;
+		std::vector<uint64_t> levelOffsets_;
+		std::vector<uint64_t> levelSizes_;
+		uint32_t blockSize_;
+		uint32_t root_;
+		uint64_t dataSize_;
+
+		std::vector<uint32_t> readNodes_(unsigned level, uint64_t first, uint64_t last);
+
+	public:
+		/** Opens the index file at the given path, throwing an
+		 * IntegrityException if it is missing or malformed. */
+		explicit IndexReader(const std::string& path);
+
+		uint32_t blockSize() const { return blockSize_; }
+		uint64_t dataSize() const { return dataSize_; }
+		uint64_t leafCount() const { return levelSizes_.empty()? 0 : levelSizes_.front(); }
+
+		/** Reads the leaves in [first, last), and checks them against the
+		 * root by reading only the tree nodes above them.
+		 * Throws an IntegrityException if the index itself is corrupted. */
+		std::vector<uint32_t> verifiedLeaves(uint64_t first, uint64_t last);
+	};
+
+
+	/** Checks the blocks of a share that overlap with the byte range
+	 * [begin, end) against its index, reading nothing else.
+	 * Returns the offset of the first corrupted block, if any. */
+	std::optional<uint64_t> verifyShare(std::istream& share, IndexReader&, uint64_t begin, uint64_t end);
+
+
+	/** Computes the integrity index of data that is given in pieces
+	 * of any size. */
+	class IndexBuilder {
+	private:
+		IntegrityIndex index_;
+		uint32_t blockCrc_;
+		uint32_t blockFill_;
+
+	public:
+		explicit IndexBuilder(uint32_t blockSize = DEFAULT_BLOCK_SIZE);
+
+		void update(const void* data, size_t size);
+
+		/** Hashes the last partial block, and returns the complete index. */
+		const IntegrityIndex& finish();
+	};
+
+
+	/** A stream buffer that forwards everything to another stream,
+	 * computing the integrity index of the written data on the fly. */
+	class IndexingOutputBuf : public std::streambuf {
+	private:
+		std::ostream* dst_;
+		std::vector<char> buffer_;
+		IndexBuilder builder_;
+
+		void forward_();
+
+	protected:
+		int_type overflow(int_type) override;
+		int sync() override;
+
+	public:
+		IndexingOutputBuf(std::ostream& dst, uint32_t blockSize);
+
+		IndexingOutputBuf(IndexingOutputBuf&&) = delete;
+
+		/** Flushes the buffered data and returns the complete index. */
+		const IntegrityIndex& finish();
+	};
+
+
+	/** A std::ostream that computes the integrity index of its content. */
+	class IndexingOStream : public std::ostream {
+	private:
+		IndexingOutputBuf buf_;
+
+	public:
+		IndexingOStream(std::ostream& dst, uint32_t blockSize = DEFAULT_BLOCK_SIZE):
+				std::ostream(nullptr),
+				buf_(dst, blockSize)
+		{
+			rdbuf(&buf_);
+		}
+
+		const IntegrityIndex& finish() { return buf_.finish(); }
+	};
+
+}
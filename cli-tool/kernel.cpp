@@ -0,0 +1,91 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#include "kernel.hpp"
+
+#include <array>
+#include <utility>
+#include <cstring>
+#include <algorithm>
+
+
+
+namespace {
+
+	using Kernel = void (*)(uint8_t*, const uint8_t* const*, size_t);
+
+
+	template<size_t count>
+	void xorBlocksN(uint8_t* dst, const uint8_t* const* srcsPtr, size_t size) {
+		static_assert(count > 0);
+		std::array<const uint8_t*, count> srcs;
+		std::copy_n(srcsPtr, count, srcs.begin());
+		size_t i = 0;
+		for(; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+			uint64_t acc;
+			std::memcpy(&acc, srcs[0] + i, sizeof(uint64_t));
+			[&]<size_t... s>(std::index_sequence<s...>) {
+				uint64_t word;
+				((std::memcpy(&word, srcs[s + 1] + i, sizeof(uint64_t)), acc ^= word), ...);
+			}(std::make_index_sequence<count - 1>());
+			std::memcpy(dst + i, &acc, sizeof(uint64_t));
+		}
+		for(; i < size; ++i) {
+			uint8_t acc = srcs[0][i];
+			for(size_t s=1; s < count; ++s) {
+				acc ^= srcs[s][i]; }
+			dst[i] = acc;
+		}
+	}
+
+
+	constexpr auto kernels = []<size_t... n>(std::index_sequence<n...>) {
+		return std::array<Kernel, sizeof...(n)> { &xorBlocksN<n + 1>... };
+	}(std::make_index_sequence<xorinator::kernel::MAX_UNROLLED_SOURCES>());
+
+}
+
+
+
+namespace xorinator::kernel {
+
+	void xorBlocks(uint8_t* dst, const uint8_t* const* srcs, size_t count, size_t size) {
+		if(count == 0) {
+			std::fill_n(dst, size, 0);
+			return;
+		}
+		size_t group = std::min(count, MAX_UNROLLED_SOURCES);
+		kernels[group - 1](dst, srcs, size);
+		srcs += group;
+		count -= group;
+		/* The rest of the sources are folded into `dst` in groups, that
+		 * have `dst` itself as their first source. */
+		std::array<const uint8_t*, MAX_UNROLLED_SOURCES> withDst;
+		withDst[0] = dst;
+		while(count > 0) {
+			group = std::min(count, MAX_UNROLLED_SOURCES - 1);
+			std::copy_n(srcs, group, withDst.begin() + 1);
+			kernels[group](dst, withDst.data(), size);
+			srcs += group;
+			count -= group;
+		}
+	}
+
+}
@@ -0,0 +1,42 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+
+
+/** XOR kernels that combine the blocks of several shares in a single
+ * pass; they are instantiated at compile time for every share count up
+ * to MAX_UNROLLED_SOURCES, so that the source pointers are kept in
+ * registers and the inner loop is unrolled, and larger counts are
+ * handled in groups. */
+namespace xorinator::kernel {
+
+	constexpr size_t MAX_UNROLLED_SOURCES = 8;
+
+	/** Stores `srcs[0][i] ^ srcs[1][i] ^ ... ^ srcs[count-1][i]` into
+	 * `dst[i]` for every `i < size`; `dst` may be one of the sources,
+	 * but must not overlap them otherwise. */
+	void xorBlocks(uint8_t* dst, const uint8_t* const* srcs, size_t count, size_t size);
+
+}
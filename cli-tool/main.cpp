@@ -22,6 +22,12 @@
 
 #include "clparser.hpp"
 #include "runtime.hpp"
+#include "container.hpp"
+#include "integrity.hpp"
+#include "compress.hpp"
+#include "reservoir.hpp"
+#include "checkpoint.hpp"
+#include "server.hpp"
 
 
 
@@ -29,6 +35,12 @@ int main(int argc, char** argv) {
 	using xorinator::cli::CommandLine;
 	using xorinator::cli::InvalidCommandLineException;
 	using xorinator::runtime::FilePermissionException;
+	using xorinator::container::ContainerFormatException;
+	using xorinator::integrity::IntegrityException;
+	using xorinator::compress::CompressionFormatException;
+	using xorinator::reservoir::ReservoirException;
+	using xorinator::checkpoint::JournalException;
+	using xorinator::server::ServerException;
 	#define IF_QUIET if(! (cmdln.options & xorinator::cli::OptionBits::eQuiet))
 	#define PRINT_EX(EX_) "[" #EX_ "] " << ex.what() << '.'
 	#define CATCH_EX(EX_) catch(EX_& ex) { \
@@ -38,6 +50,8 @@ int main(int argc, char** argv) {
 	CommandLine cmdln;
 	try {
 		cmdln = CommandLine(argc, argv);
+		if((! cmdln.socketPath.empty()) && (cmdln.cmdType != xorinator::cli::CmdType::eServe)) {
+			return xorinator::server::runRemote(cmdln, argc, argv); }
 		return xorinator::runtime::run(cmdln)? EXIT_SUCCESS : EXIT_FAILURE;
 	}
 	catch(FilePermissionException& ex) {
@@ -47,6 +61,12 @@ int main(int argc, char** argv) {
 			<< std::endl;
 	}
 	CATCH_EX(InvalidCommandLineException)
+	CATCH_EX(ContainerFormatException)
+	CATCH_EX(IntegrityException)
+	CATCH_EX(CompressionFormatException)
+	CATCH_EX(ReservoirException)
+	CATCH_EX(JournalException)
+	CATCH_EX(ServerException)
 	CATCH_EX(std::exception)
 	return EXIT_FAILURE;
 	#undef CATCH_EX
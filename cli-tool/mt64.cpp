@@ -0,0 +1,235 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#include "mt64.hpp"
+#include "cpu.hpp"
+
+#ifdef XORINATOR_X86_DISPATCH
+	#include <immintrin.h>
+#endif
+
+
+
+namespace {
+
+	using xorinator::mt64::STATE_WORDS;
+
+	constexpr size_t SHIFT_WORDS = 156;
+	constexpr uint64_t MATRIX_A = 0xb5026f5aa96619e9;
+	constexpr uint64_t UPPER_MASK = 0xffffffff80000000;
+	constexpr uint64_t LOWER_MASK = 0x000000007fffffff;
+	constexpr uint64_t INIT_MULTIPLIER = 6364136223846793005;
+
+	constexpr uint64_t TEMPER_D = 0x5555555555555555;
+	constexpr uint64_t TEMPER_B = 0x71d67fffeda60000;
+	constexpr uint64_t TEMPER_C = 0xfff7eee000000000;
+
+
+	/** The pointers to the words that regenerate the word `j` of every
+	 * lane: the same order as the reference implementation, where the
+	 * words after STATE_WORDS - SHIFT_WORDS are computed from the ones
+	 * that were just regenerated. */
+	struct Stripe {
+		uint64_t* cur;
+		const uint64_t* next;
+		const uint64_t* shifted;
+		uint64_t* out;
+
+		Stripe(uint64_t* state, uint64_t* outState, size_t j, size_t lanes):
+				cur(state + (j * lanes)),
+				next(state + ((j + 1 < STATE_WORDS? j + 1 : 0) * lanes)),
+				shifted(state + ((j < SHIFT_WORDS? j + SHIFT_WORDS : j - SHIFT_WORDS) * lanes)),
+				out(outState + (j * lanes))
+		{ }
+	};
+
+
+	inline uint64_t twistWord(uint64_t current, uint64_t next, uint64_t shifted) {
+		uint64_t y = (current & UPPER_MASK) | (next & LOWER_MASK);
+		return shifted ^ (y >> 1) ^ ((y & 1)? MATRIX_A : 0);
+	}
+
+
+	inline uint64_t temper(uint64_t y) {
+		y ^= (y >> 29) & TEMPER_D;
+		y ^= (y << 17) & TEMPER_B;
+		y ^= (y << 37) & TEMPER_C;
+		y ^= (y >> 43);
+		return y;
+	}
+
+
+	/** Twists and tempers the lanes of a stripe from `from` onward. */
+	inline void twistStripeScalar(const Stripe& s, size_t from, size_t lanes) {
+		for(size_t l = from; l < lanes; ++l) {
+			s.cur[l] = twistWord(s.cur[l], s.next[l], s.shifted[l]);
+			s.out[l] = temper(s.cur[l]);
+		}
+	}
+
+
+	void twistLanesScalar(uint64_t* state, uint64_t* out, size_t lanes) {
+		for(size_t j=0; j < STATE_WORDS; ++j) {
+			twistStripeScalar(Stripe(state, out, j, lanes), 0, lanes); }
+	}
+
+
+	#ifdef XORINATOR_X86_DISPATCH
+
+		/** Four lanes per operation: an MT19937-64 word is a 64-bit
+		 * element, and every operation of the twist and the tempering
+		 * is a plain bitwise operation or a 64-bit shift. */
+		__attribute__((target("avx2")))
+		void twistLanesAvx2(uint64_t* state, uint64_t* out, size_t lanes) {
+			const __m256i upper = _mm256_set1_epi64x(UPPER_MASK);
+			const __m256i lower = _mm256_set1_epi64x(LOWER_MASK);
+			const __m256i matrix = _mm256_set1_epi64x(MATRIX_A);
+			const __m256i one = _mm256_set1_epi64x(1);
+			const __m256i zero = _mm256_setzero_si256();
+			const __m256i td = _mm256_set1_epi64x(TEMPER_D);
+			const __m256i tb = _mm256_set1_epi64x(TEMPER_B);
+			const __m256i tc = _mm256_set1_epi64x(TEMPER_C);
+			for(size_t j=0; j < STATE_WORDS; ++j) {
+				auto s = Stripe(state, out, j, lanes);
+				size_t l = 0;
+				for(; l + 4 <= lanes; l += 4) {
+					__m256i cur = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s.cur + l));
+					__m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s.next + l));
+					__m256i shifted = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s.shifted + l));
+					__m256i y = _mm256_or_si256(_mm256_and_si256(cur, upper), _mm256_and_si256(next, lower));
+					__m256i odd = _mm256_sub_epi64(zero, _mm256_and_si256(y, one));
+					y = _mm256_xor_si256(shifted, _mm256_xor_si256(_mm256_srli_epi64(y, 1), _mm256_and_si256(odd, matrix)));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(s.cur + l), y);
+					y = _mm256_xor_si256(y, _mm256_and_si256(_mm256_srli_epi64(y, 29), td));
+					y = _mm256_xor_si256(y, _mm256_and_si256(_mm256_slli_epi64(y, 17), tb));
+					y = _mm256_xor_si256(y, _mm256_and_si256(_mm256_slli_epi64(y, 37), tc));
+					y = _mm256_xor_si256(y, _mm256_srli_epi64(y, 43));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(s.out + l), y);
+				}
+				twistStripeScalar(s, l, lanes);
+			}
+		}
+
+		/* The unmasked 512-bit immediate shifts trip GCC's
+		 * -Wmaybe-uninitialized on their undefined passthrough operand;
+		 * the zero-masked ones with a full mask are the same operation. */
+		__attribute__((target("avx512f")))
+		inline __m512i srli512(__m512i v, unsigned n) {
+			return _mm512_maskz_srli_epi64(0xff, v, n); }
+
+		__attribute__((target("avx512f")))
+		inline __m512i slli512(__m512i v, unsigned n) {
+			return _mm512_maskz_slli_epi64(0xff, v, n); }
+
+		/** Eight lanes per operation, which are all the engines of a
+		 * 512-bit key. */
+		__attribute__((target("avx512f")))
+		void twistLanesAvx512(uint64_t* state, uint64_t* out, size_t lanes) {
+			const __m512i upper = _mm512_set1_epi64(UPPER_MASK);
+			const __m512i lower = _mm512_set1_epi64(LOWER_MASK);
+			const __m512i matrix = _mm512_set1_epi64(MATRIX_A);
+			const __m512i one = _mm512_set1_epi64(1);
+			const __m512i zero = _mm512_setzero_si512();
+			const __m512i td = _mm512_set1_epi64(TEMPER_D);
+			const __m512i tb = _mm512_set1_epi64(TEMPER_B);
+			const __m512i tc = _mm512_set1_epi64(TEMPER_C);
+			for(size_t j=0; j < STATE_WORDS; ++j) {
+				auto s = Stripe(state, out, j, lanes);
+				size_t l = 0;
+				for(; l + 8 <= lanes; l += 8) {
+					__m512i cur = _mm512_loadu_si512(s.cur + l);
+					__m512i next = _mm512_loadu_si512(s.next + l);
+					__m512i shifted = _mm512_loadu_si512(s.shifted + l);
+					__m512i y = _mm512_or_si512(_mm512_and_si512(cur, upper), _mm512_and_si512(next, lower));
+					__m512i odd = _mm512_sub_epi64(zero, _mm512_and_si512(y, one));
+					y = _mm512_xor_si512(shifted, _mm512_xor_si512(srli512(y, 1), _mm512_and_si512(odd, matrix)));
+					_mm512_storeu_si512(s.cur + l, y);
+					y = _mm512_xor_si512(y, _mm512_and_si512(srli512(y, 29), td));
+					y = _mm512_xor_si512(y, _mm512_and_si512(slli512(y, 17), tb));
+					y = _mm512_xor_si512(y, _mm512_and_si512(slli512(y, 37), tc));
+					y = _mm512_xor_si512(y, srli512(y, 43));
+					_mm512_storeu_si512(s.out + l, y);
+				}
+				twistStripeScalar(s, l, lanes);
+			}
+		}
+
+	#endif
+
+}
+
+
+
+namespace xorinator::mt64 {
+
+	void seedLanes(uint64_t* state, const uint64_t* seeds, size_t lanes) {
+		for(size_t l=0; l < lanes; ++l) {
+			state[l] = seeds[l]; }
+		for(size_t j=1; j < STATE_WORDS; ++j) {
+			const uint64_t* prev = state + ((j-1) * lanes);
+			uint64_t* cur = state + (j * lanes);
+			for(size_t l=0; l < lanes; ++l) {
+				cur[l] = (INIT_MULTIPLIER * (prev[l] ^ (prev[l] >> 62))) + j; }
+		}
+	}
+
+
+	void twistLanes(uint64_t* state, uint64_t* out, size_t lanes) {
+		twistLanes(state, out, lanes, bestKernel());
+	}
+
+
+	void twistLanes(uint64_t* state, uint64_t* out, size_t lanes, Kernel kernel) {
+		switch(kernel) {
+			#ifdef XORINATOR_X86_DISPATCH
+				case Kernel::eAvx512:
+					if(lanes >= 8) {
+						twistLanesAvx512(state, out, lanes);
+						return;
+					}
+					[[fallthrough]];
+				case Kernel::eAvx2:
+					twistLanesAvx2(state, out, lanes);
+					return;
+			#endif
+			default:
+				twistLanesScalar(state, out, lanes);
+				return;
+		}
+	}
+
+
+	Kernel bestKernel() {
+		if(cpu::hasAvx512f()) return Kernel::eAvx512;
+		if(cpu::hasAvx2()) return Kernel::eAvx2;
+		return Kernel::eScalar;
+	}
+
+
+	bool kernelSupported(Kernel kernel) {
+		switch(kernel) {
+			case Kernel::eScalar: return true;
+			case Kernel::eAvx2: return cpu::hasAvx2();
+			case Kernel::eAvx512: return cpu::hasAvx512f();
+		}
+		return false;
+	}
+
+}
@@ -0,0 +1,119 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+
+
+
+/** MT19937-64 engines stepped in lockstep: the engines are the "lanes"
+ * of a single interleaved state, where word `j` of lane `l` is stored at
+ * `j * lanes + l`, so that every step of the generation touches one
+ * contiguous stripe for all the engines. Every lane produces the same
+ * sequence as a std::mt19937_64 with the same seed. */
+namespace xorinator::mt64 {
+
+	constexpr size_t STATE_WORDS = 312;
+
+	/** Seeds every lane of an interleaved state, like the
+	 * `std::mt19937_64(seed)` constructor. */
+	void seedLanes(uint64_t* state, const uint64_t* seeds, size_t lanes);
+
+	/** The implementations of twistLanes: they only differ in how many
+	 * lanes are processed by each operation, and their results are
+	 * always identical. */
+	enum class Kernel { eScalar, eAvx2, eAvx512 };
+
+	/** Regenerates the interleaved state of every lane, and stores the
+	 * next STATE_WORDS tempered outputs of every lane into `out`, with
+	 * the same layout. */
+	void twistLanes(uint64_t* state, uint64_t* out, size_t lanes);
+
+	/** Like `twistLanes(state, out, lanes)`, with a specific kernel that
+	 * must be supported by the CPU; used for testing. */
+	void twistLanes(uint64_t* state, uint64_t* out, size_t lanes, Kernel);
+
+	/** The kernel used by `twistLanes(state, out, lanes)`. */
+	Kernel bestKernel();
+
+	bool kernelSupported(Kernel);
+
+
+	/** A set of MT19937-64 lanes; if `laneCount` is not 0 the number of
+	 * lanes is fixed, and the state is stored inline (so that copies
+	 * don't allocate), otherwise it is given to the constructor. */
+	template<size_t laneCount = 0>
+	class LockstepEngine {
+	private:
+		using Storage = std::conditional_t<(laneCount > 0),
+			std::array<uint64_t, STATE_WORDS * laneCount>,
+			std::vector<uint64_t>>;
+
+		Storage state_;
+		Storage out_;
+		size_t lanes_;
+		size_t index_;
+
+	public:
+		LockstepEngine(): state_(), out_(), lanes_(laneCount), index_(STATE_WORDS) { }
+
+		LockstepEngine(const uint64_t* seeds, size_t lanes = laneCount):
+				lanes_(lanes),
+				index_(STATE_WORDS)
+		{
+			if constexpr(laneCount == 0) {
+				state_.resize(STATE_WORDS * lanes);
+				out_.resize(STATE_WORDS * lanes);
+			}
+			seedLanes(state_.data(), seeds, lanes_);
+		}
+
+		size_t lanes() const { return lanes_; }
+
+		/** Returns the next value of every lane. */
+		const uint64_t* next() {
+			if(index_ >= STATE_WORDS) {
+				twistLanes(state_.data(), out_.data(), lanes_);
+				index_ = 0;
+			}
+			return out_.data() + ((index_++) * lanes_);
+		}
+
+		/** Skips the next `count` values of every lane. */
+		void discard(uint64_t count) {
+			while(count > 0) {
+				if(index_ >= STATE_WORDS) {
+					twistLanes(state_.data(), out_.data(), lanes_);
+					index_ = 0;
+				}
+				uint64_t skip = std::min<uint64_t>(count, STATE_WORDS - index_);
+				index_ += skip;
+				count -= skip;
+			}
+		}
+	};
+
+}
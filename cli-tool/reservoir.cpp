@@ -0,0 +1,184 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#include "reservoir.hpp"
+
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+
+#ifdef XORINATOR_POSIX_IO
+	extern "C" {
+		#include <fcntl.h>
+		#include <unistd.h>
+		#include <sys/stat.h>
+		#include <sys/file.h>
+	}
+#endif
+
+
+
+namespace {
+
+	using xorinator::reservoir::ReservoirException;
+
+
+	[[noreturn]] void throwErrno(const std::string& what, const std::string& path) {
+		throw ReservoirException(what + " \"" + path + "\": " + std::strerror(errno)); }
+
+
+	#ifdef XORINATOR_POSIX_IO
+
+		/** Holds an exclusive lock on a file descriptor. */
+		class FileLock {
+		private:
+			int fd_;
+
+		public:
+			FileLock(int fd, const std::string& path): fd_(fd) {
+				while(0 != ::flock(fd_, LOCK_EX)) {
+					if(errno != EINTR)  throwErrno("could not lock", path); }
+			}
+
+			~FileLock() { ::flock(fd_, LOCK_UN); }
+		};
+
+
+		uint64_t readJournal(int fd, const std::string& path) {
+			unsigned char buffer[8];
+			auto rd = ::pread(fd, buffer, sizeof(buffer), 0);
+			if(rd < 0)  throwErrno("could not read", path);
+			if(rd == 0)  return 0;
+			if(rd != sizeof(buffer))  throw ReservoirException("malformed reservoir journal \"" + path + '"');
+			uint64_t r = 0;
+			for(unsigned i=0; i < sizeof(buffer); ++i) {
+				r = r | (uint64_t(buffer[i]) << (i * 8)); }
+			return r;
+		}
+
+
+		void writeJournal(int fd, const std::string& path, uint64_t offset) {
+			unsigned char buffer[8];
+			for(unsigned i=0; i < sizeof(buffer); ++i) {
+				buffer[i] = offset >> (i * 8); }
+			if(sizeof(buffer) != ::pwrite(fd, buffer, sizeof(buffer), 0))  throwErrno("could not write", path);
+			if(0 != ::fsync(fd))  throwErrno("could not sync", path);
+		}
+
+	#endif
+
+}
+
+
+
+namespace xorinator::reservoir {
+
+	std::string journalPath(const std::string& reservoirPath) {
+		return reservoirPath + ".journal"; }
+
+
+	#ifdef XORINATOR_POSIX_IO
+
+		Reservoir::Reservoir(const std::string& path):
+				path_(path),
+				fd_(-1),
+				journalFd_(-1)
+		{
+			fd_ = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+			if(fd_ < 0)  throwErrno("could not open the pad reservoir", path);
+			journalFd_ = ::open(journalPath(path).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+			if(journalFd_ < 0) {
+				::close(fd_);
+				throwErrno("could not open the journal of", path);
+			}
+		}
+
+
+		Reservoir::~Reservoir() {
+			::close(journalFd_);
+			::close(fd_);
+		}
+
+
+		Reservoir::Region Reservoir::reserve(uint64_t size) {
+			auto lock = FileLock(journalFd_, journalPath(path_));
+			uint64_t offset = readJournal(journalFd_, journalPath(path_));
+			struct stat statResult;
+			if(0 != ::fstat(fd_, &statResult))  throwErrno("could not stat", path_);
+			uint64_t end = statResult.st_size;
+			if(offset >= end)  return { offset, 0 };
+			size = std::min(size, end - offset);
+			writeJournal(journalFd_, journalPath(path_), offset + size);
+			return { offset, size };
+		}
+
+
+		void Reservoir::read(uint64_t offset, void* dst, size_t size) {
+			auto* cursor = reinterpret_cast<char*>(dst);
+			while(size > 0) {
+				auto rd = ::pread(fd_, cursor, size, offset);
+				if(rd < 0) {
+					if(errno == EINTR)  continue;
+					throwErrno("could not read", path_);
+				}
+				if(rd == 0)  throw ReservoirException("the pad reservoir \"" + path_ + "\" was truncated");
+				cursor += rd;
+				offset += rd;
+				size -= rd;
+			}
+		}
+
+
+		void Reservoir::discard(const Region& region) noexcept {
+			#ifdef __linux__
+				if(region.size > 0) {
+					::fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, region.offset, region.size); }
+			#else
+				(void) region;
+			#endif
+		}
+
+
+		uint64_t Reservoir::available() {
+			auto lock = FileLock(journalFd_, journalPath(path_));
+			uint64_t offset = readJournal(journalFd_, journalPath(path_));
+			struct stat statResult;
+			if(0 != ::fstat(fd_, &statResult))  throwErrno("could not stat", path_);
+			return (uint64_t(statResult.st_size) > offset)? statResult.st_size - offset : 0;
+		}
+
+	#else
+
+		Reservoir::Reservoir(const std::string& path): path_(path), fd_(-1), journalFd_(-1) {
+			throw ReservoirException("pad reservoirs are not supported on this platform"); }
+
+		Reservoir::~Reservoir() { }
+
+		Reservoir::Region Reservoir::reserve(uint64_t) { return { 0, 0 }; }
+
+		void Reservoir::read(uint64_t, void*, size_t) { }
+
+		void Reservoir::discard(const Region&) noexcept { }
+
+		uint64_t Reservoir::available() { return 0; }
+
+	#endif
+
+}
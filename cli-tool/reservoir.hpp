@@ -0,0 +1,89 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#pragma once
+
+#include <string>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+
+
+
+/** A pad reservoir is a file of random data generated in advance, from
+ * which multiplexing operations take their one-time pads instead of
+ * generating them.
+ *
+ * The reservoir "FILE" comes with the journal "FILE.journal", holding
+ * the offset of the first byte that was never handed out as a 64-bit
+ * little-endian integer; regions are reserved by advancing the offset
+ * while holding an exclusive lock on the journal, so concurrent
+ * processes never get overlapping regions, and no region is handed
+ * out twice even if a process crashes after reserving it. */
+namespace xorinator::reservoir {
+
+	class ReservoirException : public std::runtime_error {
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+
+	/** Returns the path of the journal of the given reservoir. */
+	std::string journalPath(const std::string& reservoirPath);
+
+
+	class Reservoir {
+	public:
+		struct Region {
+			uint64_t offset;
+			uint64_t size;
+		};
+
+	private:
+		std::string path_;
+		int fd_;
+		int journalFd_;
+
+	public:
+		/** Opens an existing reservoir, creating its journal if it
+		 * doesn't exist yet. */
+		Reservoir(const std::string& path);
+		~Reservoir();
+
+		Reservoir(const Reservoir&) = delete;
+		Reservoir& operator=(const Reservoir&) = delete;
+
+		/** Atomically reserves up to `size` bytes that were never
+		 * reserved before; the returned region is empty if the
+		 * reservoir is exhausted. */
+		Region reserve(uint64_t size);
+
+		/** Reads `size` bytes of a reserved region. */
+		void read(uint64_t offset, void* dst, size_t size);
+
+		/** Deallocates a consumed region, so that the reservoir doesn't
+		 * keep a copy of it; this is a no-op where unsupported. */
+		void discard(const Region&) noexcept;
+
+		/** Returns the number of bytes that were never reserved. */
+		uint64_t available();
+	};
+
+}
@@ -21,33 +21,78 @@
 #include <iostream>
 #include <random>
 #include <cassert>
+#include <utility>
+#include <algorithm>
 #include <unordered_set>
+#include <filesystem>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <bit>
+#include <cstring>
 
 #ifdef XORINATOR_UNIX_PERM_CHECK
 	#include <cerrno>
 	extern "C" {
 		#include <sys/stat.h>
 		#include <unistd.h>
+		#include <fcntl.h>
+	}
+#endif
+
+#ifdef XORINATOR_POSIX_IO
+	extern "C" {
+		#include <fcntl.h>
+		#include <unistd.h>
+		#include <sys/stat.h>
+		#ifdef __linux__
+			#include <sys/sysmacros.h>
+		#endif
 	}
 #endif
 
 #include "runtime.hpp"
+#include "scheduler.hpp"
+#include "container.hpp"
+#include "integrity.hpp"
+#include "delta.hpp"
+#include "sha256.hpp"
+#include "blockio.hpp"
+#include "gf256.hpp"
+#include "compress.hpp"
+#include "reservoir.hpp"
+#include "checkpoint.hpp"
+#include "server.hpp"
+#include "fdstream.hpp"
+#include "kernel.hpp"
 
 using xorinator::cli::CommandLine;
 using xorinator::cli::CmdType;
 using xorinator::cli::InvalidCommandLineException;
+using xorinator::cli::Durability;
 using xorinator::StaticVector;
+using xorinator::Sha256;
 
 using Rng = std::mt19937_64;
 using RngKey = xorinator::RngKey<512>;
+using RngKeyStream = xorinator::RngKeyStream<512>;
 using StreamKey = xorinator::StreamKey;
 
 
 
 namespace {
 
-	/** Reset a RngAdapter instance after RNG_RESET_AFTER bytes. */
-	constexpr size_t RNG_RESET_AFTER = 4096 * sizeof(std::random_device::result_type);
+	/** Reseed a RngAdapter instance from the random device after
+	 * RNG_RESET_AFTER bytes. */
+	constexpr size_t RNG_RESET_AFTER = 1 << 20;
+
+
+	/** Returns whether the path names the standard input/output or an
+	 * inherited file descriptor, rather than a file. */
+	bool isStreamPath(const std::string& path) {
+		return (path == "-") || xorinator::runtime::parseFdPath(path).has_value(); }
 
 
 	#ifdef XORINATOR_UNIX_PERM_CHECK
@@ -59,78 +104,198 @@ namespace {
 		template<> std::string_view rwxString<02> = "write";
 		template<> std::string_view rwxString<04> = "read";
 
+		/** The supplementary groups of the process, sorted; they are
+		 * queried once, since they don't change while running. */
+		const std::vector<gid_t>& processGroups() {
+			static const std::vector<gid_t> groups = []() {
+				std::vector<gid_t> r;
+				int groupn;
+				do {
+					r.resize(std::max(::getgroups(0, nullptr), 0));
+					groupn = ::getgroups(r.size(), r.data());
+				} while((groupn < 0) && (errno == EINVAL)); // The groups changed between the two calls
+				r.resize(std::clamp<size_t>(std::max(groupn, 0), 0, r.size()));
+				std::sort(r.begin(), r.end());
+				return r;
+			} ();
+			return groups;
+		}
+
 		bool processHasGroup(gid_t fGid) {
-			constexpr auto allocGroups = [](size_t size) {
-				return reinterpret_cast<gid_t*>(operator new[](size * sizeof(gid_t)));
-			};
-			size_t bufferSize = 16;
-			gid_t* groups = allocGroups(bufferSize);
-			auto groupn = ::getgroups(bufferSize, groups);
-			while(errno != 0) {
-				assert(errno == EINVAL);
-				assert(bufferSize <= (NGROUPS_MAX / 2));
-				errno = 0;
-				operator delete[](groups);
-				bufferSize *= 2;
-				groups = allocGroups(bufferSize);
-				groupn = ::getgroups(bufferSize, groups);
-			}
-			#ifndef NDEBUG
-				/* Apparently the documentation for ::getgroups doesn't specify
-				 * whether the group IDs are ordered, but anecdotal evidence
-				 * suggests so. */
-				assert(groupn >= 0); // A negative value would not make any sense at this point
-				for(decltype(groupn) i=1; i < groupn; ++i)  assert(groups[i-1] <= groups[i]);
-			#endif
-			bool r = std::binary_search(groups, groups + groupn, fGid);
-			operator delete[](groups);
-			return r;
+			if(fGid == getegid()) return true;
+			const auto& groups = processGroups();
+			return std::binary_search(groups.begin(), groups.end(), fGid);
 		}
 
 		template<mode_t rwxBit>
-		void checkFilePermission(const std::string& path) {
+		void checkStatPermission(const struct stat& statResult, const std::string& path) {
 			static_assert(S_IRUSR == 0400);
 			static_assert(S_IRGRP == 0040);
 			static_assert(S_IROTH == 0004);
 			static_assert((rwxBit == 01) || (rwxBit == 02) | (rwxBit == 04));
-			if(path == "-") return; // This may need to be removed in the future, but for now every file named "-" is stdin/stdout
-			struct stat statResult;
-			if(0 == stat(path.c_str(), &statResult)) {
-				if(S_ISDIR(statResult.st_mode)) {
-					throw xorinator::runtime::FilePermissionException(
-						'"'+path+"\" is an existing directory");
-				}
-				uid_t prUid = geteuid();
-				gid_t prGid = getegid();
-				mode_t perm;
-				if(statResult.st_uid == prUid) {
-					perm = (statResult.st_mode >> 6) & 0007;
-				} else
-				if((statResult.st_gid == prGid) || (processHasGroup(statResult.st_gid))) {
-					perm = (statResult.st_mode >> 3) & 0007;
+			if(S_ISDIR(statResult.st_mode)) {
+				throw xorinator::runtime::FilePermissionException(
+					'"'+path+"\" is an existing directory");
+			}
+			mode_t perm;
+			if(statResult.st_uid == geteuid()) {
+				perm = (statResult.st_mode >> 6) & 0007;
+			} else
+			if(processHasGroup(statResult.st_gid)) {
+				perm = (statResult.st_mode >> 3) & 0007;
+			} else {
+				perm = statResult.st_mode & 0007;
+			}
+			if(! (perm & rwxBit)) {
+				throw xorinator::runtime::FilePermissionException(
+					"user doesn't have " + std::string(rwxString<rwxBit>) +
+					" permissions for \"" + path + '"');
+			}
+		}
+
+	#endif
+
+
+	/** A file descriptor opened by ::openChecked, so that the stream of
+	 * a path uses the very file whose permissions were checked; it is
+	 * closed when destroyed, unless it has been released to a stream. */
+	class CheckedFd {
+	private:
+		int fd_;
+		bool truncate_;
+
+	public:
+		CheckedFd(): fd_(-1), truncate_(false) { }
+
+		CheckedFd(int fd, bool truncate): fd_(fd), truncate_(truncate) { }
+
+		~CheckedFd() {
+			#ifdef XORINATOR_UNIX_PERM_CHECK
+				if(fd_ >= 0)  ::close(fd_);
+			#endif
+		}
+
+		CheckedFd(CheckedFd&& mv): fd_(mv.fd_), truncate_(mv.truncate_) { mv.fd_ = -1; }
+
+		CheckedFd& operator=(CheckedFd&& mv) {
+			std::swap(fd_, mv.fd_);
+			std::swap(truncate_, mv.truncate_);
+			return *this;
+		}
+
+		bool valid() const { return fd_ >= 0; }
+
+		/** The descriptor, for operations that only read it at explicit
+		 * offsets, and leave it owned by this object. */
+		int get() const { return fd_; }
+
+		/** Returns the descriptor, which is no longer owned by this
+		 * object; an output file is only truncated at this point (to
+		 * `keep` bytes), after every file of the operation has been
+		 * checked. */
+		int release(const std::string& path, uint64_t keep = 0) {
+			#ifdef XORINATOR_UNIX_PERM_CHECK
+				if(truncate_ && (0 != ::ftruncate(fd_, keep))) {
+					throw xorinator::runtime::FilePermissionException("could not truncate \"" + path + '"'); }
+			#else
+				(void) path;
+				(void) keep;
+			#endif
+			return std::exchange(fd_, -1);
+		}
+	};
+
+
+	#ifdef XORINATOR_POSIX_IO
+
+		/** A descriptor shared by the tasks of a parallel operation, which
+		 * only access it at explicit offsets (see ::readAt): either
+		 * borrowed from a CheckedFd, or opened once by its owner and
+		 * closed when destroyed. */
+		class SharedFd {
+		private:
+			int fd_;
+			bool owned_;
+
+		public:
+			SharedFd(): fd_(-1), owned_(false) { }
+			~SharedFd() { if(owned_ && (fd_ >= 0)) ::close(fd_); }
+
+			SharedFd(const SharedFd&) = delete;
+			SharedFd& operator=(const SharedFd&) = delete;
+
+			/** Borrows the descriptor of `checked` if it is valid, or
+			 * opens `path` with the given flags. */
+			void open(const CheckedFd& checked, const std::string& path, int flags, const char* what) {
+				if(checked.valid()) {
+					fd_ = checked.get();
+					owned_ = false;
 				} else {
-					perm = statResult.st_mode & 0007;
+					fd_ = ::open(path.c_str(), flags | O_CLOEXEC, 0666);
+					owned_ = true;
 				}
-				if(! (perm & rwxBit)) {
-					throw xorinator::runtime::FilePermissionException(
-						"user doesn't have " + std::string(rwxString<rwxBit>) +
-						" permissions for \"" + path + '"');
-				}
-			} else {
+				if(fd_ < 0) {
+					throw xorinator::runtime::FilePermissionException("could not open \"" + path + "\" for " + what); }
+			}
+
+			/** Takes the ownership of a released CheckedFd. */
+			void adopt(int fd) {
+				fd_ = fd;
+				owned_ = true;
+			}
+
+			int get() const { return fd_; }
+		};
+
+	#endif
+
+
+	#ifdef XORINATOR_UNIX_PERM_CHECK
+
+		/** Opens a file for reading (rwxBit 04) or writing (rwxBit 02),
+		 * and checks the permissions of the open descriptor, rather than
+		 * those of whatever the path names at another time.
+		 * Returns an invalid CheckedFd for stream paths, and for files
+		 * that don't exist yet: those are created by their streams. */
+		template<mode_t rwxBit>
+		CheckedFd openChecked(const std::string& path) {
+			static_assert((rwxBit == 02) || (rwxBit == 04));
+			if(isStreamPath(path)) return { }; // This may need to be removed in the future, but for now every file named "-" or "fd:N" is a stream
+			int fd;
+			do {
+				fd = ::open(path.c_str(), ((rwxBit == 04)? O_RDONLY : O_WRONLY) | O_CLOEXEC);
+			} while((fd < 0) && (errno == EINTR));
+			if(fd < 0) {
 				switch(errno) {
-					case ENOENT:  return;
+					case ENOENT:  return { };
+					case EISDIR:
+						throw xorinator::runtime::FilePermissionException(
+							'"'+path+"\" is an existing directory");
+					case EACCES:
+					case EPERM:
+					case EROFS:
+						throw xorinator::runtime::FilePermissionException(
+							"user doesn't have " + std::string(rwxString<rwxBit>) +
+							" permissions for \"" + path + '"');
 					default:
 						throw xorinator::runtime::FilePermissionException(
 							"could not determine permissions for file \""+path+'"');
 				}
 			}
+			struct stat statResult;
+			auto r = CheckedFd(fd, false);
+			if(0 != ::fstat(fd, &statResult)) {
+				throw xorinator::runtime::FilePermissionException(
+					"could not determine permissions for file \""+path+'"'); }
+			checkStatPermission<rwxBit>(statResult, path);
+			return CheckedFd(r.release(path), (rwxBit == 02) && S_ISREG(statResult.st_mode));
 		}
 
 	#endif
 
 
 	/** A std::ifstream / std::ofstream wrapper, that replaces the stream when
-	 * constructed from the path "-". */
+	 * constructed from the path "-" or "fd:N". */
 	template<typename stream_t, typename file_stream_t>
 	class StreamAdapter {
 	private:
@@ -150,10 +315,32 @@ namespace {
 
 		StreamAdapter(stream_t& ref): stream_(&ref), preallocated_(true) { }
 
-		StreamAdapter(const std::string& path, bool noStdIo) {
+		/** If `checked` is valid, the stream uses its descriptor instead
+		 * of opening the path again. */
+		StreamAdapter(const std::string& path, bool noStdIo, CheckedFd checked = { }) {
+			auto fd = noStdIo? std::nullopt : xorinator::runtime::parseFdPath(path);
+			if(checked.valid()) {
+				preallocated_ = false;
+				if constexpr(isInputStream) { stream_ = new xorinator::runtime::FdIStream(checked.release(path)); }
+				else { stream_ = new xorinator::runtime::FdOStream(checked.release(path)); }
+			} else
+			if(fd) {
+				// Inherited descriptors belong to whoever passed them (see "xor serve")
+				preallocated_ = false;
+				if constexpr(isInputStream) { stream_ = new xorinator::runtime::FdIStream(*fd, false); }
+				else { stream_ = new xorinator::runtime::FdOStream(*fd, false); }
+			} else
 			if(noStdIo || (path != "-")) {
 				preallocated_ = false;
-				stream_ = new file_stream_t(path, std::ios_base::binary);
+				stream_ = nullptr;
+				#ifdef XORINATOR_POSIX_IO
+					if constexpr(isOutputStream) { // Written through a descriptor, which "--durability" needs
+						int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+						if(fd >= 0)  stream_ = new xorinator::runtime::FdOStream(fd);
+					}
+				#endif
+				if(stream_ == nullptr) {
+					stream_ = new file_stream_t(path, std::ios_base::binary); }
 			} else {
 				preallocated_ = true;
 				if constexpr(isInputStream) { stream_ = &std::cin; }
@@ -204,74 +391,174 @@ namespace {
 	using OutputStreamAdapter = StreamAdapter<std::ostream, std::ofstream>;
 
 
-	class RngAdapter {
-	private:
-		using rtype = Rng::result_type;
+	/** Outputs written with "--durability=periodic" are written back
+	 * in windows of this size. */
+	constexpr uint64_t WRITEBACK_WINDOW = 8 << 20;
+
+	/** Starts the continuous writeback of an output, if the
+	 * "--durability=periodic" option is used and the output is written
+	 * through a file descriptor. */
+	void startWriteback(const CommandLine& cmdln, std::ostream& out) {
+		if(cmdln.durability != Durability::ePeriodic) return;
+		if(auto* buf = dynamic_cast<xorinator::runtime::FdStreamBuf*>(out.rdbuf())) {
+			buf->setWriteback(WRITEBACK_WINDOW); }
+	}
+
+	/** Flushes an output, then waits for it to reach the storage device. */
+	void syncOutput(std::ostream& out, const std::string& path) {
+		out.flush();
+		bool synced;
+		if(auto* buf = dynamic_cast<xorinator::runtime::FdStreamBuf*>(out.rdbuf())) {
+			synced = buf->syncData();
+		} else
+		if(&out == &std::cout) {
+			synced = xorinator::runtime::syncFd(1);
+		} else {
+			synced = xorinator::runtime::syncPath(path);
+		}
+		if(! synced) {
+			throw std::runtime_error("could not sync \"" + path + "\" to the storage device"); }
+	}
+
+	/** Flushes an output, then waits for it to reach the storage device
+	 * unless the "--durability=none" option is used. */
+	void commitOutput(const CommandLine& cmdln, std::ostream& out, const std::string& path) {
+		if(cmdln.durability == Durability::eNone) {
+			out.flush();
+			return;
+		}
+		syncOutput(out, path);
+	}
+
+
+	/** A generator seeded from the random device, which keeps the device
+	 * open to reseed the generator every RNG_RESET_AFTER bytes. */
+	struct RngEngine {
 		using dtype = std::random_device::result_type;
-		using byte_t = xorinator::byte_t;
-		static_assert(0 == sizeof(rtype) % sizeof(byte_t));
-		static constexpr unsigned rtype_bytes = sizeof(rtype) / sizeof(byte_t);
-		static constexpr unsigned dtype_bytes = sizeof(rtype) / sizeof(byte_t);
 
-		std::random_device rndDev_;
-		Rng rng_;
-		rtype rngState_;
-		dtype rndDevState_;
-		unsigned rngStateByteIndex_;
-		unsigned rndDevByteIndex_;
-		unsigned rngByteIndex_;
+		std::random_device rndDev;
+		Rng rng;
+		size_t byteIndex;
 
-		dtype fwdDevRandom_() {
-			static constexpr unsigned bits = std::numeric_limits<byte_t>::digits;
-			if(rndDevByteIndex_ >= dtype_bytes) {
-				rndDev_();
-				rndDevByteIndex_ = 0;
-			}
-			auto r = byte_t(rngState_ >> rtype((rndDevByteIndex_++) * bits));
-			return r;
+		static std::random_device mkRandomDevice() {
+			#ifdef XORINATOR_DEV_RANDOM
+				return std::random_device("/dev/random");
+			#else
+				return std::random_device();
+			#endif
 		}
 
-		Rng initRng_() {
+		RngEngine():
+				rndDev(mkRandomDevice()),
+				rng(seed()),
+				byteIndex(0)
+		{ }
+
+		Rng seed() {
 			constexpr size_t seedSizeBytes = 64;
 			constexpr size_t seedSizeDtype = seedSizeBytes / sizeof(dtype);
 			static_assert(seedSizeDtype % sizeof(dtype) == 0);
 			std::array<dtype, seedSizeDtype> seedData;
-			for(auto& drnd : seedData)  drnd = rndDev_();
+			for(auto& drnd : seedData)  drnd = rndDev();
 			auto seedSeq = std::seed_seq(seedData.begin(), seedData.end());
 			return Rng(seedSeq);
 		}
+	};
 
-		static std::random_device mkRandomDevice_() {
-			#ifdef XORINATOR_DEV_RANDOM
-				return std::random_device("/dev/random");
-			#else
-				return std::random_device();
-			#endif
+	/** The RngEngines of finished operations, which the next ones take
+	 * instead of opening and reading the random device again; a
+	 * long-running process (see "xor serve") only pays for that once.
+	 * An engine is never used by two operations at the same time, and
+	 * carries on from where the last one left it. */
+	class RngEnginePool {
+	private:
+		std::mutex mtx_;
+		std::vector<std::unique_ptr<RngEngine>> idle_;
+
+	public:
+		static RngEnginePool& instance() {
+			static RngEnginePool pool;
+			return pool;
+		}
+
+		std::unique_ptr<RngEngine> take() {
+			{
+				auto lock = std::unique_lock(mtx_);
+				if(! idle_.empty()) {
+					auto r = std::move(idle_.back());
+					idle_.pop_back();
+					return r;
+				}
+			}
+			return std::make_unique<RngEngine>();
+		}
+
+		void give(std::unique_ptr<RngEngine> engine) {
+			auto lock = std::unique_lock(mtx_);
+			idle_.push_back(std::move(engine));
+		}
+	};
+
+
+	class RngAdapter {
+	private:
+		using rtype = Rng::result_type;
+		using byte_t = xorinator::byte_t;
+		static_assert(0 == sizeof(rtype) % sizeof(byte_t));
+		static constexpr unsigned rtype_bytes = sizeof(rtype) / sizeof(byte_t);
+
+		std::unique_ptr<RngEngine> engine_;
+		rtype rngState_;
+		unsigned rngStateByteIndex_;
+
+		rtype nextWord_() {
+			if(engine_->byteIndex >= RNG_RESET_AFTER) {
+				engine_->rng = engine_->seed();
+				engine_->byteIndex = 0;
+			}
+			engine_->byteIndex += rtype_bytes;
+			return engine_->rng();
 		}
 
 	public:
 		RngAdapter():
-				rndDev_(mkRandomDevice_()),
-				rng_(initRng_()),
-				rngState_(rng_()),
-				rngStateByteIndex_(0),
-				rndDevByteIndex_(0),
-				rngByteIndex_(0)
+				engine_(RngEnginePool::instance().take()),
+				rngState_(nextWord_()),
+				rngStateByteIndex_(0)
 		{ }
 
+		~RngAdapter() {
+			RngEnginePool::instance().give(std::move(engine_)); }
+
+		RngAdapter(const RngAdapter&) = delete;
+		RngAdapter& operator=(const RngAdapter&) = delete;
+
 		byte_t operator()() {
 			static constexpr unsigned bits = std::numeric_limits<byte_t>::digits;
 			if(rngStateByteIndex_ >= rtype_bytes) {
-				if(rngByteIndex_ >= RNG_RESET_AFTER) {
-					rng_ = Rng(fwdDevRandom_());
-					rngByteIndex_ = 0;
-				}
-				rngState_ = rng_();
+				rngState_ = nextWord_();
 				rngStateByteIndex_ = 0;
 			}
-			auto r = byte_t(rngState_ >> rtype((rngStateByteIndex_++) * bits));
-			++rngByteIndex_;
-			return r;
+			return byte_t(rngState_ >> rtype((rngStateByteIndex_++) * bits));
+		}
+
+		/** Fills `size` bytes with random data, a whole word at a time;
+		 * the result is the same as `size` calls to `operator()`. */
+		void fill(byte_t* dst, size_t size) {
+			static constexpr unsigned bits = std::numeric_limits<byte_t>::digits;
+			while((size > 0) && (rngStateByteIndex_ < rtype_bytes)) {
+				*(dst++) = (*this)();
+				--size;
+			}
+			for(; size >= rtype_bytes; size -= rtype_bytes) {
+				rtype word = nextWord_();
+				for(unsigned i=0; i < rtype_bytes; ++i) {
+					*(dst++) = byte_t(word >> rtype(i * bits)); }
+			}
+			while(size > 0) {
+				*(dst++) = (*this)();
+				--size;
+			}
 		}
 	};
 
@@ -328,10 +615,15 @@ namespace {
 			if(cmdln.litterSize != 0) {
 				std::cerr << pre << "the \"--litter\" argument has no effect for this subcommand." << std::endl;
 			} else
-			if(! cmdln.roKeys.empty()) {
+			if((! cmdln.roKeys.empty()) && ! (cmdln.options & xorinator::cli::OptionBits::eContainer)) {
 				std::cerr << pre << "\"--nogen\" arguments are redundant for this subcommand." << std::endl;
 			}
 		}
+		if(! cmdln.deltaIndex.empty()) {
+			std::cerr << pre <<
+				"\"--delta\" reuses the pads of the unchanged shares; anyone holding two versions"
+				" of the first share learns the XOR of the two sources where they differ." << std::endl;
+		}
 	}
 
 
@@ -352,6 +644,78 @@ namespace {
 			if(cmdln.cmdType == CmdType::eDemultiplex)
 				throw CmdlnException("a demultiplexing operation needs one or more input files");
 		}
+		if(cmdln.threshold != 0) {
+			if(cmdln.cmdType != CmdType::eMultiplex)
+				throw CmdlnException("the \"--threshold\" option can only be used when multiplexing");
+			if(! (cmdln.options & xorinator::cli::OptionBits::eContainer))
+				throw CmdlnException("threshold share sets need the \"--container\" option");
+			if((cmdln.threshold < 2) || (cmdln.threshold > cmdln.variadicArgs.size()))
+				throw CmdlnException("the threshold must be between 2 and the number of output files");
+			if(! cmdln.roKeys.empty())
+				throw CmdlnException("\"--nogen\" files cannot be used with threshold share sets");
+			if(cmdln.litterSize != 0)
+				throw CmdlnException("\"--litter\" cannot be used with threshold share sets, whose shares all need the length of the input");
+		}
+		if((! cmdln.reservoir.empty()) && (cmdln.cmdType != CmdType::eMultiplex))
+			throw CmdlnException("a pad reservoir can only be used when multiplexing");
+		if(cmdln.options & xorinator::cli::OptionBits::eResume) {
+			using xorinator::cli::OptionBits;
+			if((cmdln.cmdType != CmdType::eMultiplex) && (cmdln.cmdType != CmdType::eDemultiplex))
+				throw CmdlnException("the \"--resume\" option can only be used when multiplexing or demultiplexing");
+			if(cmdln.options & OptionBits::eRecursive)
+				throw CmdlnException("recursive operations cannot be resumed");
+			if(cmdln.options & (OptionBits::eContainer | OptionBits::eIndex | OptionBits::eCompress))
+				throw CmdlnException("operations with the \"--container\", \"--index\" or \"--compress\" options cannot be resumed");
+			bool streams = isStreamPath(cmdln.firstArg);
+			for(const auto& path : cmdln.variadicArgs) {
+				streams = streams || isStreamPath(path); }
+			if(streams)
+				throw CmdlnException("operations on the standard input and output or on file descriptors cannot be resumed");
+		}
+		if(cmdln.options & xorinator::cli::OptionBits::eAppend) {
+			using xorinator::cli::OptionBits;
+			if(cmdln.cmdType != CmdType::eMultiplex)
+				throw CmdlnException("the \"--append\" option can only be used when multiplexing");
+			if(cmdln.options & (OptionBits::eRecursive | OptionBits::eResume))
+				throw CmdlnException("the \"--append\" option cannot be used with \"--recursive\" or \"--resume\"");
+			if(cmdln.options & (OptionBits::eContainer | OptionBits::eIndex | OptionBits::eCompress))
+				throw CmdlnException("shares written with the \"--container\", \"--index\" or \"--compress\" options cannot be appended to");
+			if(cmdln.litterSize != 0)
+				throw CmdlnException("\"--litter\" cannot be used with \"--append\", since shares of different lengths cannot be appended to");
+			bool streams = isStreamPath(cmdln.firstArg);
+			for(const auto& path : cmdln.variadicArgs) {
+				streams = streams || isStreamPath(path); }
+			if(streams)
+				throw CmdlnException("the standard input and output and file descriptors cannot be used with \"--append\"");
+		}
+		if(! cmdln.deltaIndex.empty()) {
+			using xorinator::cli::OptionBits;
+			if(cmdln.cmdType != CmdType::eMultiplex)
+				throw CmdlnException("the \"--delta\" option can only be used when multiplexing");
+			if(cmdln.options & (OptionBits::eRecursive | OptionBits::eResume | OptionBits::eAppend))
+				throw CmdlnException("the \"--delta\" option cannot be used with \"--recursive\", \"--resume\" or \"--append\"");
+			if(cmdln.options & (OptionBits::eContainer | OptionBits::eIndex | OptionBits::eCompress))
+				throw CmdlnException("shares written with the \"--container\", \"--index\" or \"--compress\" options cannot be patched");
+			if((! cmdln.rngKeys.empty()) || (! cmdln.roKeys.empty()))
+				throw CmdlnException("\"--key\" and \"--nogen\" arguments cannot be used with \"--delta\", whose shares are all patched at random offsets");
+			if(cmdln.litterSize != 0)
+				throw CmdlnException("\"--litter\" cannot be used with \"--delta\", since the shares must keep the length of the source");
+			bool streams = isStreamPath(cmdln.deltaIndex);
+			for(const auto& path : cmdln.variadicArgs) {
+				streams = streams || isStreamPath(path); }
+			if(streams)
+				throw CmdlnException("the standard output and file descriptors cannot be used with \"--delta\"");
+		}
+		if(cmdln.options & xorinator::cli::OptionBits::eIndex) {
+			if(cmdln.options & xorinator::cli::OptionBits::eRecursive)
+				throw CmdlnException("integrity indices cannot be used for recursive operations");
+			if(cmdln.cmdType == CmdType::eDemultiplex)
+				throw CmdlnException("integrity indices are not checked while demultiplexing; check the shares with \"verify --index\" first");
+			if(cmdln.cmdType == CmdType::eMultiplex) {
+				for(const auto& path : cmdln.variadicArgs) {
+					if(isStreamPath(path))  throw CmdlnException("integrity indices cannot be written for the standard output or a file descriptor"); }
+			}
+		}
 		if((! (cmdln.options & xorinator::cli::OptionBits::eForce)) && (
 				(cmdln.cmdType == CmdType::eMultiplex) || (cmdln.cmdType == CmdType::eDemultiplex)
 		)) {
@@ -361,6 +725,8 @@ namespace {
 				if(! paths.insert(cmdln.variadicArgs[i]).second)
 					throw CmdlnException("file arguments must be unique");
 			}
+			if((! cmdln.deltaIndex.empty()) && ! paths.insert(cmdln.deltaIndex).second)
+				throw CmdlnException("the block index of \"--delta\" cannot be the source or a share");
 		}
 	}
 
@@ -368,167 +734,2464 @@ namespace {
 
 
 
-namespace xorinator::runtime {
+namespace {
 
-	bool runMux(const CommandLine& cmdln) {
-		using xorinator::byte_t;
+	using xorinator::runtime::WorkStealingPool;
+	namespace container = xorinator::container;
+	namespace integrity = xorinator::integrity;
+	namespace checkpoint = xorinator::checkpoint;
 
-		#ifdef XORINATOR_UNIX_PERM_CHECK
-			if(! (cmdln.options & cli::OptionBits::eForce)) {
-				checkFilePermission<04>(cmdln.firstArg);
-				for(const auto& file : cmdln.variadicArgs) {
-					checkFilePermission<02>(file); }
-			}
-		#endif
 
-		assert(cmdln.cmdType == cli::CmdType::eMultiplex);
-		checkPaths(cmdln);
-		checkArgumentUsage(cmdln);
-		tryWarnRngKeyDeprecated(cmdln);
+	/** Creates the container headers for a new share set. */
+	StaticVector<container::ShareHeader> mkShareHeaders(const CommandLine& cmdln, size_t shareCount, RngAdapter& rng) {
+		using CmdlnException = xorinator::cli::InvalidCommandLineException;
+		if(shareCount > container::MAX_SHARES) {
+			throw CmdlnException(
+				"share containers support up to " + std::to_string(container::MAX_SHARES) + " shares per set"); }
+		if(cmdln.chunkSize > container::MAX_CHUNK_SIZE) {
+			throw CmdlnException("the chunk size must be at most " + std::to_string(container::MAX_CHUNK_SIZE >> 20) + " MiB"); }
+		container::ShareHeader proto;
+		proto.formatVersion = container::FORMAT_VERSION;
+		proto.keystreamVersion = cmdln.rngKeys.empty()? container::KEYSTREAM_NONE : container::KEYSTREAM_RNGKEY_V1;
+		proto.flags = cmdln.roKeys.empty()? 0 : container::FLAG_EXTERNAL_PADS;
+		if(cmdln.options & xorinator::cli::OptionBits::eCompress) {
+			proto.flags = proto.flags | container::FLAG_COMPRESSED; }
+		if(cmdln.threshold != 0) {
+			proto.flags = proto.flags | container::FLAG_THRESHOLD | (cmdln.threshold << container::THRESHOLD_SHIFT); }
+		proto.shareCount = shareCount;
+		proto.chunkSize = (cmdln.chunkSize == 0)? container::DEFAULT_CHUNK_SIZE : cmdln.chunkSize;
+		for(auto& idByte : proto.setId) {
+			idByte = rng(); }
+		auto r = StaticVector<container::ShareHeader>(shareCount);
+		for(size_t i=0; i < shareCount; ++i) {
+			r[i] = proto;
+			r[i].shareIndex = i;
+			r[i].shareMask = uint64_t(1) << i;
+		}
+		return r;
+	}
 
-		auto rndDev = std::random_device();
-		auto muxIn = InputStreamAdapter(cmdln.firstArg, cmdln.firstLiteralArg <= 0);
-		auto muxOut = StaticVector<OutputStreamAdapter>(cmdln.variadicArgs.size());
-		auto outputBuffer = StaticVector<byte_t>(muxOut.size());
-		auto rngKeys = StaticVector<::RngKey>(cmdln.rngKeys.size());
-		auto rngKeyViews = StaticVector<::RngKey::View>(rngKeys.size());
-		auto rngKeyIterators = StaticVector<::RngKey::View::Iterator>(rngKeyViews.size());
-		auto roKeyStreams = StaticVector<std::ifstream>(cmdln.roKeys.size());
-		auto roKeys = StaticVector<::StreamKey>(cmdln.roKeys.size());
-		auto roKeyViews = StaticVector<::StreamKey::View>(roKeys.size());
-		auto roKeyIterators = StaticVector<::StreamKey::View::Iterator>(roKeyViews.size());
-		RngAdapter rng;
 
-		for(size_t i=0; const std::string& key : cmdln.rngKeys) {
-			rngKeys[i] = keyFromGenerator(key);
-			rngKeyViews[i] = rngKeys[i].view(0);
-			rngKeyIterators[i].~Iterator(); // Much like Thanos, this is inevitable. Hopefully this can and does get optimized away.
-			new (&rngKeyIterators[i]) ::RngKey::View::Iterator(rngKeyViews[i].begin());
-			++i;
+	/** Returns whether the given (consistent) share headers cover every
+	 * share of their set, or enough shares of a threshold set. */
+	bool shareSetIsComplete(const StaticVector<container::ShareHeader>& headers) {
+		if(headers.empty()) return false;
+		uint64_t mask = 0;
+		for(const auto& hdr : headers) {
+			mask = mask | hdr.shareMask; }
+		if(headers.front().threshold() != 0) {
+			return unsigned(std::popcount(mask)) >= headers.front().threshold(); }
+		return container::isCompleteMask(headers.front().shareCount, mask);
+	}
+
+
+	/** Checks that the given share containers belong to the same set,
+	 * that no share is repeated, and - if `requireComplete` is `true` -
+	 * that the set is complete. */
+	void validateShareSet(
+			const CommandLine& cmdln,
+			const StaticVector<container::ShareHeader>& headers,
+			const StaticVector<std::string>& names,
+			bool requireComplete
+	) {
+		using container::ContainerFormatException;
+		if(headers.empty()) return;
+		const auto& first = headers.front();
+		uint64_t mask = 0;
+		for(size_t i=0; i < headers.size(); ++i) {
+			const auto& hdr = headers[i];
+			if(hdr.setId != first.setId) {
+				throw ContainerFormatException(
+					'"' + names[i] + "\" and \"" + names[0] + "\" belong to different share sets"); }
+			if(
+					(hdr.chunkSize != first.chunkSize) || (hdr.shareCount != first.shareCount) ||
+					(hdr.flags != first.flags) || (hdr.keystreamVersion != first.keystreamVersion)
+			) {
+				throw ContainerFormatException(
+					'"' + names[i] + "\" and \"" + names[0] + "\" have inconsistent container headers"); }
+			if((mask & hdr.shareMask) != 0) {
+				throw ContainerFormatException('"' + names[i] + "\" repeats a share of the set"); }
+			mask = mask | hdr.shareMask;
 		}
-		for(size_t i=0; const std::string& key : cmdln.roKeys) {
-			roKeyStreams[i] = std::ifstream(key);
-			roKeys[i] = ::StreamKey(roKeyStreams[i]);
-			roKeyViews[i] = roKeys[i].view(0);
-			roKeyIterators[i].~Iterator(); // Much like Thanos, this is inevitable. Hopefully this can and does get optimized away.
-			new (&roKeyIterators[i]) ::StreamKey::View::Iterator(roKeyViews[i].begin());
-			++i;
+		if(requireComplete) {
+			if(! shareSetIsComplete(headers)) {
+				if(first.threshold() != 0) {
+					throw ContainerFormatException(
+						"the share set is incomplete (" + std::to_string(std::popcount(mask)) +
+						" of " + std::to_string(first.threshold()) + " shares)"); }
+				throw ContainerFormatException("the share set is incomplete, or mixes shares of different splits");
+			}
+			if((first.flags & container::FLAG_EXTERNAL_PADS) && cmdln.roKeys.empty()) {
+				throw ContainerFormatException(
+					"the share set was multiplexed with \"--nogen\" files, which are missing"); }
+			if(! (cmdln.options & xorinator::cli::OptionBits::eQuiet)) {
+				if((first.keystreamVersion != container::KEYSTREAM_NONE) && cmdln.rngKeys.empty()) {
+					std::cerr << "Warning: the share set was multiplexed with \"--key\" arguments, which are missing." << std::endl; }
+				if((first.keystreamVersion == container::KEYSTREAM_NONE) && ! cmdln.rngKeys.empty()) {
+					std::cerr << "Warning: the share set was multiplexed without \"--key\" arguments." << std::endl; }
+			}
 		}
+	}
 
-		muxIn.get().exceptions(std::ios_base::badbit);
-		for(unsigned i=0; const std::string& path : cmdln.variadicArgs) {
-			muxOut[i] = OutputStreamAdapter(path, cmdln.firstLiteralArg <= (i+1));
-			muxOut[i].get().exceptions(std::ios_base::badbit);
-			++i;
-		}
 
-		char inputChar;
-		while(muxIn.get().get(inputChar)) {
-			byte_t xorSum = 0;
-			for(size_t i=1; i < muxOut.size(); ++i) {
-				outputBuffer[i] = random<byte_t>(rng);
-				xorSum = xorSum ^ outputBuffer[i];
-			}
-			for(auto& keyIter : rngKeyIterators) {
-				xorSum = xorSum ^ *keyIter;
-				++keyIter;
+	/** Throws a ContainerFormatException if the given shares belong to
+	 * a threshold set, which the given XOR-only operation cannot handle. */
+	void rejectThresholdSet(const StaticVector<container::ShareHeader>& headers, const std::string& operation) {
+		if((! headers.empty()) && (headers.front().threshold() != 0)) {
+			throw container::ContainerFormatException(
+				"threshold share sets cannot be used for " + operation + " operations"); }
+	}
+
+
+	/** Creates the combined keystream of every "--key" argument of the
+	 * command line, starting from the first byte. */
+	RngKeyStream mkRngKeyStream(const CommandLine& cmdln) {
+		auto keys = StaticVector<::RngKey>(cmdln.rngKeys.size());
+		for(size_t i=0; const std::string& key : cmdln.rngKeys) {
+			keys[i++] = keyFromGenerator(key); }
+		return RngKeyStream(keys.data(), keys.size());
+	}
+
+
+	/** XORs the next bytes of the "--key" keystream into `block`. */
+	void applyRngKeys(RngKeyStream& rngKeyStream, std::vector<xorinator::byte_t>& block) {
+		rngKeyStream.apply(block.data(), block.size()); }
+
+
+	/** The streams to be demultiplexed: if the "--container" option is
+	 * used, every input except the last `cmdln.roKeys.size()` ones is
+	 * read as a share container, after validating the set headers. */
+	struct DemuxInputs {
+		StaticVector<container::ShareHeader> headers;
+		StaticVector<std::unique_ptr<container::ChunkedIStream>> chunked;
+		StaticVector<InputStreamAdapter> streams;
+
+		DemuxInputs(
+				const CommandLine& cmdln,
+				StaticVector<InputStreamAdapter>& files,
+				const StaticVector<std::string>& names,
+				bool requireComplete = true
+		):
+				headers((cmdln.options & xorinator::cli::OptionBits::eContainer)? (files.size() - cmdln.roKeys.size()) : 0),
+				chunked(headers.size()),
+				streams(files.size())
+		{
+			for(auto& input : files) {
+				input.get().exceptions(std::ios_base::badbit); }
+			if(! headers.empty()) {
+				for(size_t i=0; i < headers.size(); ++i) {
+					headers[i] = container::ShareHeader::read(files[i].get(), names[i]); }
+				validateShareSet(cmdln, headers, names, requireComplete);
+				for(size_t i=0; i < headers.size(); ++i) {
+					chunked[i] = std::make_unique<container::ChunkedIStream>(files[i].get(), headers[i], names[i]);
+					chunked[i]->exceptions(std::ios_base::badbit); // Malformed chunks must not pass for the end of the share
+				}
 			}
-			for(auto& keyIter : roKeyIterators) {
-				xorSum = xorSum ^ *keyIter;
-				++keyIter;
+			for(size_t i=0; i < files.size(); ++i) {
+				if(i < chunked.size()) {
+					streams[i] = InputStreamAdapter(*chunked[i]);
+				} else {
+					streams[i] = InputStreamAdapter(files[i].get());
+				}
 			}
-			outputBuffer[0] = byte_t(inputChar) ^ xorSum;
-			for(size_t i=0; auto& output : muxOut) {
-				output.get().put(outputBuffer[i++]); } // SEE IF `++i` WORKS INSTEAD OF `i++`
 		}
+	};
 
-		if(cmdln.litterSize > 0) {
-			size_t noLitterIndex = random<size_t>(rng) % muxOut.size();
-			for(size_t i=0; auto& output : muxOut) {
-				using lit_t = decltype(cmdln.litterSize);
-				if((i++) != noLitterIndex) {
-					lit_t litterSize = random<lit_t>(rng) % cmdln.litterSize;
-					for(lit_t i=0; i < litterSize; ++i) {
-						output.get().put(rng());
+
+	/** New shares sharing a storage device are written in extents of
+	 * this size, each by the writer of the device; the others are
+	 * written in extents of DEVICE_SOLO_EXTENT bytes. */
+	constexpr size_t DEVICE_SHARED_EXTENT = 8 << 20;
+	constexpr size_t DEVICE_SOLO_EXTENT = 1 << 20;
+
+	/** Identifies the storage device of an output file: the device of
+	 * its file system or, on Linux, the whole disk if that is a
+	 * partition. Outputs that are not regular files written through a
+	 * descriptor are considered to be on a device of their own, and
+	 * get `fallback` (which must not be a valid device number). */
+	uint64_t outputDevice(std::ostream& out, uint64_t fallback) {
+		#ifdef XORINATOR_POSIX_IO
+			auto* buf = dynamic_cast<xorinator::runtime::FdStreamBuf*>(out.rdbuf());
+			struct stat st;
+			if((buf == nullptr) || (0 != ::fstat(buf->fd(), &st)) || ! S_ISREG(st.st_mode)) {
+				return fallback; }
+			#ifdef __linux__
+				try {
+					namespace fs = std::filesystem;
+					auto sysPath = fs::path("/sys/dev/block") / (std::to_string(major(st.st_dev)) + ':' + std::to_string(minor(st.st_dev)));
+					if(fs::exists(sysPath / "partition")) {
+						unsigned diskMajor, diskMinor;
+						char colon;
+						auto devFile = std::ifstream(fs::canonical(sysPath).parent_path() / "dev");
+						if((devFile >> diskMajor >> colon >> diskMinor) && (colon == ':')) {
+							return makedev(diskMajor, diskMinor); }
 					}
+				} catch(std::filesystem::filesystem_error&) { }
+			#endif
+			return st.st_dev;
+		#else
+			(void) out;
+			return fallback;
+		#endif
+	}
+
+	/** Starts the writers of the devices of the given outputs. */
+	std::unique_ptr<xorinator::runtime::DeviceWriters> mkDeviceWriters(StaticVector<OutputStreamAdapter>& files) {
+		std::vector<std::ostream*> targets;
+		std::vector<uint64_t> devices;
+		for(size_t i=0; i < files.size(); ++i) {
+			targets.push_back(&files[i].get());
+			devices.push_back(outputDevice(files[i].get(), (uint64_t(1) << 63) | i));
+		}
+		return std::make_unique<xorinator::runtime::DeviceWriters>(
+			std::move(targets), devices, DEVICE_SOLO_EXTENT, DEVICE_SHARED_EXTENT);
+	}
+
+
+	/** The streams of new shares: if the "--index" option is used every
+	 * share is hashed while it is written, and if `headers` is not empty
+	 * every share is written as a share container. Unless the operation
+	 * is recursive or unthreaded, several shares are written through
+	 * DeviceWriters. */
+	struct ShareOutputs {
+		std::unique_ptr<xorinator::runtime::DeviceWriters> writers;
+		StaticVector<std::unique_ptr<integrity::IndexingOStream>> indexed;
+		StaticVector<std::unique_ptr<container::ChunkedOStream>> chunked;
+		StaticVector<OutputStreamAdapter> streams;
+
+		ShareOutputs(
+				const CommandLine& cmdln,
+				StaticVector<OutputStreamAdapter>& files,
+				const StaticVector<container::ShareHeader>& headers,
+				bool threaded = true
+		):
+				indexed((cmdln.options & xorinator::cli::OptionBits::eIndex)? files.size() : 0),
+				chunked(headers.size()),
+				streams(files.size())
+		{
+			assert(headers.empty() || (headers.size() == files.size()));
+			if(threaded && (files.size() > 1) && ! (cmdln.options & xorinator::cli::OptionBits::eRecursive)) {
+				writers = mkDeviceWriters(files); }
+			for(size_t i=0; i < files.size(); ++i) {
+				files[i].get().exceptions(std::ios_base::badbit);
+				std::ostream& file = writers? writers->stream(i) : files[i].get();
+				file.exceptions(std::ios_base::badbit);
+				if(indexed.empty()) {
+					streams[i] = OutputStreamAdapter(file);
+				} else {
+					indexed[i] = std::make_unique<integrity::IndexingOStream>(file);
+					indexed[i]->exceptions(std::ios_base::badbit);
+					streams[i] = OutputStreamAdapter(*indexed[i]);
 				}
 			}
+			for(size_t i=0; i < chunked.size(); ++i) {
+				chunked[i] = std::make_unique<container::ChunkedOStream>(streams[i].get(), headers[i]);
+				streams[i] = OutputStreamAdapter(*chunked[i]);
+			}
+			for(auto& output : streams) {
+				output.get().exceptions(std::ios_base::badbit); }
+			for(auto& file : files) {
+				startWriteback(cmdln, file.get()); }
 		}
 
-		for(auto& output : muxOut) {
-			output.get().flush(); }
+		/** Writes the last chunk of every container and the integrity
+		 * index of every share next to it, then commits the files
+		 * according to the "--durability" option. */
+		void finish(const CommandLine& cmdln, StaticVector<OutputStreamAdapter>& files, const StaticVector<std::string>& paths) {
+			for(auto& output : chunked) {
+				output->finish(); }
+			for(size_t i=0; i < indexed.size(); ++i) {
+				auto indexPath = integrity::IntegrityIndex::pathFor(paths[i]);
+				auto indexFile = std::ofstream(indexPath, std::ios_base::binary);
+				indexFile.exceptions(std::ios_base::badbit | std::ios_base::failbit);
+				indexed[i]->finish().write(indexFile);
+				commitOutput(cmdln, indexFile, indexPath);
+			}
+			if(writers) {
+				writers->finish(); }
+			for(size_t i=0; i < files.size(); ++i) {
+				commitOutput(cmdln, files[i].get(), paths[i]); }
+		}
 
-		return true;
-	}
+		/** Waits for everything written so far to reach the storage
+		 * device, for a checkpoint of a "--resume" operation (which
+		 * cannot write containers or indices); nothing can be written
+		 * to the streams meanwhile. */
+		void checkpoint(StaticVector<OutputStreamAdapter>& files, const StaticVector<std::string>& paths) {
+			assert(chunked.empty() && indexed.empty());
+			for(auto& output : streams) {
+				output.get().flush(); }
+			if(writers) {
+				writers->finish(); }
+			for(size_t i=0; i < files.size(); ++i) {
+				syncOutput(files[i].get(), paths[i]); }
+		}
+	};
 
 
-	bool runDemux(const CommandLine& cmdln) {
-		using xorinator::byte_t;
+	/** The outputs of a "--resume" operation are committed to its
+	 * checkpoint journal every this many bytes. */
+	constexpr uint64_t CHECKPOINT_INTERVAL = 256 << 20;
 
-		#ifdef XORINATOR_UNIX_PERM_CHECK
-			if(! (cmdln.options & cli::OptionBits::eForce)) {
-				checkFilePermission<02>(cmdln.firstArg);
-				for(const auto& file : cmdln.variadicArgs) {
-					checkFilePermission<04>(file); }
+	/** Tracks the progress of a "--resume" operation in its checkpoint
+	 * journal; every output of the operation is written up to the same
+	 * offset. */
+	class Checkpointer {
+	private:
+		checkpoint::Journal journal_;
+		StaticVector<std::string> paths_;
+		uint64_t resumeOffset_;
+		uint64_t next_;
+
+	public:
+		/** Opens the journal, and checks that every output still holds
+		 * what the last checkpoint committed. */
+		Checkpointer(const CommandLine& cmdln, const StaticVector<std::string>& outPaths):
+				journal_(checkpoint::journalPath(outPaths.front()), checkpoint::operationFingerprint(cmdln), outPaths.size()),
+				paths_(outPaths)
+		{
+			const auto& offsets = journal_.offsets();
+			resumeOffset_ = *std::min_element(offsets.begin(), offsets.end());
+			for(size_t i=0; i < outPaths.size(); ++i) {
+				std::error_code ec;
+				auto size = std::filesystem::file_size(outPaths[i], ec);
+				if((offsets[i] > 0) && (ec || (size < offsets[i]))) {
+					throw checkpoint::JournalException(
+						'"' + outPaths[i] + "\" is shorter than its last checkpoint (" + std::to_string(offsets[i]) + " bytes); "
+						"remove \"" + checkpoint::journalPath(outPaths.front()) + "\" to start over"); }
 			}
-		#endif
+			next_ = resumeOffset_ + CHECKPOINT_INTERVAL;
+		}
 
-		assert(cmdln.cmdType == cli::CmdType::eDemultiplex);
-		checkPaths(cmdln);
-		checkArgumentUsage(cmdln);
-		tryWarnRngKeyDeprecated(cmdln);
+		/** The offset the operation resumes from. */
+		uint64_t resumeOffset() const { return resumeOffset_; }
 
-		auto demuxOut = OutputStreamAdapter(cmdln.firstArg, cmdln.firstLiteralArg <= 0);
-		auto demuxIn = StaticVector<InputStreamAdapter>(cmdln.variadicArgs.size() + cmdln.roKeys.size());
-		auto rngKeys = StaticVector<::RngKey>(cmdln.rngKeys.size());
-		auto rngKeyViews = StaticVector<::RngKey::View>(rngKeys.size());
-		auto rngKeyIterators = StaticVector<::RngKey::View::Iterator>(rngKeyViews.size());
+		const std::string& path(size_t i) const { return paths_[i]; }
 
-		for(size_t i=0; const std::string& key : cmdln.rngKeys) {
-			rngKeys[i] = keyFromGenerator(key);
-			rngKeyViews[i] = rngKeys[i].view(0);
-			/* The next line is a bit of a hack: see the similar situation in
-			 * ::runMux. */
-			new (&rngKeyIterators[i]) ::RngKey::View::Iterator(rngKeyViews[i].begin());
-			++i;
-		}
+		/** Whether the outputs should be committed, once `offset` bytes
+		 * of each have been written. */
+		bool due(uint64_t offset) const { return offset >= next_; }
 
-		demuxOut.get().exceptions(std::ios_base::badbit);
-		for(size_t i=0; const std::string& path : cmdln.variadicArgs) {
-			demuxIn[i] = InputStreamAdapter(path, cmdln.firstLiteralArg <= (i+1));
-			demuxIn[i].get().exceptions(std::ios_base::badbit);
-			++i;
-		}
-		for(size_t i = cmdln.variadicArgs.size(); const std::string& path : cmdln.roKeys) {
-			demuxIn[i] = InputStreamAdapter(path, true);
-			demuxIn[i].get().exceptions(std::ios_base::badbit);
-			++i;
+		/** Records that `offset` bytes of every output have reached the
+		 * storage device. */
+		void commit(uint64_t offset) {
+			journal_.commit(std::vector<uint64_t>(journal_.offsets().size(), offset));
+			next_ = offset + CHECKPOINT_INTERVAL;
 		}
 
-		char inputChar;
-		while([&]() {
-			byte_t xorSum = 0;
-			for(auto& input : demuxIn) {
-				if(input.get().get(inputChar)) {
-					xorSum = byte_t(inputChar) ^ xorSum;
-				} else {
-					return false;
-				}
-			}
-			for(auto& keyIter : rngKeyIterators) {
-				xorSum = xorSum ^ *keyIter;
-				++keyIter;
-			}
-			demuxOut.get().put(xorSum);
-			return true;
-		} ());
-		demuxOut.get().flush();
+		/** Deletes the journal of the completed operation. */
+		void complete() { journal_.remove(); }
+	};
 
-		return true;
+	/** Returns the Checkpointer of a "--resume" operation, or null if the
+	 * option isn't used. */
+	std::unique_ptr<Checkpointer> mkCheckpointer(const CommandLine& cmdln, const StaticVector<std::string>& outPaths) {
+		if(! (cmdln.options & xorinator::cli::OptionBits::eResume)) return nullptr;
+		return std::make_unique<Checkpointer>(cmdln, outPaths);
 	}
 
+	/** Returns the length of the shares continued by a "--append"
+	 * operation, which must all exist with the same length (or not exist
+	 * at all, for the first operation), and not be longer than the
+	 * source. */
+	uint64_t appendOffset(const CommandLine& cmdln) {
+		namespace fs = std::filesystem;
+		std::optional<uint64_t> length;
+		size_t existing = 0;
+		for(const auto& path : cmdln.variadicArgs) {
+			if(! fs::exists(path)) continue;
+			if(! fs::is_regular_file(path)) {
+				throw std::runtime_error("\"" + path + "\" is not a regular file, and cannot be appended to"); }
+			uint64_t size = fs::file_size(path);
+			if(length && (size != *length)) {
+				throw std::runtime_error(
+					"the shares have different lengths (" + std::to_string(*length) + " and " + std::to_string(size) + " bytes), "
+					"and cannot be appended to"); }
+			length = size;
+			++existing;
+		}
+		if(existing == 0)  return 0;
+		if(existing < cmdln.variadicArgs.size()) {
+			throw std::runtime_error("some of the shares to append to don't exist"); }
+		if(fs::file_size(cmdln.firstArg) < *length) {
+			throw std::runtime_error(
+				"\"" + cmdln.firstArg + "\" is shorter than its shares (" + std::to_string(*length) + " bytes): "
+				"it was truncated or replaced, and cannot be appended to"); }
+		return *length;
+	}
 
-	bool usage(const CommandLine& cmdln) {
+	/** Opens an existing output to continue it, keeping its first
+	 * `offset` bytes and positioning it after them. */
+	OutputStreamAdapter openContinuedOutput(const std::string& path, CheckedFd checked, uint64_t offset) {
+		#ifdef XORINATOR_POSIX_IO
+			int fd = checked.valid()? checked.release(path, offset) : ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+			if(fd < 0) {
+				throw xorinator::runtime::FilePermissionException("could not open \"" + path + "\" for writing"); }
+			if((0 != ::ftruncate(fd, offset)) || (::lseek(fd, offset, SEEK_SET) < 0)) {
+				::close(fd);
+				throw std::runtime_error("could not continue writing \"" + path + "\" at offset " + std::to_string(offset));
+			}
+			return OutputStreamAdapter(path, true, CheckedFd(fd, false));
+		#else
+			(void) path;
+			(void) checked;
+			(void) offset;
+			throw std::runtime_error("existing outputs cannot be continued on this platform");
+		#endif
+	}
+
+	/** Positions the input of an operation that continues existing
+	 * outputs at the given offset. */
+	void seekContinuedInput(std::istream& in, const std::string& name, uint64_t offset) {
+		if(offset == 0) return;
+		in.seekg(offset);
+		if(in.fail()) {
+			throw std::runtime_error("could not continue reading \"" + name + "\" at offset " + std::to_string(offset)); }
+	}
+
+
+	/** Appends up to `cmdln.litterSize` random bytes to every output
+	 * except a random one, which keeps the length of the original data. */
+	void writeLitter(const CommandLine& cmdln, StaticVector<OutputStreamAdapter>& outputs, RngAdapter& rng) {
+		if(cmdln.litterSize > 0) {
+			size_t noLitterIndex = random<size_t>(rng) % outputs.size();
+			for(size_t i=0; auto& output : outputs) {
+				using lit_t = decltype(cmdln.litterSize);
+				if((i++) != noLitterIndex) {
+					lit_t litterSize = random<lit_t>(rng) % cmdln.litterSize;
+					for(lit_t i=0; i < litterSize; ++i) {
+						output.get().put(rng());
+					}
+				}
+			}
+		}
+	}
+
+
+	/** Supplies the random data of new one-time pads: it is taken from
+	 * the pad reservoir of the "--reservoir" option, if any, and
+	 * generated once the reservoir is exhausted. */
+	class PadSource {
+	private:
+		static constexpr uint64_t MAX_RESERVATION = 64 << 20;
+
+		RngAdapter* rng_;
+		std::unique_ptr<xorinator::reservoir::Reservoir> reservoir_;
+		xorinator::reservoir::Reservoir::Region region_;
+		uint64_t reserved_;
+		std::string reservoirPath_;
+		bool quiet_;
+
+		/** Reserves a new region, at least as large as the pad data
+		 * taken so far (up to MAX_RESERVATION): the unused part of the
+		 * last region is lost, but it is never larger than the data
+		 * that was actually used. */
+		bool reserve_(uint64_t size) {
+			uint64_t request = std::min(std::max(size, reserved_), MAX_RESERVATION);
+			region_ = reservoir_->reserve(request);
+			reserved_ += region_.size;
+			if(region_.size == 0) {
+				reservoir_.reset();
+				static std::once_flag warnOnce;
+				if(! quiet_) std::call_once(warnOnce, [this]() {
+					std::cerr << "Warning: the pad reservoir \"" << reservoirPath_ << "\" is exhausted, generating the remaining pads." << std::endl; });
+				return false;
+			}
+			return true;
+		}
+
+	public:
+		PadSource(const CommandLine& cmdln, RngAdapter& rng):
+				rng_(&rng),
+				region_({ 0, 0 }),
+				reserved_(0),
+				reservoirPath_(cmdln.reservoir),
+				quiet_(cmdln.options & xorinator::cli::OptionBits::eQuiet)
+		{
+			if(! cmdln.reservoir.empty()) {
+				reservoir_ = std::make_unique<xorinator::reservoir::Reservoir>(cmdln.reservoir); }
+		}
+
+		void fill(xorinator::byte_t* dst, size_t size) {
+			while(reservoir_ && (size > 0)) {
+				if((region_.size == 0) && ! reserve_(size)) break;
+				size_t take = std::min<uint64_t>(size, region_.size);
+				reservoir_->read(region_.offset, dst, take);
+				reservoir_->discard({ region_.offset, take });
+				region_.offset += take;
+				region_.size -= take;
+				dst += take;
+				size -= take;
+			}
+			rng_->fill(dst, size);
+		}
+	};
+
+
+	/** Generates the pads of a range of shares on its own thread, with
+	 * its own generator, and writes them to the shares; the thread that
+	 * combines the pads into the first share requests them block by
+	 * block. Requests alternate between two slots, so that the pads of
+	 * the next block are generated while the current one is combined.
+	 * An unthreaded worker generates the pads as they are requested. */
+	class PadWorker {
+	public:
+		using Pads = StaticVector<std::vector<xorinator::byte_t>>;
+
+	private:
+		RngAdapter rng_;
+		PadSource source_;
+		StaticVector<OutputStreamAdapter>* outputs_;
+		size_t firstShare_;
+		std::array<Pads, 2> pads_;
+		std::array<bool, 2> ready_;
+		std::deque<std::pair<unsigned, size_t>> requests_;
+		std::exception_ptr error_;
+		bool stopping_;
+		std::mutex mtx_;
+		std::condition_variable cv_;
+		std::thread thread_;
+
+		void generate_(unsigned slot, size_t size) {
+			for(size_t i=0; auto& pad : pads_[slot]) {
+				pad.resize(size);
+				source_.fill(pad.data(), size);
+				(*outputs_)[firstShare_ + (i++)].get().write(reinterpret_cast<const char*>(pad.data()), size);
+			}
+		}
+
+		void loop_() {
+			auto lock = std::unique_lock(mtx_);
+			while(true) {
+				cv_.wait(lock, [this]() { return stopping_ || ! requests_.empty(); });
+				if(requests_.empty()) return;
+				auto [slot, size] = requests_.front();
+				requests_.pop_front();
+				lock.unlock();
+				try {
+					generate_(slot, size);
+				} catch(...) {
+					lock.lock();
+					if(! error_) error_ = std::current_exception();
+					lock.unlock();
+				}
+				lock.lock();
+				ready_[slot] = true;
+				cv_.notify_all();
+			}
+		}
+
+	public:
+		PadWorker(const CommandLine& cmdln, StaticVector<OutputStreamAdapter>& outputs, size_t firstShare, size_t shareCount, bool threaded = true):
+				source_(cmdln, rng_),
+				outputs_(&outputs),
+				firstShare_(firstShare),
+				pads_({ Pads(shareCount), Pads(shareCount) }),
+				ready_({ false, false }),
+				stopping_(false)
+		{
+			if(threaded) {
+				thread_ = std::thread(&PadWorker::loop_, this); }
+		}
+
+		~PadWorker() {
+			{
+				auto lock = std::lock_guard(mtx_);
+				stopping_ = true;
+			}
+			cv_.notify_all();
+			if(thread_.joinable()) {
+				thread_.join(); }
+		}
+
+		PadWorker(const PadWorker&) = delete;
+		PadWorker& operator=(const PadWorker&) = delete;
+
+		/** Requests the next `size` bytes of every pad into the slot,
+		 * which must not be in use. */
+		void request(unsigned slot, size_t size) {
+			if(! thread_.joinable()) {
+				generate_(slot, size);
+				ready_[slot] = true;
+				return;
+			}
+			{
+				auto lock = std::lock_guard(mtx_);
+				ready_[slot] = false;
+				requests_.emplace_back(slot, size);
+			}
+			cv_.notify_all();
+		}
+
+		/** Waits for the pads requested into the slot, which have been
+		 * written to their shares; exceptions thrown by the worker
+		 * are rethrown here. */
+		const Pads& wait(unsigned slot) {
+			auto lock = std::unique_lock(mtx_);
+			cv_.wait(lock, [this, slot]() { return ready_[slot]; });
+			if(error_)  std::rethrow_exception(error_);
+			return pads_[slot];
+		}
+	};
+
+
+	using PrefetchingReaders = StaticVector<std::unique_ptr<xorinator::runtime::PrefetchingReader>>;
+
+	/** Starts reading every stream in blocks of the given size, each on
+	 * its own thread unless `depth` is 0. */
+	PrefetchingReaders mkPrefetchingReaders(StaticVector<InputStreamAdapter>& streams, size_t blockSize, unsigned depth = 2) {
+		auto r = PrefetchingReaders(streams.size());
+		for(size_t i=0; i < r.size(); ++i) {
+			r[i] = std::make_unique<xorinator::runtime::PrefetchingReader>(streams[i].get(), blockSize, depth); }
+		return r;
+	}
+
+
+	/** Returns the factor of every input of a demultiplexing operation:
+	 * 1 for every input of a XOR set, the Lagrange coefficients for the
+	 * first shares of a threshold set that are needed, 0 for the others. */
+	StaticVector<uint8_t> combineCoefficients(const StaticVector<container::ShareHeader>& headers, size_t inputCount) {
+		auto r = StaticVector<uint8_t>(inputCount);
+		std::fill(r.begin(), r.end(), 1);
+		if((! headers.empty()) && (headers.front().threshold() != 0)) {
+			auto xs = std::vector<uint8_t>(headers.front().threshold());
+			for(size_t i=0; i < xs.size(); ++i) {
+				xs[i] = headers[i].shareIndex + 1; }
+			auto coefficients = xorinator::gf256::lagrangeAtZero(xs);
+			for(size_t i=0; i < headers.size(); ++i) {
+				r[i] = (i < coefficients.size())? coefficients[i] : 0; }
+		}
+		return r;
+	}
+
+
+	/** Returns the number of bytes that can be read from an input that
+	 * has not been read yet, if it is a regular file. */
+	std::optional<uint64_t> unreadInputSize(std::istream& in, const std::string& name) {
+		if(auto* buf = dynamic_cast<xorinator::runtime::FdStreamBuf*>(in.rdbuf())) {
+			return xorinator::runtime::remainingFileSize(buf->fd()); }
+		if(dynamic_cast<std::filebuf*>(in.rdbuf()) != nullptr) {
+			namespace fs = std::filesystem;
+			std::error_code ec;
+			if(! fs::is_regular_file(name, ec))  return std::nullopt;
+			auto size = fs::file_size(name, ec);
+			auto pos = in.rdbuf()->pubseekoff(0, std::ios_base::cur, std::ios_base::in);
+			if((! ec) && (pos >= 0))  return (size > uint64_t(pos))? size - uint64_t(pos) : 0;
+		}
+		return std::nullopt;
+	}
+
+
+	/** Resolves the length of the output of a demultiplexing operation
+	 * from the sizes of its inputs (as returned by ::unreadInputSize,
+	 * before their container headers were read): it is the payload of
+	 * the shortest input with a nonzero coefficient, or `std::nullopt`
+	 * if the size of one of them is unknown.
+	 * Shares of a threshold set whose payloads differ are reported
+	 * before anything else is read, since litter cannot be added to
+	 * them: one of them must be truncated. */
+	std::optional<uint64_t> planDemuxLength(
+			const StaticVector<container::ShareHeader>& headers,
+			const StaticVector<std::optional<uint64_t>>& sizes,
+			const StaticVector<uint8_t>& coefficients,
+			const StaticVector<std::string>& names
+	) {
+		std::optional<uint64_t> length;
+		std::optional<size_t> firstInput;
+		for(size_t i=0; i < sizes.size(); ++i) {
+			if(coefficients[i] == 0) continue;
+			if(! sizes[i])  return std::nullopt;
+			uint64_t payload = (i < headers.size())? headers[i].payloadSize(*sizes[i]) : *sizes[i];
+			if(length && (payload != *length) && (! headers.empty()) && (headers.front().threshold() != 0)) {
+				throw container::ContainerFormatException(
+					"\"" + names[*firstInput] + "\" and \"" + names[i] + "\" have payloads of different sizes "
+					"(" + std::to_string(*length) + " and " + std::to_string(payload) + " bytes): one of them is truncated"); }
+			if((! length) || (payload < *length)) {
+				length = payload;
+				firstInput = i;
+			}
+		}
+		return length;
+	}
+
+
+	/** Reads the next block of every reader, and stores the sum of the
+	 * blocks multiplied by their coefficients into `dst` (with a single
+	 * ::xorinator::kernel::xorBlocks pass, if every nonzero coefficient
+	 * is 1); returns the
+	 * length of the shortest block with a nonzero coefficient, which is
+	 * shorter than `blockSize` only at the end of the shortest stream. */
+	size_t combineNextBlocks(
+			PrefetchingReaders& readers,
+			const StaticVector<uint8_t>& coefficients,
+			std::vector<xorinator::byte_t>& dst,
+			size_t blockSize
+	) {
+		size_t blockLength = blockSize;
+		bool xorOnly = true;
+		auto blocks = StaticVector<const uint8_t*>(readers.size());
+		size_t blockCount = 0;
+		for(size_t i=0; i < readers.size(); ++i) {
+			const auto& input = readers[i]->next();
+			if(coefficients[i] == 0) continue;
+			blockLength = std::min(blockLength, input.size());
+			blocks[blockCount++] = reinterpret_cast<const uint8_t*>(input.data());
+			xorOnly = xorOnly && (coefficients[i] == 1);
+		}
+		dst.resize(blockLength);
+		if(xorOnly) {
+			xorinator::kernel::xorBlocks(dst.data(), blocks.data(), blockCount, blockLength);
+		} else {
+			std::fill(dst.begin(), dst.end(), 0);
+			for(size_t i=0, b=0; i < readers.size(); ++i) {
+				if(coefficients[i] == 0) continue;
+				xorinator::gf256::mulAdd(dst.data(), blocks[b++], blockLength, coefficients[i]);
+			}
+		}
+		return blockLength;
+	}
+
+
+	/** Multiplexes `muxIn` into a k-of-n threshold set of share
+	 * containers, with Shamir's scheme over GF(2^8): every byte of the
+	 * input (XORed with the "--key" keystreams) is the constant term of
+	 * a random polynomial of degree k-1, and each share holds the values
+	 * of the polynomials at its index plus one. */
+	void muxThresholdStream(
+			const CommandLine& cmdln,
+			std::istream& muxIn,
+			StaticVector<OutputStreamAdapter>& muxFiles,
+			const StaticVector<std::string>& outPaths,
+			RngAdapter& rng
+	) {
+		using xorinator::byte_t;
+		constexpr size_t blockSize = 1 << 20;
+		assert(cmdln.threshold >= 2);
+		assert(cmdln.threshold <= muxFiles.size());
+
+		auto outputs = ShareOutputs(cmdln, muxFiles, mkShareHeaders(cmdln, muxFiles.size(), rng));
+		auto rngKeyStream = mkRngKeyStream(cmdln);
+		muxIn.exceptions(std::ios_base::badbit);
+		auto reader = xorinator::runtime::PrefetchingReader(muxIn, blockSize);
+		auto padSource = PadSource(cmdln, rng);
+		auto polyCoefficients = std::vector<std::vector<byte_t>>(cmdln.threshold - 1);
+		std::vector<byte_t> secret;
+		std::vector<byte_t> share;
+
+		bool atEnd = false;
+		while(! atEnd) {
+			const auto& block = reader.next();
+			atEnd = block.size() < blockSize;
+			secret.assign(block.begin(), block.end());
+			applyRngKeys(rngKeyStream, secret);
+			for(auto& coefficient : polyCoefficients) {
+				coefficient.resize(secret.size());
+				padSource.fill(coefficient.data(), coefficient.size());
+			}
+			for(size_t i=0; i < outputs.streams.size(); ++i) {
+				const uint8_t x = i + 1;
+				uint8_t power = 1;
+				share = secret;
+				for(const auto& coefficient : polyCoefficients) {
+					power = xorinator::gf256::mul(power, x);
+					xorinator::gf256::mulAdd(share.data(), coefficient.data(), share.size(), power);
+				}
+				outputs.streams[i].get().write(reinterpret_cast<const char*>(share.data()), share.size());
+			}
+		}
+
+		outputs.finish(cmdln, muxFiles, outPaths);
+	}
+
+
+	/** Multiplexes `muxIn` into the given outputs, using the
+	 * "--key", "--nogen" and "--reservoir" arguments of the command
+	 * line; the input is read in blocks by its own thread. If the
+	 * "--container" option is used, every output is written as a
+	 * share container, and if the "--index" option is used the integrity
+	 * index of every output is written next to it.
+	 * If the "--threshold" option is used, ::muxThresholdStream is used
+	 * instead; if the "--compress" option is used, the input is
+	 * compressed first.
+	 * The input is read from `offset`, where the outputs must be
+	 * positioned, to continue existing shares ("--resume" and "--append");
+	 * if `checkpoints` isn't null, the progress is committed to it.
+	 * If `deltaIndex` isn't null, the input and the shares are also
+	 * hashed into it, as the block index of "--delta". */
+	void muxStreams(
+			const CommandLine& cmdln,
+			std::istream& rawIn,
+			StaticVector<OutputStreamAdapter>& muxFiles,
+			const StaticVector<std::string>& outPaths,
+			RngAdapter& rng,
+			uint64_t offset = 0,
+			Checkpointer* checkpoints = nullptr,
+			xorinator::delta::IndexWriter* deltaIndex = nullptr
+	) {
+		using xorinator::byte_t;
+
+		std::unique_ptr<xorinator::compress::CompressingIStream> compressedIn;
+		if(cmdln.options & xorinator::cli::OptionBits::eCompress) {
+			rawIn.exceptions(std::ios_base::badbit);
+			compressedIn = std::make_unique<xorinator::compress::CompressingIStream>(rawIn);
+		}
+		std::istream& muxIn = compressedIn? *compressedIn : rawIn;
+
+		if(cmdln.threshold != 0) {
+			muxThresholdStream(cmdln, muxIn, muxFiles, outPaths, rng);
+			return;
+		}
+
+		constexpr size_t blockSize = 1 << 20;
+
+		// A small input (such as the ones sent to "xor serve") is read in one
+		// block of its size, and multiplexed without helper threads
+		auto inputSize = compressedIn? std::nullopt : unreadInputSize(rawIn, cmdln.firstArg);
+		if(inputSize) {
+			*inputSize -= std::min(*inputSize, offset); }
+		const size_t readSize = inputSize? std::clamp<uint64_t>(*inputSize + 1, 4096, blockSize) : blockSize;
+		const bool threaded = readSize == blockSize;
+
+		auto outputs = ShareOutputs(cmdln, muxFiles,
+			(cmdln.options & xorinator::cli::OptionBits::eContainer)?
+				mkShareHeaders(cmdln, muxFiles.size(), rng) :
+				StaticVector<container::ShareHeader>(),
+			threaded);
+		auto& muxOut = outputs.streams;
+
+		auto padSource = PadSource(cmdln, rng);
+		auto rngKeyStream = mkRngKeyStream(cmdln);
+		auto roKeyStreams = StaticVector<std::ifstream>(cmdln.roKeys.size());
+		auto roKeys = StaticVector<::StreamKey>(cmdln.roKeys.size());
+		auto roKeyViews = StaticVector<::StreamKey::View>(roKeys.size());
+		auto roKeyIterators = StaticVector<::StreamKey::View::Iterator>(roKeyViews.size());
+
+		for(size_t i=0; const std::string& key : cmdln.roKeys) {
+			roKeyStreams[i] = std::ifstream(key);
+			roKeys[i] = ::StreamKey(roKeyStreams[i]);
+			roKeyViews[i] = roKeys[i].view(0);
+			roKeyIterators[i].~Iterator(); // Much like Thanos, this is inevitable. Hopefully this can and does get optimized away.
+			new (&roKeyIterators[i]) ::StreamKey::View::Iterator(roKeyViews[i].begin());
+			++i;
+		}
+
+		if(offset > 0) {
+			seekContinuedInput(rawIn, cmdln.firstArg, offset);
+			rngKeyStream.discard(offset);
+			for(auto& keyIter : roKeyIterators) { // Past their end, the bytes of "--nogen" files depend on every byte before them
+				*keyIter;
+				for(uint64_t i=0; i < offset; ++i) {
+					++keyIter; }
+			}
+		}
+
+		// The pads of shares 1..N-1 are generated by PadWorker threads, share 0 is combined here
+		size_t workerCount = std::min<size_t>(muxOut.size() - 1,
+			((cmdln.options & xorinator::cli::OptionBits::eRecursive) || ! threaded)? 1 :
+			(cmdln.jobCount > 0)? cmdln.jobCount : std::max(1u, std::thread::hardware_concurrency()));
+		auto workers = StaticVector<std::unique_ptr<PadWorker>>(workerCount);
+		for(size_t i=0, first=1; i < workerCount; ++i) {
+			size_t count = (muxOut.size() - first) / (workerCount - i);
+			workers[i] = std::make_unique<PadWorker>(cmdln, muxOut, first, count, threaded);
+			first += count;
+		}
+
+		muxIn.exceptions(std::ios_base::badbit);
+		auto reader = xorinator::runtime::PrefetchingReader(muxIn, readSize, threaded? 2 : 0);
+		auto readBlock = [&](std::vector<byte_t>& dst, unsigned slot) {
+			const auto& block = reader.next();
+			dst.assign(block.begin(), block.end());
+			if(deltaIndex) {
+				deltaIndex->update(0, dst.data(), dst.size()); }
+			for(auto& worker : workers) {
+				worker->request(slot, dst.size()); }
+			return dst.size() < readSize;
+		};
+		std::vector<byte_t> sum;
+		std::vector<byte_t> nextSum;
+		auto blocks = StaticVector<const uint8_t*>(muxOut.size());
+
+		uint64_t done = offset;
+		unsigned slot = 0;
+		bool lastBlock = readBlock(sum, slot);
+		while(true) {
+			// The workers must be idle at checkpoints, so the next block is requested after them
+			const bool checkpointDue = checkpoints && checkpoints->due(done + sum.size());
+			bool nextIsLast = true;
+			if(! (lastBlock || checkpointDue)) {
+				// The other slot is free: let the workers start on the next block
+				nextIsLast = readBlock(nextSum, 1 - slot); }
+			applyRngKeys(rngKeyStream, sum);
+			for(auto& keyIter : roKeyIterators) {
+				for(auto& byte : sum) {
+					byte = byte ^ *keyIter;
+					++keyIter;
+				}
+			}
+			blocks[0] = sum.data();
+			for(size_t b=1; auto& worker : workers) {
+				for(const auto& pad : worker->wait(slot)) {
+					blocks[b++] = pad.data(); }
+			}
+			xorinator::kernel::xorBlocks(sum.data(), blocks.data(), blocks.size(), sum.size());
+			muxOut[0].get().write(reinterpret_cast<const char*>(sum.data()), sum.size());
+			if(deltaIndex) {
+				for(size_t i=0; i < blocks.size(); ++i) {
+					deltaIndex->update(i + 1, blocks[i], sum.size()); }
+			}
+			done += sum.size();
+			if(lastBlock) break;
+			if(checkpointDue) {
+				outputs.checkpoint(muxFiles, outPaths);
+				checkpoints->commit(done);
+				nextIsLast = readBlock(nextSum, 1 - slot);
+			}
+			std::swap(sum, nextSum);
+			lastBlock = nextIsLast;
+			slot = 1 - slot;
+		}
+
+		writeLitter(cmdln, muxOut, rng);
+		outputs.finish(cmdln, muxFiles, outPaths);
+	}
+
+
+	/** Opens the block index of a "--delta" operation, if its shares
+	 * can be patched: there must be as many as when the index was
+	 * written, all regular files as long as the source was then.
+	 * Returns null if every share must be multiplexed again. */
+	std::unique_ptr<xorinator::delta::IndexReader> openDeltaBase(const CommandLine& cmdln) {
+		namespace fs = std::filesystem;
+		std::error_code ec;
+		if(! fs::exists(cmdln.deltaIndex, ec)) return nullptr;
+		std::unique_ptr<xorinator::delta::IndexReader> index;
+		try {
+			index = std::make_unique<xorinator::delta::IndexReader>(cmdln.deltaIndex);
+		} catch(xorinator::delta::DeltaIndexException& ex) {
+			if(! (cmdln.options & xorinator::cli::OptionBits::eQuiet)) {
+				std::cerr << "Warning: " << ex.what() << "; multiplexing every share again." << std::endl; }
+			return nullptr;
+		}
+		if(index->shareCount() != cmdln.variadicArgs.size()) return nullptr;
+		for(const auto& path : cmdln.variadicArgs) {
+			if((! fs::is_regular_file(path, ec)) || (fs::file_size(path, ec) != index->dataSize()))
+				return nullptr;
+		}
+		return index;
+	}
+
+
+	/** The new block index of a "--delta" operation, written to a
+	 * temporary file that replaces the old index when committed, once
+	 * the shares are complete. */
+	class DeltaIndexOutput {
+	private:
+		const CommandLine& cmdln_;
+		std::string tmpPath_;
+		std::ofstream file_;
+		std::unique_ptr<xorinator::delta::IndexWriter> writer_;
+
+	public:
+		DeltaIndexOutput(const CommandLine& cmdln, uint32_t blockSize = xorinator::delta::DEFAULT_BLOCK_SIZE):
+				cmdln_(cmdln),
+				tmpPath_(cmdln.deltaIndex + ".tmp"),
+				file_(tmpPath_, std::ios_base::binary)
+		{
+			file_.exceptions(std::ios_base::badbit | std::ios_base::failbit);
+			writer_ = std::make_unique<xorinator::delta::IndexWriter>(file_, cmdln.variadicArgs.size(), blockSize);
+		}
+
+		~DeltaIndexOutput() {
+			if(writer_) {
+				file_.exceptions(std::ios_base::goodbit);
+				file_.close();
+				std::error_code ec;
+				std::filesystem::remove(tmpPath_, ec);
+			}
+		}
+
+		DeltaIndexOutput(const DeltaIndexOutput&) = delete;
+		DeltaIndexOutput& operator=(const DeltaIndexOutput&) = delete;
+
+		xorinator::delta::IndexWriter& writer() { return *writer_; }
+
+		void commit() {
+			writer_->finish();
+			commitOutput(cmdln_, file_, tmpPath_);
+			file_.close();
+			std::filesystem::rename(tmpPath_, cmdln_.deltaIndex);
+			writer_.reset();
+		}
+	};
+
+
+	#ifdef XORINATOR_POSIX_IO
+
+		/** The shares of a "--delta" operation, read and written at
+		 * arbitrary offsets. */
+		class DeltaShares {
+		private:
+			const StaticVector<std::string>& paths_;
+			StaticVector<int> writeFds_;
+			StaticVector<int> readFds_;
+			StaticVector<bool> written_;
+
+			[[noreturn]] void throwErrno_(const char* what, size_t i) {
+				throw std::runtime_error(std::string(what) + " \"" + paths_[i] + "\": " + std::strerror(errno)); }
+
+		public:
+			DeltaShares(const StaticVector<std::string>& paths, StaticVector<CheckedFd>& checkedFds, uint64_t size):
+					paths_(paths),
+					writeFds_(paths.size()),
+					readFds_(paths.size()),
+					written_(paths.size())
+			{
+				std::fill(writeFds_.begin(), writeFds_.end(), -1);
+				std::fill(readFds_.begin(), readFds_.end(), -1);
+				std::fill(written_.begin(), written_.end(), false);
+				for(size_t i=0; i < paths.size(); ++i) {
+					writeFds_[i] = checkedFds[i].valid()?
+						checkedFds[i].release(paths[i], size) :
+						::open(paths[i].c_str(), O_WRONLY | O_CLOEXEC);
+					if(writeFds_[i] < 0)  throwErrno_("could not open", i);
+					readFds_[i] = ::open(paths[i].c_str(), O_RDONLY | O_CLOEXEC);
+					if(readFds_[i] < 0)  throwErrno_("could not open", i);
+				}
+			}
+
+			~DeltaShares() {
+				for(int fd : writeFds_) { if(fd >= 0) ::close(fd); }
+				for(int fd : readFds_) { if(fd >= 0) ::close(fd); }
+			}
+
+			size_t size() const { return paths_.size(); }
+
+			void read(size_t i, uint64_t offset, xorinator::byte_t* dst, size_t size) {
+				while(size > 0) {
+					auto rd = ::pread(readFds_[i], dst, size, offset);
+					if(rd < 0) {
+						if(errno == EINTR)  continue;
+						throwErrno_("could not read", i);
+					}
+					if(rd == 0) {
+						throw std::runtime_error("\"" + paths_[i] + "\" was truncated during the operation"); }
+					dst += rd;
+					offset += rd;
+					size -= rd;
+				}
+			}
+
+			void write(size_t i, uint64_t offset, const xorinator::byte_t* src, size_t size) {
+				written_[i] = true;
+				while(size > 0) {
+					auto wr = ::pwrite(writeFds_[i], src, size, offset);
+					if(wr < 0) {
+						if(errno == EINTR)  continue;
+						throwErrno_("could not write", i);
+					}
+					src += wr;
+					offset += wr;
+					size -= wr;
+				}
+			}
+
+			void truncate(uint64_t size) {
+				for(size_t i=0; i < writeFds_.size(); ++i) {
+					if(0 != ::ftruncate(writeFds_[i], size))  throwErrno_("could not truncate", i);
+					written_[i] = true;
+				}
+			}
+
+			/** Waits for the written shares to reach the storage device,
+			 * unless the "--durability=none" option is used. */
+			void commit(const CommandLine& cmdln) {
+				if(cmdln.durability == Durability::eNone) return;
+				for(size_t i=0; i < writeFds_.size(); ++i) {
+					if(written_[i] && ! xorinator::runtime::syncFd(writeFds_[i])) {
+						throw std::runtime_error("could not sync \"" + paths_[i] + "\" to the storage device"); }
+				}
+			}
+		};
+
+
+		/** Checks that the shares of a "--delta" operation still hold what
+		 * the block index says, before anything is patched: shares that
+		 * were written since (for example by multiplexing without
+		 * "--delta") don't match the source the index describes. */
+		void checkDeltaShares(const CommandLine& cmdln, DeltaShares& shares, xorinator::delta::IndexReader& index) {
+			const uint32_t blockSize = index.blockSize();
+			auto block = std::vector<xorinator::byte_t>(blockSize);
+			for(uint64_t b=0; b < index.blockCount(); ++b) {
+				const uint64_t offset = b * blockSize;
+				const size_t len = std::min<uint64_t>(blockSize, index.dataSize() - offset);
+				const auto& record = index.record(b);
+				for(size_t i=0; i < shares.size(); ++i) {
+					shares.read(i, offset, block.data(), len);
+					if(xorinator::delta::blockDigest(block.data(), len) != record[i + 1]) {
+						throw std::runtime_error(
+							"\"" + cmdln.variadicArgs[i] + "\" doesn't match the block index \"" + cmdln.deltaIndex +
+							"\"; remove the index to multiplex every share again");
+					}
+				}
+			}
+		}
+
+
+		/** Multiplexes the source of a "--delta" operation into shares
+		 * that hold an older version of it, described by `oldIndex`.
+		 * Once the shares are checked against the index, only the blocks
+		 * whose SHA-256 digest changed are rewritten: share 0 as the XOR
+		 * of the source and of the other shares at their offset, which
+		 * are only written where the source grew (with new pads); the
+		 * shares are truncated where it shrank.
+		 * The block index is replaced once the shares are committed. */
+		void deltaMux(
+				const CommandLine& cmdln,
+				std::istream& in,
+				StaticVector<CheckedFd>& outFds,
+				xorinator::delta::IndexReader& oldIndex,
+				RngAdapter& rng
+		) {
+			using xorinator::byte_t;
+			using xorinator::delta::blockDigest;
+			const uint64_t oldSize = oldIndex.dataSize();
+			const uint32_t blockSize = oldIndex.blockSize();
+			auto shares = DeltaShares(cmdln.variadicArgs, outFds, oldSize);
+			auto padSource = PadSource(cmdln, rng);
+			checkDeltaShares(cmdln, shares, oldIndex);
+			auto newIndex = DeltaIndexOutput(cmdln, blockSize);
+
+			// The old index isn't valid anymore once a share is patched
+			std::filesystem::remove(cmdln.deltaIndex);
+
+			auto blockShares = std::vector<byte_t>(size_t(blockSize) * shares.size());
+			auto blocks = StaticVector<const uint8_t*>(shares.size());
+			auto newRecord = xorinator::delta::Record(shares.size() + 1);
+			// Rewrites a block as `src ^ pad 1 ^ ... ^ pad N-1` in share 0, where
+			// the pads are read from the other shares up to `keep` bytes, and
+			// new ones written to them after that
+			auto writeBlock = [&](uint64_t offset, const byte_t* src, size_t size, size_t keep) {
+				byte_t* sum = blockShares.data();
+				std::copy(src, src + size, sum);
+				blocks[0] = sum;
+				for(size_t i=1; i < shares.size(); ++i) {
+					byte_t* pad = blockShares.data() + (i * blockSize);
+					shares.read(i, offset, pad, keep);
+					if(size > keep) {
+						padSource.fill(pad + keep, size - keep);
+						shares.write(i, offset + keep, pad + keep, size - keep);
+					}
+					blocks[i] = pad;
+					newRecord[i + 1] = blockDigest(pad, size);
+				}
+				xorinator::kernel::xorBlocks(sum, blocks.data(), blocks.size(), size);
+				shares.write(0, offset, sum, size);
+				newRecord[1] = blockDigest(sum, size);
+			};
+
+			auto buffer = std::vector<byte_t>(size_t(blockSize) * std::max<size_t>(1, (1 << 20) / blockSize));
+			in.exceptions(std::ios_base::badbit);
+			uint64_t offset = 0;
+			while(true) {
+				in.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+				size_t n = in.gcount();
+				for(size_t pos=0; pos < n; pos += blockSize) {
+					const byte_t* block = buffer.data() + pos;
+					const uint64_t blockOffset = offset + pos;
+					const size_t len = std::min<size_t>(blockSize, n - pos);
+					const size_t oldLen = (blockOffset < oldSize)? std::min<uint64_t>(blockSize, oldSize - blockOffset) : 0;
+					newRecord[0] = blockDigest(block, len);
+					if(len == oldLen) {
+						const auto& oldRecord = oldIndex.record(blockOffset / blockSize);
+						if(newRecord[0] == oldRecord[0]) {
+							newIndex.writer().append(oldRecord, len);
+							continue;
+						}
+					}
+					writeBlock(blockOffset, block, len, std::min(len, oldLen));
+					newIndex.writer().append(newRecord, len);
+				}
+				offset += n;
+				if(n < buffer.size()) break;
+			}
+			if(offset < oldSize) {
+				shares.truncate(offset); }
+
+			shares.commit(cmdln);
+			newIndex.commit();
+		}
+
+	#endif
+
+
+	/** Demultiplexes the given inputs into `demuxOut`, using the "--key"
+	 * arguments of the command line; the output is as long as the
+	 * shortest input. If every input is a regular file, the length is
+	 * resolved by ::planDemuxLength before anything is read, and the
+	 * output is preallocated.
+	 * If the "--container" option is used, every input except the last
+	 * `cmdln.roKeys.size()` ones is read as a share container.
+	 * Inputs are read in blocks, each by its own thread unless the output
+	 * fits in one block.
+	 * The result is decompressed if the "--compress" option is used, or
+	 * if the share containers were multiplexed with it.
+	 * If `checkpoints` isn't null, the operation resumes from its offset
+	 * (where `demuxOut` must be positioned), and commits its progress
+	 * to it. */
+	void demuxStreams(
+			const CommandLine& cmdln,
+			StaticVector<InputStreamAdapter>& demuxFiles,
+			const StaticVector<std::string>& names,
+			std::ostream& demuxOut,
+			Checkpointer* checkpoints = nullptr
+	) {
+		using xorinator::byte_t;
+		constexpr size_t blockSize = 1 << 20;
+
+		const uint64_t resumeOffset = checkpoints? checkpoints->resumeOffset() : 0;
+		for(size_t i=0; i < demuxFiles.size(); ++i) {
+			seekContinuedInput(demuxFiles[i].get(), names[i], resumeOffset); }
+		auto sizes = StaticVector<std::optional<uint64_t>>(demuxFiles.size());
+		for(size_t i=0; i < sizes.size(); ++i) {
+			sizes[i] = unreadInputSize(demuxFiles[i].get(), names[i]); }
+		auto inputs = DemuxInputs(cmdln, demuxFiles, names);
+		auto coefficients = combineCoefficients(inputs.headers, inputs.streams.size());
+		auto length = planDemuxLength(inputs.headers, sizes, coefficients, names);
+		auto rngKeyStream = mkRngKeyStream(cmdln);
+		rngKeyStream.discard(resumeOffset);
+		auto readers = mkPrefetchingReaders(inputs.streams, blockSize, (length && (*length < blockSize))? 0 : 2);
+
+		demuxOut.exceptions(std::ios_base::badbit);
+		std::unique_ptr<xorinator::compress::DecompressingOStream> decompressedOut;
+		if(
+				(cmdln.options & xorinator::cli::OptionBits::eCompress) ||
+				((! inputs.headers.empty()) && (inputs.headers.front().flags & container::FLAG_COMPRESSED))
+		) {
+			decompressedOut = std::make_unique<xorinator::compress::DecompressingOStream>(demuxOut);
+			decompressedOut->exceptions(std::ios_base::badbit);
+		}
+		std::ostream& out = decompressedOut? *decompressedOut : demuxOut;
+
+		uint64_t done = resumeOffset;
+		auto advance = [&](size_t blockLength) {
+			done += blockLength;
+			if(checkpoints && checkpoints->due(done)) {
+				syncOutput(demuxOut, checkpoints->path(0));
+				checkpoints->commit(done);
+			}
+		};
+		std::vector<byte_t> block;
+		if(length) {
+			// Every input is known to be long enough: no block can end early
+			if(! decompressedOut) {
+				if(auto* buf = dynamic_cast<xorinator::runtime::FdStreamBuf*>(demuxOut.rdbuf())) {
+					xorinator::runtime::preallocateFd(buf->fd(), *length); }
+			}
+			for(uint64_t remaining = *length; remaining > 0; ) {
+				size_t blockLength = std::min<uint64_t>(remaining, blockSize);
+				if(combineNextBlocks(readers, coefficients, block, blockSize) < blockLength) {
+					throw std::runtime_error("an input was truncated while it was being read"); }
+				block.resize(blockLength);
+				applyRngKeys(rngKeyStream, block);
+				out.write(reinterpret_cast<const char*>(block.data()), blockLength);
+				remaining -= blockLength;
+				advance(blockLength);
+			}
+		} else {
+			bool atEnd = false;
+			while(! atEnd) {
+				size_t blockLength = combineNextBlocks(readers, coefficients, block, blockSize);
+				applyRngKeys(rngKeyStream, block);
+				atEnd = blockLength < blockSize;
+				out.write(reinterpret_cast<const char*>(block.data()), blockLength);
+				advance(blockLength);
+			}
+		}
+		if(decompressedOut) {
+			decompressedOut->finish(); }
+		demuxOut.flush();
+	}
+
+
+	/** A stream buffer that compares everything written to it with the
+	 * content of another stream, or hashes it if there is none; the first
+	 * difference interrupts the writer by throwing a Mismatch. */
+	class VerifyingOutputBuf : public std::streambuf {
+	public:
+		struct Mismatch { uint64_t offset; };
+
+	private:
+		static constexpr size_t blockSize = 1 << 20;
+		std::unique_ptr<xorinator::runtime::PrefetchingReader> original_;
+		std::vector<char> noBlock_;
+		const std::vector<char>* expected_;
+		size_t expectedPos_;
+		uint64_t offset_;
+		Sha256 hash_;
+
+	protected:
+		std::streamsize xsputn(const char* src, std::streamsize size) override {
+			if(! original_) {
+				hash_.update(src, size);
+				offset_ += size;
+				return size;
+			}
+			std::streamsize done = 0;
+			while(done < size) {
+				if(expectedPos_ == expected_->size()) {
+					expected_ = &original_->next();
+					expectedPos_ = 0;
+					if(expected_->empty())  throw Mismatch { offset_ };
+				}
+				size_t n = std::min<size_t>(size - done, expected_->size() - expectedPos_);
+				auto mismatch = std::mismatch(src + done, src + done + n, expected_->data() + expectedPos_);
+				if(mismatch.first != src + done + n) {
+					throw Mismatch { offset_ + (mismatch.first - (src + done)) }; }
+				done += n;
+				expectedPos_ += n;
+				offset_ += n;
+			}
+			return size;
+		}
+
+		int_type overflow(int_type c) override {
+			if(! traits_type::eq_int_type(c, traits_type::eof())) {
+				char ch = traits_type::to_char_type(c);
+				xsputn(&ch, 1);
+			}
+			return traits_type::not_eof(c);
+		}
+
+	public:
+		VerifyingOutputBuf(std::istream* original):
+				expected_(&noBlock_),
+				expectedPos_(0),
+				offset_(0)
+		{
+			if(original != nullptr) {
+				original->exceptions(std::ios_base::badbit);
+				original_ = std::make_unique<xorinator::runtime::PrefetchingReader>(*original, blockSize);
+			}
+		}
+
+		/** Returns a description of the difference between what has
+		 * been written and the expected content, if any. */
+		std::optional<std::string> finish(const Sha256::Digest& expectedDigest) {
+			if(original_) {
+				if((expectedPos_ < expected_->size()) || ! original_->next().empty()) {
+					return "mismatch at offset " + std::to_string(offset_); }
+			} else {
+				auto digest = hash_.finish();
+				if(digest != expectedDigest) {
+					return "hash mismatch (found sha256:" + Sha256::toHex(digest) + ')'; }
+			}
+			return std::nullopt;
+		}
+	};
+
+
+	/** Demultiplexes the given inputs with ::demuxStreams, but instead of
+	 * writing the result it compares it with `original`, or hashes it
+	 * and compares the digest with `expectedDigest` if `original` is null.
+	 * Returns a description of the first difference, if any. */
+	std::optional<std::string> verifyReconstruction(
+			const CommandLine& cmdln,
+			StaticVector<InputStreamAdapter>& demuxFiles,
+			const StaticVector<std::string>& names,
+			std::istream* original,
+			const Sha256::Digest& expectedDigest
+	) {
+		auto sink = VerifyingOutputBuf(original);
+		auto sinkStream = std::ostream(&sink);
+		try {
+			demuxStreams(cmdln, demuxFiles, names, sinkStream);
+		} catch(VerifyingOutputBuf::Mismatch& mismatch) {
+			return "mismatch at offset " + std::to_string(mismatch.offset);
+		}
+		return sink.finish(expectedDigest);
+	}
+
+
+	/** Replaces the shares read from `inFiles` with fresh ones, XORing a
+	 * random delta into each share: the deltas cancel out, so the new
+	 * shares combine into the same data as the old ones, which is never
+	 * reconstructed. The outputs are as long as the shortest input.
+	 * If the "--container" option is used, the shares must form a
+	 * complete set, and the new shares keep the headers of the old ones
+	 * but get a new set identifier, so that old and new shares cannot be
+	 * mixed: the new shares of an incomplete set would need the old
+	 * identifier to be combined with the rest of the set. */
+	void reshareStreams(
+			const CommandLine& cmdln,
+			StaticVector<InputStreamAdapter>& inFiles,
+			const StaticVector<std::string>& inPaths,
+			StaticVector<OutputStreamAdapter>& outFiles,
+			const StaticVector<std::string>& outPaths,
+			RngAdapter& rng
+	) {
+		using xorinator::byte_t;
+		constexpr size_t blockSize = 1 << 20;
+		assert(inFiles.size() == outFiles.size());
+
+		auto inputs = DemuxInputs(cmdln, inFiles, inPaths, false);
+		rejectThresholdSet(inputs.headers, "reshare");
+		auto headers = inputs.headers;
+		if(! headers.empty()) {
+			if(! shareSetIsComplete(headers)) {
+				throw container::ContainerFormatException(
+					"only a complete set of share containers can be reshared, so that old and new shares cannot be mixed"); }
+			auto setId = container::SetId();
+			for(auto& idByte : setId) {
+				idByte = rng(); }
+			for(auto& hdr : headers) {
+				hdr.setId = setId; }
+		}
+		auto outputs = ShareOutputs(cmdln, outFiles, headers);
+
+		auto readers = mkPrefetchingReaders(inputs.streams, blockSize);
+		// Share i > 0 gets the i-th delta, share 0 gets all of them
+		auto deltas = std::vector<byte_t>(blockSize * (readers.size() - 1));
+		auto outBlock = std::vector<byte_t>(blockSize);
+		auto srcs = StaticVector<const uint8_t*>(readers.size());
+
+		bool atEnd = false;
+		while(! atEnd) {
+			size_t blockLength = blockSize;
+			for(size_t i=0; i < readers.size(); ++i) {
+				const auto& block = readers[i]->next();
+				srcs[i] = reinterpret_cast<const uint8_t*>(block.data());
+				blockLength = std::min(blockLength, block.size());
+			}
+			atEnd = blockLength < blockSize;
+			for(size_t i=1; i < srcs.size(); ++i) {
+				byte_t* delta = deltas.data() + ((i-1) * blockSize);
+				rng.fill(delta, blockLength);
+				const uint8_t* pair[2] = { srcs[i], delta };
+				xorinator::kernel::xorBlocks(outBlock.data(), pair, 2, blockLength);
+				outputs.streams[i].get().write(reinterpret_cast<const char*>(outBlock.data()), blockLength);
+				srcs[i] = delta;
+			}
+			xorinator::kernel::xorBlocks(outBlock.data(), srcs.data(), srcs.size(), blockLength);
+			outputs.streams[0].get().write(reinterpret_cast<const char*>(outBlock.data()), blockLength);
+		}
+
+		writeLitter(cmdln, outputs.streams, rng);
+		outputs.finish(cmdln, outFiles, outPaths);
+	}
+
+
+	/** Splits the share read from `inFiles[0]` into two: the first output
+	 * is the share XORed with random data, the second one is the random
+	 * data. If the "--container" option is used, the outputs are the
+	 * children of the share's node in its split tree (see
+	 * container::nodeBit): the first one takes the share's mask plus the
+	 * bit of the first child, the second one takes the bit of the other
+	 * child. The old share then overlaps with the first output, and
+	 * cannot complete a set with the second one alone. */
+	void splitShareStream(
+			const CommandLine& cmdln,
+			StaticVector<InputStreamAdapter>& inFiles,
+			const StaticVector<std::string>& inPaths,
+			StaticVector<OutputStreamAdapter>& outFiles,
+			const StaticVector<std::string>& outPaths,
+			RngAdapter& rng
+	) {
+		constexpr size_t blockSize = 1 << 20;
+		assert(inFiles.size() == 1);
+		assert(outFiles.size() == 2);
+
+		auto inputs = DemuxInputs(cmdln, inFiles, inPaths, false);
+		rejectThresholdSet(inputs.headers, "split-share");
+		auto headers = StaticVector<container::ShareHeader>(inputs.headers.size() * 2);
+		if(! headers.empty()) {
+			const auto& src = inputs.headers.front();
+			const auto [root, node] = src.splitNode();
+			const unsigned bitA = container::nodeBit(src.shareCount, root, (2 * node) + 1);
+			const unsigned bitB = container::nodeBit(src.shareCount, root, (2 * node) + 2);
+			if(bitB >= container::MAX_SHARES) {
+				throw container::ContainerFormatException(
+					"the share masks of the set have no room to split \"" + inPaths[0] + "\" again"); }
+			headers[0] = src;
+			headers[0].shareMask = src.shareMask | (uint64_t(1) << bitA);
+			headers[1] = src;
+			headers[1].shareMask = uint64_t(1) << bitB;
+		}
+		auto outputs = ShareOutputs(cmdln, outFiles, headers);
+
+		auto reader = xorinator::runtime::PrefetchingReader(inputs.streams[0].get(), blockSize);
+		auto pad = std::vector<xorinator::byte_t>(blockSize);
+		auto outBlock = std::vector<xorinator::byte_t>(blockSize);
+		bool atEnd = false;
+		while(! atEnd) {
+			const auto& block = reader.next();
+			atEnd = block.size() < blockSize;
+			rng.fill(pad.data(), block.size());
+			const uint8_t* srcs[2] = { reinterpret_cast<const uint8_t*>(block.data()), pad.data() };
+			xorinator::kernel::xorBlocks(outBlock.data(), srcs, 2, block.size());
+			outputs.streams[0].get().write(reinterpret_cast<const char*>(outBlock.data()), block.size());
+			outputs.streams[1].get().write(reinterpret_cast<const char*>(pad.data()), block.size());
+		}
+
+		writeLitter(cmdln, outputs.streams, rng);
+		outputs.finish(cmdln, outFiles, outPaths);
+	}
+
+
+	/** Writes the XOR sum of the shares read from `inFiles` as a single
+	 * share, as long as the shortest one. If the "--container" option is
+	 * used, the new share contains every share of the inputs, and the
+	 * inputs cannot be a complete set: collapsing it would yield the
+	 * original data. */
+	void collapseStreams(
+			const CommandLine& cmdln,
+			StaticVector<InputStreamAdapter>& inFiles,
+			const StaticVector<std::string>& inPaths,
+			OutputStreamAdapter& outFile,
+			const std::string& outPath
+	) {
+		using xorinator::byte_t;
+		constexpr size_t blockSize = 1 << 20;
+
+		auto inputs = DemuxInputs(cmdln, inFiles, inPaths, false);
+		rejectThresholdSet(inputs.headers, "collapse");
+		auto headers = StaticVector<container::ShareHeader>(inputs.headers.empty()? 0 : 1);
+		if(! headers.empty()) {
+			if(shareSetIsComplete(inputs.headers)) {
+				throw container::ContainerFormatException(
+					"the shares form a complete set, and cannot be collapsed into one"); }
+			headers[0] = inputs.headers.front();
+			for(const auto& hdr : inputs.headers) {
+				headers[0].shareIndex = std::min(headers[0].shareIndex, hdr.shareIndex);
+				headers[0].shareMask = headers[0].shareMask | hdr.shareMask;
+			}
+		}
+		auto outFiles = StaticVector<OutputStreamAdapter>(1);
+		outFiles[0] = OutputStreamAdapter(outFile.get());
+		auto outPaths = StaticVector<std::string> { outPath };
+		auto outputs = ShareOutputs(cmdln, outFiles, headers);
+
+		auto readers = mkPrefetchingReaders(inputs.streams, blockSize);
+		auto coefficients = combineCoefficients(inputs.headers, readers.size());
+		std::vector<byte_t> block;
+		bool atEnd = false;
+		while(! atEnd) {
+			size_t blockLength = combineNextBlocks(readers, coefficients, block, blockSize);
+			atEnd = blockLength < blockSize;
+			outputs.streams[0].get().write(reinterpret_cast<const char*>(block.data()), blockLength);
+		}
+
+		outputs.finish(cmdln, outFiles, outPaths);
+	}
+
+
+	/** Demultiplexes a complete set of share containers, processing
+	 * chunks in parallel: each worker reads its own range of chunks from
+	 * every input and writes the result at the same offset of the
+	 * (preallocated) output file. Every file is opened once, and its
+	 * descriptor is shared by the workers; the checked descriptors are
+	 * used if there are any.
+	 * All inputs must be seekable files, and "--key" arguments cannot be
+	 * used since their keystream cannot be sought.
+	 * Returns `false`, leaving the checked descriptors untouched, if the
+	 * set can't be demultiplexed this way. */
+	bool demuxContainersParallel(
+			const CommandLine& cmdln,
+			const StaticVector<std::string>& inPaths,
+			StaticVector<CheckedFd>& inFds,
+			const std::string& outPath,
+			CheckedFd& outFd
+	) {
+		#ifdef XORINATOR_POSIX_IO
+			using xorinator::runtime::readAt;
+			using xorinator::runtime::writeAt;
+			assert(cmdln.rngKeys.empty());
+
+			const size_t containerCount = inPaths.size() - cmdln.roKeys.size();
+			const auto noFd = CheckedFd();
+			auto inputs = StaticVector<SharedFd>(inPaths.size());
+			auto headers = StaticVector<container::ShareHeader>(containerCount);
+			auto fileSizes = StaticVector<std::optional<uint64_t>>(inPaths.size());
+			for(size_t i=0; i < inPaths.size(); ++i) {
+				inputs[i].open((i < inFds.size())? inFds[i] : noFd, inPaths[i], O_RDONLY, "reading");
+				fileSizes[i] = xorinator::runtime::remainingFileSize(inputs[i].get()); // Still at offset 0
+				if(! fileSizes[i])  return false;
+				if(i < containerCount) {
+					std::array<char, container::ShareHeader::SIZE> buffer;
+					size_t got = readAt(inputs[i].get(), buffer.data(), buffer.size(), 0);
+					headers[i] = container::ShareHeader::parse(buffer.data(), got, inPaths[i]);
+				}
+			}
+			validateShareSet(cmdln, headers, inPaths, true);
+			if(headers[0].flags & container::FLAG_COMPRESSED) {
+				return false; } // Chunks of compressed data cannot be decompressed independently
+			auto coefficients = combineCoefficients(headers, inPaths.size());
+			const bool xorOnly = std::all_of(coefficients.begin(), coefficients.end(), [](uint8_t c) { return c <= 1; });
+			const uint64_t outLen = planDemuxLength(headers, fileSizes, coefficients, inPaths).value();
+
+			auto output = SharedFd();
+			if(outFd.valid()) {
+				output.adopt(outFd.release(outPath));
+			} else {
+				output.open(noFd, outPath, O_WRONLY | O_CREAT | O_TRUNC, "writing");
+			}
+			if(0 != ::ftruncate(output.get(), outLen)) { // Preallocate the output
+				throw std::runtime_error("could not resize \"" + outPath + "\": " + std::strerror(errno)); }
+			if(outLen == 0) return true;
+
+			const uint64_t chunkSize = headers[0].chunkSize;
+			const uint64_t chunkCount = (outLen + chunkSize - 1) / chunkSize;
+			auto pool = WorkStealingPool(cmdln.jobCount);
+			const uint64_t chunksPerTask = std::max<uint64_t>(1, chunkCount / (pool.workerCount() * 4));
+			std::mutex errMtx;
+			std::exception_ptr error;
+
+			for(uint64_t firstChunk = 0; firstChunk < chunkCount; firstChunk += chunksPerTask) {
+				uint64_t lastChunk = std::min(chunkCount, firstChunk + chunksPerTask);
+				pool.push([&, firstChunk, lastChunk]() {
+					try {
+						// XOR sets are combined in one pass, so every input needs its own buffer;
+						// the header of a chunk is read along with its payload
+						auto acc = std::vector<char>(chunkSize);
+						auto buffers = StaticVector<std::vector<char>>(xorOnly? inputs.size() : 1);
+						auto blocks = StaticVector<const uint8_t*>(inputs.size());
+						for(auto& buffer : buffers) {
+							buffer.resize(container::ChunkHeader::SIZE + chunkSize); }
+						for(uint64_t chunk = firstChunk; chunk < lastChunk; ++chunk) {
+							const uint64_t offset = chunk * chunkSize;
+							const size_t len = std::min(chunkSize, outLen - offset);
+							size_t blockCount = 0;
+							if(! xorOnly) {
+								std::fill_n(acc.begin(), len, 0); }
+							for(size_t i=0; i < inputs.size(); ++i) {
+								if(coefficients[i] == 0) continue;
+								auto& buffer = buffers[xorOnly? i : 0];
+								const char* payload = buffer.data();
+								if(i < containerCount) {
+									const size_t want = container::ChunkHeader::SIZE + len;
+									if(readAt(inputs[i].get(), buffer.data(), want, headers[i].chunkOffset(chunk)) < want) {
+										throw container::ContainerFormatException(
+											'"' + inPaths[i] + "\" has a truncated chunk (" + std::to_string(chunk) + ')'); }
+									container::ChunkHeader chunkHdr;
+									chunkHdr.parse(buffer.data());
+									if((chunkHdr.index != chunk) || (chunkHdr.payloadSize < len) || (chunkHdr.payloadSize > chunkSize)) {
+										throw container::ContainerFormatException(
+											'"' + inPaths[i] + "\" has a malformed chunk (" + std::to_string(chunk) + ')'); }
+									payload += container::ChunkHeader::SIZE;
+								} else
+								if(readAt(inputs[i].get(), buffer.data(), len, offset) < len) {
+									throw std::runtime_error("\"" + inPaths[i] + "\" was truncated during the operation");
+								}
+								if(xorOnly) {
+									blocks[blockCount++] = reinterpret_cast<const uint8_t*>(payload);
+								} else {
+									xorinator::gf256::mulAdd(
+										reinterpret_cast<uint8_t*>(acc.data()), reinterpret_cast<const uint8_t*>(payload),
+										len, coefficients[i]);
+								}
+							}
+							if(xorOnly) {
+								xorinator::kernel::xorBlocks(reinterpret_cast<uint8_t*>(acc.data()), blocks.data(), blockCount, len); }
+							writeAt(output.get(), acc.data(), len, offset);
+						}
+					} catch(...) {
+						auto lock = std::lock_guard(errMtx);
+						if(! error) error = std::current_exception();
+					}
+				});
+			}
+			pool.wait();
+			if(error) std::rethrow_exception(error);
+			// Chunks are written out of order, so the output is only synced at the end
+			if((cmdln.durability != Durability::eNone) && ! xorinator::runtime::syncFd(output.get())) {
+				throw std::runtime_error("could not sync \"" + outPath + "\" to the storage device"); }
+			return true;
+		#else
+			(void) cmdln;
+			(void) inPaths;
+			(void) inFds;
+			(void) outPath;
+			(void) outFd;
+			return false; // The workers need positioned reads and writes
+		#endif
+	}
+
+
+	/** Files smaller than this are grouped with others into a single task
+	 * by recursive operations. */
+	constexpr uintmax_t SMALL_FILE_SIZE = 256 * 1024;
+
+	/** A batch of small files is closed when its total size reaches
+	 * BATCH_MAX_BYTES, or when it holds BATCH_MAX_FILES files. */
+	constexpr uintmax_t BATCH_MAX_BYTES = 8 * 1024 * 1024;
+	constexpr size_t BATCH_MAX_FILES = 256;
+
+
+	/** Checks whether `path` is `root` or is contained in it, without
+	 * requiring either to exist. */
+	bool pathIsWithin(const std::filesystem::path& path, const std::filesystem::path& root) {
+		auto canonPath = std::filesystem::weakly_canonical(path);
+		auto canonRoot = std::filesystem::weakly_canonical(root);
+		auto mismatch = std::mismatch(canonRoot.begin(), canonRoot.end(), canonPath.begin(), canonPath.end());
+		return (mismatch.first == canonRoot.end()) || mismatch.first->empty();
+	}
+
+
+	/** Runs a multiplexing or demultiplexing operation over every regular
+	 * file of a directory tree, mirroring its structure.
+	 * Files are scheduled on a WorkStealingPool, largest first, and small
+	 * files are batched together in order to reduce per-task overhead. */
+	template<bool muxNotDemux>
+	bool runRecursive(const CommandLine& cmdln) {
+		namespace fs = std::filesystem;
+		using CmdlnException = xorinator::cli::InvalidCommandLineException;
+
+		struct FileEntry {
+			fs::path relPath;
+			uintmax_t size;
+		};
+
+		const bool quiet = cmdln.options & xorinator::cli::OptionBits::eQuiet;
+		const bool force = cmdln.options & xorinator::cli::OptionBits::eForce;
+
+		if(! cmdln.roKeys.empty()) {
+			throw CmdlnException("\"--nogen\" arguments cannot be used for recursive operations"); }
+		if(cmdln.firstArg == "-") {
+			throw CmdlnException("standard input and output cannot be used for recursive operations"); }
+		for(const auto& path : cmdln.variadicArgs) {
+			if(path == "-") {
+				throw CmdlnException("standard input and output cannot be used for recursive operations"); }
+		}
+
+		/* The source tree is the first argument when multiplexing, or the
+		 * first share tree when demultiplexing. */
+		const fs::path srcRoot = muxNotDemux? fs::path(cmdln.firstArg) : fs::path(cmdln.variadicArgs[0]);
+		if(! fs::is_directory(srcRoot)) {
+			throw CmdlnException('"' + srcRoot.string() + "\" is not a directory"); }
+		auto dstRoots = StaticVector<fs::path>(muxNotDemux? cmdln.variadicArgs.size() : 1);
+		auto shareRoots = StaticVector<fs::path>(muxNotDemux? 0 : cmdln.variadicArgs.size());
+		if constexpr(muxNotDemux) {
+			for(size_t i=0; i < dstRoots.size(); ++i) {
+				dstRoots[i] = cmdln.variadicArgs[i];
+				if(pathIsWithin(dstRoots[i], srcRoot)) {
+					throw CmdlnException('"' + dstRoots[i].string() + "\" is inside the source directory"); }
+			}
+		} else {
+			dstRoots[0] = cmdln.firstArg;
+			for(size_t i=0; i < shareRoots.size(); ++i) {
+				shareRoots[i] = cmdln.variadicArgs[i];
+				if(pathIsWithin(dstRoots[0], shareRoots[i])) {
+					throw CmdlnException('"' + dstRoots[0].string() + "\" is inside a source directory"); }
+			}
+		}
+
+		std::vector<FileEntry> files;
+		{ // Walk the source tree, mirroring its directories
+			for(const auto& dstRoot : dstRoots) {
+				fs::create_directories(dstRoot); }
+			for(auto iter = fs::recursive_directory_iterator(srcRoot); iter != fs::recursive_directory_iterator(); ++iter) {
+				const auto& entry = *iter;
+				auto relPath = entry.path().lexically_relative(srcRoot);
+				if(entry.is_symlink()) {
+					if(! quiet) std::cerr << "Warning: skipping symbolic link \"" << entry.path().string() << "\"." << std::endl;
+				} else
+				if(entry.is_directory()) {
+					for(const auto& dstRoot : dstRoots) {
+						fs::create_directories(dstRoot / relPath); }
+				} else
+				if(entry.is_regular_file()) {
+					files.push_back({ std::move(relPath), entry.file_size() });
+				} else {
+					if(! quiet) std::cerr << "Warning: skipping special file \"" << entry.path().string() << "\"." << std::endl;
+				}
+			}
+			/* Scheduling the largest files first keeps the tail of the
+			 * operation short: every worker runs its files in this order,
+			 * and work stealing moves the smallest ones. */
+			std::sort(files.begin(), files.end(), [](const FileEntry& l, const FileEntry& r) {
+				return l.size > r.size; });
+		}
+
+		std::mutex errMtx;
+		std::atomic_bool failed = false;
+		// The generator of a batch is built by its first file, so that its failure is reported like any other
+		auto processFile = [&](const fs::path& relPath, std::optional<RngAdapter>& rng) {
+			auto reportError = [&](const char* what) {
+				failed = true;
+				if(! quiet) {
+					auto lock = std::lock_guard(errMtx);
+					std::cerr << "Error: \"" << relPath.string() << "\": " << what << '.' << std::endl;
+				}
+			};
+			try {
+				if constexpr(muxNotDemux) {
+					auto inPath = (srcRoot / relPath).string();
+					auto outPaths = StaticVector<std::string>(dstRoots.size());
+					for(size_t i=0; i < dstRoots.size(); ++i) {
+						outPaths[i] = (dstRoots[i] / relPath).string(); }
+					auto inFd = CheckedFd();
+					auto outFds = StaticVector<CheckedFd>(outPaths.size());
+					#ifdef XORINATOR_UNIX_PERM_CHECK
+						if(! force) {
+							inFd = openChecked<04>(inPath);
+							for(size_t i=0; i < outPaths.size(); ++i) {
+								outFds[i] = openChecked<02>(outPaths[i]); }
+						}
+					#endif
+					auto muxIn = InputStreamAdapter(inPath, true, std::move(inFd));
+					auto muxOut = StaticVector<OutputStreamAdapter>(outPaths.size());
+					for(size_t i=0; i < outPaths.size(); ++i) {
+						muxOut[i] = OutputStreamAdapter(outPaths[i], true, std::move(outFds[i])); }
+					if(! rng)  rng.emplace();
+					muxStreams(cmdln, muxIn, muxOut, outPaths, *rng);
+				} else {
+					auto outPath = (dstRoots[0] / relPath).string();
+					auto inPaths = StaticVector<std::string>(shareRoots.size());
+					for(size_t i=0; i < shareRoots.size(); ++i) {
+						inPaths[i] = (shareRoots[i] / relPath).string();
+						if(! fs::is_regular_file(inPaths[i])) {
+							throw xorinator::runtime::FilePermissionException('"' + inPaths[i] + "\" is missing or is not a regular file"); }
+					}
+					auto outFd = CheckedFd();
+					auto inFds = StaticVector<CheckedFd>(inPaths.size());
+					#ifdef XORINATOR_UNIX_PERM_CHECK
+						if(! force) {
+							outFd = openChecked<02>(outPath);
+							for(size_t i=0; i < inPaths.size(); ++i) {
+								inFds[i] = openChecked<04>(inPaths[i]); }
+						}
+					#endif
+					auto demuxOut = OutputStreamAdapter(outPath, true, std::move(outFd));
+					auto demuxIn = StaticVector<InputStreamAdapter>(inPaths.size());
+					for(size_t i=0; i < inPaths.size(); ++i) {
+						demuxIn[i] = InputStreamAdapter(inPaths[i], true, std::move(inFds[i])); }
+					startWriteback(cmdln, demuxOut.get());
+					demuxStreams(cmdln, demuxIn, inPaths, demuxOut);
+					commitOutput(cmdln, demuxOut.get(), outPath);
+				}
+			} catch(std::exception& ex) {
+				reportError(ex.what());
+			} catch(...) {
+				reportError("unknown error");
+			}
+		};
+
+		{ // Schedule the files, small ones in batches
+			auto pool = WorkStealingPool(cmdln.jobCount);
+			auto scheduleBatch = [&](std::vector<fs::path> batch) {
+				pool.push([&processFile, batch = std::move(batch)]() {
+					std::optional<RngAdapter> rng;
+					for(const auto& relPath : batch) {
+						processFile(relPath, rng); }
+				});
+			};
+			std::vector<fs::path> batch;
+			uintmax_t batchSize = 0;
+			for(auto& file : files) {
+				if(file.size >= SMALL_FILE_SIZE) {
+					scheduleBatch({ std::move(file.relPath) });
+				} else {
+					batchSize += file.size;
+					batch.push_back(std::move(file.relPath));
+					if((batchSize >= BATCH_MAX_BYTES) || (batch.size() >= BATCH_MAX_FILES)) {
+						scheduleBatch(std::move(batch));
+						batch = { };
+						batchSize = 0;
+					}
+				}
+			}
+			if(! batch.empty()) {
+				scheduleBatch(std::move(batch)); }
+			pool.wait();
+		}
+
+		return ! failed;
+	}
+
+
+	/** Checks every share against its own integrity index, only reading
+	 * the blocks within the "--range" argument. */
+	bool verifyIndices(const CommandLine& cmdln) {
+		const bool quiet = cmdln.options & xorinator::cli::OptionBits::eQuiet;
+		auto shares = StaticVector<std::string>(cmdln.variadicArgs.size() + 1);
+		shares[0] = cmdln.firstArg;
+		std::copy(cmdln.variadicArgs.begin(), cmdln.variadicArgs.end(), shares.begin() + 1);
+
+		auto checkedFds = StaticVector<CheckedFd>(shares.size());
+		#ifdef XORINATOR_UNIX_PERM_CHECK
+			if(! (cmdln.options & xorinator::cli::OptionBits::eForce)) {
+				for(size_t i=0; i < shares.size(); ++i) {
+					checkedFds[i] = openChecked<04>(shares[i]); }
+			}
+		#endif
+
+		bool allOk = true;
+		for(size_t i=0; i < shares.size(); ++i) {
+			const auto& path = shares[i];
+			auto index = integrity::IndexReader(integrity::IntegrityIndex::pathFor(path));
+			auto shareAdapter = InputStreamAdapter(path, true, std::move(checkedFds[i]));
+			auto& share = shareAdapter.get();
+			if(! share) {
+				throw xorinator::runtime::FilePermissionException("could not open \"" + path + "\" for reading"); }
+			uint64_t begin = cmdln.rangeBegin;
+			uint64_t end = cmdln.rangeEnd;
+			bool wholeShare = (begin == 0) && (end == std::numeric_limits<uint64_t>::max());
+			if((! wholeShare) && (cmdln.options & xorinator::cli::OptionBits::eContainer)) {
+				/* The range refers to the payload of the container: check
+				 * every chunk that overlaps with it, headers included. */
+				auto hdr = container::ShareHeader::read(share, path);
+				uint64_t lastChunk = (end / hdr.chunkSize) + ((end % hdr.chunkSize != 0)? 1 : 0);
+				begin = (begin < hdr.chunkSize)? 0 : hdr.chunkOffset(begin / hdr.chunkSize);
+				end = (lastChunk > (std::numeric_limits<uint64_t>::max() / hdr.chunkSize))?
+					std::numeric_limits<uint64_t>::max() :
+					hdr.chunkOffset(lastChunk);
+			}
+			std::string failure;
+			uint64_t shareSize = 0;
+			if(wholeShare) { // Measured on the open share, rather than on whatever the path names now
+				shareSize = share.seekg(0, std::ios_base::end).tellg();
+				share.seekg(0);
+			}
+			if(wholeShare && (shareSize != index.dataSize())) {
+				failure = "size mismatch (expected " + std::to_string(index.dataSize()) +
+					" bytes, found " + std::to_string(shareSize) + ')';
+			} else
+			if(auto badOffset = integrity::verifyShare(share, index, begin, end)) {
+				failure = "corrupted block at offset " + std::to_string(*badOffset);
+			}
+			if(! failure.empty())  allOk = false;
+			if(! quiet) {
+				std::cout << '"' << path << "\": " << (failure.empty()? std::string("OK") : failure) << '\n'; }
+		}
+		std::cout << std::flush;
+		return allOk;
+	}
+
+}
+
+
+
+namespace xorinator::runtime {
+
+	bool runMux(const CommandLine& cmdln) {
+		assert(cmdln.cmdType == cli::CmdType::eMultiplex);
+		const bool recursive = cmdln.options & cli::OptionBits::eRecursive;
+
+		auto inFd = CheckedFd();
+		auto outFds = StaticVector<CheckedFd>(cmdln.variadicArgs.size());
+		#ifdef XORINATOR_UNIX_PERM_CHECK
+			if((! recursive) && (! (cmdln.options & cli::OptionBits::eForce))) {
+				inFd = openChecked<04>(cmdln.firstArg);
+				for(size_t i=0; i < outFds.size(); ++i) {
+					outFds[i] = openChecked<02>(cmdln.variadicArgs[i]); }
+			}
+		#endif
+
+		checkPaths(cmdln);
+		checkArgumentUsage(cmdln);
+		tryWarnRngKeyDeprecated(cmdln);
+
+		if(recursive) {
+			return runRecursive<true>(cmdln); }
+
+		auto checkpoints = mkCheckpointer(cmdln, cmdln.variadicArgs);
+		const uint64_t offset =
+			checkpoints? checkpoints->resumeOffset() :
+			(cmdln.options & cli::OptionBits::eAppend)? appendOffset(cmdln) :
+			0;
+		auto muxIn = InputStreamAdapter(cmdln.firstArg, cmdln.firstLiteralArg <= 0, std::move(inFd));
+		auto muxOut = StaticVector<OutputStreamAdapter>(cmdln.variadicArgs.size());
+		RngAdapter rng;
+
+		const bool delta = ! cmdln.deltaIndex.empty();
+		if(delta) {
+			if(auto deltaBase = openDeltaBase(cmdln)) {
+				#ifdef XORINATOR_POSIX_IO
+					deltaMux(cmdln, muxIn, outFds, *deltaBase, rng);
+					return true;
+				#else
+					throw std::runtime_error("shares cannot be patched on this platform");
+				#endif
+			}
+			// The shares are about to be replaced, and no longer match the index
+			std::error_code ec;
+			std::filesystem::remove(cmdln.deltaIndex, ec);
+		}
+
+		for(unsigned i=0; const std::string& path : cmdln.variadicArgs) {
+			muxOut[i] = (offset > 0)?
+				openContinuedOutput(path, std::move(outFds[i]), offset) :
+				OutputStreamAdapter(path, cmdln.firstLiteralArg <= (i+1), std::move(outFds[i]));
+			++i;
+		}
+
+		auto deltaIndex = delta? std::make_unique<DeltaIndexOutput>(cmdln) : nullptr;
+		muxStreams(cmdln, muxIn, muxOut, cmdln.variadicArgs, rng, offset, checkpoints.get(), delta? &deltaIndex->writer() : nullptr);
+		if(checkpoints) {
+			checkpoints->complete(); }
+		if(delta) {
+			deltaIndex->commit(); }
+		return true;
+	}
+
+
+	bool runDemux(const CommandLine& cmdln) {
+		assert(cmdln.cmdType == cli::CmdType::eDemultiplex);
+		const bool recursive = cmdln.options & cli::OptionBits::eRecursive;
+
+		auto outFd = CheckedFd();
+		auto inFds = StaticVector<CheckedFd>(cmdln.variadicArgs.size());
+		#ifdef XORINATOR_UNIX_PERM_CHECK
+			if((! recursive) && (! (cmdln.options & cli::OptionBits::eForce))) {
+				outFd = openChecked<02>(cmdln.firstArg);
+				for(size_t i=0; i < inFds.size(); ++i) {
+					inFds[i] = openChecked<04>(cmdln.variadicArgs[i]); }
+			}
+		#endif
+
+		checkPaths(cmdln);
+		checkArgumentUsage(cmdln);
+		tryWarnRngKeyDeprecated(cmdln);
+
+		if(recursive) {
+			return runRecursive<false>(cmdln); }
+
+		auto inPaths = StaticVector<std::string>(cmdln.variadicArgs.size() + cmdln.roKeys.size());
+		std::copy(cmdln.variadicArgs.begin(), cmdln.variadicArgs.end(), inPaths.begin());
+		std::copy(cmdln.roKeys.begin(), cmdln.roKeys.end(), inPaths.begin() + cmdln.variadicArgs.size());
+
+		if(
+				(cmdln.options & cli::OptionBits::eContainer) && cmdln.rngKeys.empty() &&
+				! (cmdln.options & (cli::OptionBits::eCompress | cli::OptionBits::eResume))
+		) {
+			namespace fs = std::filesystem;
+			bool seekable =
+				(! isStreamPath(cmdln.firstArg)) &&
+				((! fs::exists(cmdln.firstArg)) || fs::is_regular_file(cmdln.firstArg));
+			for(size_t i=0; seekable && (i < inPaths.size()); ++i) {
+				seekable = (! isStreamPath(inPaths[i])) && fs::is_regular_file(inPaths[i]); }
+			if(seekable && demuxContainersParallel(cmdln, inPaths, inFds, cmdln.firstArg, outFd)) {
+				return true; }
+		}
+
+		auto checkpoints = mkCheckpointer(cmdln, StaticVector<std::string> { cmdln.firstArg });
+		const uint64_t resumeOffset = checkpoints? checkpoints->resumeOffset() : 0;
+		auto demuxOut = (resumeOffset > 0)?
+			openContinuedOutput(cmdln.firstArg, std::move(outFd), resumeOffset) :
+			OutputStreamAdapter(cmdln.firstArg, cmdln.firstLiteralArg <= 0, std::move(outFd));
+		auto demuxIn = StaticVector<InputStreamAdapter>(inPaths.size());
+
+		for(size_t i=0; i < inPaths.size(); ++i) {
+			demuxIn[i] = InputStreamAdapter(
+				inPaths[i], (i >= cmdln.variadicArgs.size()) || (cmdln.firstLiteralArg <= (i+1)),
+				(i < inFds.size())? std::move(inFds[i]) : CheckedFd());
+		}
+
+		startWriteback(cmdln, demuxOut.get());
+		demuxStreams(cmdln, demuxIn, inPaths, demuxOut, checkpoints.get());
+		commitOutput(cmdln, demuxOut.get(), cmdln.firstArg);
+		if(checkpoints) {
+			checkpoints->complete(); }
+		return true;
+	}
+
+
+	bool runVerify(const CommandLine& cmdln) {
+		using CmdlnException = xorinator::cli::InvalidCommandLineException;
+		assert(cmdln.cmdType == cli::CmdType::eVerify);
+		const bool quiet = cmdln.options & cli::OptionBits::eQuiet;
+
+		if(cmdln.firstArg.empty()) {
+			throw CmdlnException("a verify operation needs one or more shares"); }
+		if(cmdln.options & cli::OptionBits::eIndex) {
+			return verifyIndices(cmdln); }
+
+		constexpr std::string_view hashPrefix = "sha256:";
+		std::optional<Sha256::Digest> expectedDigest;
+		if(cmdln.firstArg.starts_with(hashPrefix) && (cmdln.firstLiteralArg > 0)) {
+			expectedDigest = Sha256::fromHex(std::string_view(cmdln.firstArg).substr(hashPrefix.size()));
+			if(! expectedDigest) {
+				throw CmdlnException("\"" + cmdln.firstArg + "\" is not a valid SHA-256 digest"); }
+		}
+
+		auto inPaths = StaticVector<std::string>(cmdln.variadicArgs.size() + cmdln.roKeys.size());
+		std::copy(cmdln.variadicArgs.begin(), cmdln.variadicArgs.end(), inPaths.begin());
+		std::copy(cmdln.roKeys.begin(), cmdln.roKeys.end(), inPaths.begin() + cmdln.variadicArgs.size());
+		if(inPaths.empty()) {
+			throw CmdlnException("a verify operation needs one or more shares"); }
+
+		auto originalFd = CheckedFd();
+		auto inFds = StaticVector<CheckedFd>(cmdln.variadicArgs.size());
+		#ifdef XORINATOR_UNIX_PERM_CHECK
+			if(! (cmdln.options & cli::OptionBits::eForce)) {
+				if(! expectedDigest) {
+					originalFd = openChecked<04>(cmdln.firstArg); }
+				for(size_t i=0; i < inFds.size(); ++i) {
+					inFds[i] = openChecked<04>(cmdln.variadicArgs[i]); }
+			}
+		#endif
+
+		checkArgumentUsage(cmdln);
+		tryWarnRngKeyDeprecated(cmdln);
+
+		auto demuxIn = StaticVector<InputStreamAdapter>(inPaths.size());
+		for(size_t i=0; i < inPaths.size(); ++i) {
+			demuxIn[i] = InputStreamAdapter(
+				inPaths[i], (i >= cmdln.variadicArgs.size()) || (cmdln.firstLiteralArg <= (i+1)),
+				(i < inFds.size())? std::move(inFds[i]) : CheckedFd());
+		}
+		std::optional<InputStreamAdapter> original;
+		if(! expectedDigest) {
+			original.emplace(cmdln.firstArg, cmdln.firstLiteralArg <= 0, std::move(originalFd)); }
+
+		auto failure = verifyReconstruction(
+			cmdln, demuxIn, inPaths,
+			original? &original->get() : nullptr,
+			expectedDigest? *expectedDigest : Sha256::Digest { });
+		if(! quiet) {
+			std::cout << '"' << cmdln.firstArg << "\": " << failure.value_or("OK") << std::endl; }
+		return ! failure;
+	}
+
+
+	bool runReshare(const CommandLine& cmdln) {
+		using CmdlnException = xorinator::cli::InvalidCommandLineException;
+		assert(cmdln.cmdType == cli::CmdType::eReshare);
+
+		/* The first half of the arguments are the old shares, the
+		 * second half are the new ones. */
+		auto paths = StaticVector<std::string>(cmdln.variadicArgs.size() + 1);
+		paths[0] = cmdln.firstArg;
+		std::copy(cmdln.variadicArgs.begin(), cmdln.variadicArgs.end(), paths.begin() + 1);
+		if(cmdln.firstArg.empty() || (paths.size() < 4)) {
+			throw CmdlnException("a reshare operation needs two or more shares, and as many output files"); }
+		if(paths.size() % 2 != 0) {
+			throw CmdlnException("a reshare operation needs as many output files as input shares"); }
+		if(! (cmdln.rngKeys.empty() && cmdln.roKeys.empty())) {
+			throw CmdlnException("\"--key\" and \"--nogen\" arguments are not affected by a reshare operation, and cannot be used"); }
+		if(cmdln.options & cli::OptionBits::eRecursive) {
+			throw CmdlnException("a reshare operation cannot be recursive"); }
+		{ // Overwriting a share while reading it would destroy the set, "--force" or not
+			auto uniquePaths = std::unordered_set<std::string>(paths.size());
+			for(const auto& path : paths) {
+				if(! uniquePaths.insert(path).second)
+					throw CmdlnException("file arguments must be unique");
+			}
+		}
+
+		size_t shareCount = paths.size() / 2;
+		auto inPaths = StaticVector<std::string>(shareCount);
+		auto outPaths = StaticVector<std::string>(shareCount);
+		std::copy(paths.begin(), paths.begin() + shareCount, inPaths.begin());
+		std::copy(paths.begin() + shareCount, paths.end(), outPaths.begin());
+
+		auto inFds = StaticVector<CheckedFd>(shareCount);
+		auto outFds = StaticVector<CheckedFd>(shareCount);
+		#ifdef XORINATOR_UNIX_PERM_CHECK
+			if(! (cmdln.options & cli::OptionBits::eForce)) {
+				for(size_t i=0; i < shareCount; ++i) {
+					inFds[i] = openChecked<04>(inPaths[i]); }
+				for(size_t i=0; i < shareCount; ++i) {
+					outFds[i] = openChecked<02>(outPaths[i]); }
+			}
+		#endif
+
+		auto inFiles = StaticVector<InputStreamAdapter>(shareCount);
+		auto outFiles = StaticVector<OutputStreamAdapter>(shareCount);
+		for(size_t i=0; i < shareCount; ++i) {
+			inFiles[i] = InputStreamAdapter(inPaths[i], cmdln.firstLiteralArg <= i, std::move(inFds[i]));
+			outFiles[i] = OutputStreamAdapter(outPaths[i], cmdln.firstLiteralArg <= (shareCount + i), std::move(outFds[i]));
+		}
+		RngAdapter rng;
+
+		reshareStreams(cmdln, inFiles, inPaths, outFiles, outPaths, rng);
+		return true;
+	}
+
+
+	bool runSplitShare(const CommandLine& cmdln) {
+		using CmdlnException = xorinator::cli::InvalidCommandLineException;
+		assert(cmdln.cmdType == cli::CmdType::eSplitShare);
+
+		if(cmdln.firstArg.empty() || (cmdln.variadicArgs.size() != 2)) {
+			throw CmdlnException("a split-share operation needs one share and two output files"); }
+		if(! (cmdln.rngKeys.empty() && cmdln.roKeys.empty())) {
+			throw CmdlnException("\"--key\" and \"--nogen\" arguments are not affected by a split-share operation, and cannot be used"); }
+		if(cmdln.options & cli::OptionBits::eRecursive) {
+			throw CmdlnException("a split-share operation cannot be recursive"); }
+		if(
+				(cmdln.firstArg == cmdln.variadicArgs[0]) || (cmdln.firstArg == cmdln.variadicArgs[1]) ||
+				(cmdln.variadicArgs[0] == cmdln.variadicArgs[1])
+		) {
+			throw CmdlnException("file arguments must be unique"); }
+
+		auto inFd = CheckedFd();
+		auto outFds = StaticVector<CheckedFd>(2);
+		#ifdef XORINATOR_UNIX_PERM_CHECK
+			if(! (cmdln.options & cli::OptionBits::eForce)) {
+				inFd = openChecked<04>(cmdln.firstArg);
+				for(size_t i=0; i < outFds.size(); ++i) {
+					outFds[i] = openChecked<02>(cmdln.variadicArgs[i]); }
+			}
+		#endif
+
+		auto inPaths = StaticVector<std::string> { cmdln.firstArg };
+		auto inFiles = StaticVector<InputStreamAdapter>(1);
+		auto outFiles = StaticVector<OutputStreamAdapter>(2);
+		inFiles[0] = InputStreamAdapter(cmdln.firstArg, cmdln.firstLiteralArg <= 0, std::move(inFd));
+		for(size_t i=0; i < outFiles.size(); ++i) {
+			outFiles[i] = OutputStreamAdapter(cmdln.variadicArgs[i], cmdln.firstLiteralArg <= (i+1), std::move(outFds[i])); }
+		RngAdapter rng;
+
+		splitShareStream(cmdln, inFiles, inPaths, outFiles, cmdln.variadicArgs, rng);
+		return true;
+	}
+
+
+	bool runCollapse(const CommandLine& cmdln) {
+		using CmdlnException = xorinator::cli::InvalidCommandLineException;
+		assert(cmdln.cmdType == cli::CmdType::eCollapse);
+		const bool force = cmdln.options & cli::OptionBits::eForce;
+
+		if(cmdln.firstArg.empty() || (cmdln.variadicArgs.size() < 2)) {
+			throw CmdlnException("a collapse operation needs an output file and two or more shares"); }
+		if(! (cmdln.rngKeys.empty() && cmdln.roKeys.empty())) {
+			throw CmdlnException("\"--key\" and \"--nogen\" arguments cannot be collapsed into a share"); }
+		if(cmdln.options & cli::OptionBits::eRecursive) {
+			throw CmdlnException("a collapse operation cannot be recursive"); }
+		if(cmdln.options & cli::OptionBits::eContainer) {
+			if(cmdln.options & cli::OptionBits::eRaw)
+				throw CmdlnException("the \"--raw\" option cannot be used with \"--container\"");
+		} else
+		if(! (cmdln.options & cli::OptionBits::eRaw)) {
+			throw CmdlnException(
+				"without \"--container\" there is no way to tell whether the shares form a complete set, "
+				"which would collapse into the original file; use \"--raw\" to collapse them anyway"); }
+		{
+			auto paths = std::unordered_set<std::string>(cmdln.variadicArgs.size() + 1);
+			paths.insert(cmdln.firstArg);
+			for(const auto& path : cmdln.variadicArgs) {
+				if(! paths.insert(path).second)
+					throw CmdlnException("file arguments must be unique");
+			}
+		}
+
+		auto outFd = CheckedFd();
+		auto inFds = StaticVector<CheckedFd>(cmdln.variadicArgs.size());
+		#ifdef XORINATOR_UNIX_PERM_CHECK
+			if(! force) {
+				outFd = openChecked<02>(cmdln.firstArg);
+				for(size_t i=0; i < inFds.size(); ++i) {
+					inFds[i] = openChecked<04>(cmdln.variadicArgs[i]); }
+			}
+		#endif
+
+		auto inFiles = StaticVector<InputStreamAdapter>(cmdln.variadicArgs.size());
+		for(size_t i=0; i < inFiles.size(); ++i) {
+			inFiles[i] = InputStreamAdapter(cmdln.variadicArgs[i], cmdln.firstLiteralArg <= (i+1), std::move(inFds[i])); }
+		auto outFile = OutputStreamAdapter(cmdln.firstArg, cmdln.firstLiteralArg <= 0, std::move(outFd));
+
+		collapseStreams(cmdln, inFiles, cmdln.variadicArgs, outFile, cmdln.firstArg);
+		return true;
+	}
+
+
+	/** Regular files written by ::generatePads are split into tasks of
+	 * this size. */
+	constexpr uint64_t GEN_SEGMENT_SIZE = 16 << 20;
+
+	/** Writes `size` random bytes to every given file, after its current
+	 * content if `append` is true. Regular files are resized first, then
+	 * written in segments by a WorkStealingPool, each with its own
+	 * generator; other files (and the standard output) are written
+	 * sequentially, each by a single task.
+	 * Every file is opened once, through its checked descriptor if it
+	 * has a valid one. */
+	void generatePads(
+			const CommandLine& cmdln,
+			const StaticVector<std::string>& paths,
+			StaticVector<CheckedFd>& checkedFds,
+			uint64_t size, bool append
+	) {
+		static constexpr size_t blockSize = 1 << 20;
+		auto pool = WorkStealingPool(cmdln.jobCount);
+		std::mutex errMtx;
+		std::exception_ptr error;
+		auto guard = [&](auto fn) {
+			return [&errMtx, &error, fn]() {
+				try {
+					fn();
+				} catch(...) {
+					auto lock = std::lock_guard(errMtx);
+					if(! error) error = std::current_exception();
+				}
+			};
+		};
+		// Fills `size` bytes, passing each block to `write(block, blockSize)`
+		auto writeRandom = [](uint64_t size, auto&& write) {
+			RngAdapter rng;
+			std::vector<xorinator::byte_t> block;
+			for(uint64_t left = size; left > 0; left -= block.size()) {
+				block.resize(std::min<uint64_t>(left, blockSize));
+				rng.fill(block.data(), block.size());
+				write(block.data(), block.size());
+			}
+		};
+		auto writeStream = [&cmdln, &writeRandom](std::ostream& out, const std::string& path, uint64_t size) {
+			out.exceptions(std::ios_base::badbit | std::ios_base::failbit);
+			writeRandom(size, [&out](const xorinator::byte_t* src, size_t n) {
+				out.write(reinterpret_cast<const char*>(src), n); });
+			commitOutput(cmdln, out, path);
+		};
+
+		#ifdef XORINATOR_POSIX_IO
+			using xorinator::runtime::writeAt;
+			auto regularFds = StaticVector<SharedFd>(paths.size());
+		#endif
+		for(size_t i=0; i < paths.size(); ++i) {
+			const auto& path = paths[i];
+			const bool literal = cmdln.firstLiteralArg <= i;
+			if(isStreamPath(path) && ! literal) {
+				pool.push(guard([&writeStream, &path, size]() {
+					auto out = OutputStreamAdapter(path, false);
+					writeStream(out.get(), path, size);
+				}));
+				continue;
+			}
+			#ifdef XORINATOR_POSIX_IO
+				struct stat st = { };
+				if(checkedFds[i].valid()) {
+					if(0 != ::fstat(checkedFds[i].get(), &st)) {
+						throw std::runtime_error("could not stat \"" + path + "\": " + std::strerror(errno)); }
+				} else
+				if(::stat(path.c_str(), &st) != 0) {
+					st.st_mode = S_IFREG; // Created below
+				}
+				if(! S_ISREG(st.st_mode)) {
+					// A device or a pipe, which is written as it is (and may block until it's read)
+					int fd = checkedFds[i].valid()? checkedFds[i].release(path) : -1;
+					pool.push(guard([&writeStream, &path, fd, size]() {
+						auto out = (fd >= 0)? OutputStreamAdapter(path, true, CheckedFd(fd, false)) : OutputStreamAdapter(path, true);
+						writeStream(out.get(), path, size);
+					}));
+					continue;
+				}
+				auto& output = regularFds[i];
+				if(checkedFds[i].valid()) {
+					output.adopt(checkedFds[i].release(path, append? uint64_t(st.st_size) : 0));
+				} else {
+					output.open(CheckedFd(), path, O_WRONLY | O_CREAT | (append? 0 : O_TRUNC), "writing");
+					if(0 != ::fstat(output.get(), &st)) {
+						throw std::runtime_error("could not stat \"" + path + "\": " + std::strerror(errno)); }
+				}
+				const uint64_t offset = append? uint64_t(st.st_size) : 0;
+				if(0 != ::ftruncate(output.get(), offset + size)) { // Set the final size
+					throw std::runtime_error("could not resize \"" + path + "\": " + std::strerror(errno)); }
+				for(uint64_t segment = 0; segment < size; segment += GEN_SEGMENT_SIZE) {
+					uint64_t segmentSize = std::min(GEN_SEGMENT_SIZE, size - segment);
+					pool.push(guard([&writeRandom, fd = output.get(), segmentOffset = offset + segment, segmentSize]() {
+						uint64_t at = segmentOffset;
+						writeRandom(segmentSize, [fd, &at](const xorinator::byte_t* src, size_t n) {
+							writeAt(fd, src, n, at);
+							at += n;
+						});
+					}));
+				}
+			#else
+				// Without positioned writes, every file is written by a single task
+				(void) checkedFds;
+				pool.push(guard([&writeStream, &path, size, append]() {
+					auto out = std::ofstream(path, std::ios_base::binary | (append? std::ios_base::app : std::ios_base::trunc));
+					if(! out) {
+						throw xorinator::runtime::FilePermissionException("could not open \"" + path + "\" for writing"); }
+					writeStream(out, path, size);
+				}));
+			#endif
+		}
+		pool.wait();
+		if(error) std::rethrow_exception(error);
+		#ifdef XORINATOR_POSIX_IO
+			if(cmdln.durability != Durability::eNone) {
+				// Segments are written out of order, so regular files are only synced at the end
+				for(size_t i=0; i < paths.size(); ++i) {
+					if(regularFds[i].get() < 0) continue;
+					if(! xorinator::runtime::syncFd(regularFds[i].get())) {
+						throw std::runtime_error("could not sync \"" + paths[i] + "\" to the storage device"); }
+				}
+			}
+		#endif
+	}
+
+
+	bool runFillReservoir(const CommandLine& cmdln) {
+		using CmdlnException = xorinator::cli::InvalidCommandLineException;
+		namespace fs = std::filesystem;
+		assert(cmdln.cmdType == cli::CmdType::eFillReservoir);
+
+		if(cmdln.firstArg.empty() || (! cmdln.variadicArgs.empty())) {
+			throw CmdlnException("a fill-reservoir operation needs exactly one reservoir file"); }
+		if(cmdln.size == 0) {
+			throw CmdlnException("the amount of data to add to the reservoir must be given with \"--size\""); }
+		if(isStreamPath(cmdln.firstArg) || (fs::exists(cmdln.firstArg) && ! fs::is_regular_file(cmdln.firstArg))) {
+			throw CmdlnException("a pad reservoir must be a regular file"); }
+
+		auto checkedFds = StaticVector<CheckedFd>(1);
+		#ifdef XORINATOR_UNIX_PERM_CHECK
+			if(! (cmdln.options & cli::OptionBits::eForce)) {
+				checkedFds[0] = openChecked<02>(cmdln.firstArg); }
+		#endif
+
+		if((! checkedFds[0].valid()) && ! fs::exists(cmdln.firstArg)) {
+			// The reservoir holds future pads, and should only be readable by its owner
+			#ifdef XORINATOR_POSIX_IO
+				int fd = ::open(cmdln.firstArg.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+				if(fd < 0) {
+					throw xorinator::runtime::FilePermissionException("could not create \"" + cmdln.firstArg + '"'); }
+				checkedFds[0] = CheckedFd(fd, false);
+			#else
+				std::ofstream(cmdln.firstArg, std::ios_base::binary).exceptions(std::ios_base::badbit | std::ios_base::failbit);
+				fs::permissions(cmdln.firstArg, fs::perms::owner_read | fs::perms::owner_write);
+			#endif
+		}
+		generatePads(cmdln, StaticVector<std::string> { cmdln.firstArg }, checkedFds, cmdln.size, true);
+		return true;
+	}
+
+
+	bool runGenerate(const CommandLine& cmdln) {
+		using CmdlnException = xorinator::cli::InvalidCommandLineException;
+		assert(cmdln.cmdType == cli::CmdType::eGenerate);
+
+		if(cmdln.firstArg.empty()) {
+			throw CmdlnException("a generate operation needs one or more output files"); }
+		if(cmdln.size == 0) {
+			throw CmdlnException("the size of the output files must be given with \"--size\""); }
+		if(! (cmdln.rngKeys.empty() && cmdln.roKeys.empty())) {
+			throw CmdlnException("\"--key\" and \"--nogen\" arguments cannot be used by a generate operation"); }
+		auto paths = StaticVector<std::string>(cmdln.variadicArgs.size() + 1);
+		paths[0] = cmdln.firstArg;
+		std::copy(cmdln.variadicArgs.begin(), cmdln.variadicArgs.end(), paths.begin() + 1);
+		{
+			auto uniquePaths = std::unordered_set<std::string>(paths.size());
+			for(const auto& path : paths) {
+				if(! uniquePaths.insert(path).second)
+					throw CmdlnException("file arguments must be unique");
+			}
+		}
+
+		auto checkedFds = StaticVector<CheckedFd>(paths.size());
+		#ifdef XORINATOR_UNIX_PERM_CHECK
+			if(! (cmdln.options & cli::OptionBits::eForce)) {
+				for(size_t i=0; i < paths.size(); ++i) {
+					checkedFds[i] = openChecked<02>(paths[i]); }
+			}
+		#endif
+
+		generatePads(cmdln, paths, checkedFds, cmdln.size, false);
+		return true;
+	}
+
+
+	bool usage(const CommandLine& cmdln) {
 		static constexpr auto strNeedsQuotes = [](const std::string& str) {
 			static constexpr auto charIsAllowed = [](char c) {
 				#define TEST_CHAR(COND_) if(COND_)  return true;
@@ -550,6 +3213,14 @@ namespace xorinator::runtime {
 		std::cerr << "Usage:\n"
 			<< "   " << zeroArg << " multiplex [OPTIONS] [--] FILE_IN FILE_OUT [FILE_OUT...]\n"
 			<< "   " << zeroArg << " demultiplex [OPTIONS] [--] FILE_OUT FILE_IN [FILE_IN...]\n"
+			<< "   " << zeroArg << " verify [OPTIONS] [--] FILE_IN|sha256:HASH SHARE [SHARE...]\n"
+			<< "   " << zeroArg << " verify --index [OPTIONS] [--] SHARE [SHARE...]\n"
+			<< "   " << zeroArg << " reshare [OPTIONS] [--] SHARE_IN SHARE_IN [SHARE_IN...] SHARE_OUT SHARE_OUT [SHARE_OUT...]\n"
+			<< "   " << zeroArg << " split-share [OPTIONS] [--] SHARE_IN SHARE_OUT SHARE_OUT\n"
+			<< "   " << zeroArg << " collapse [OPTIONS] [--] SHARE_OUT SHARE_IN SHARE_IN [SHARE_IN...]\n"
+			<< "   " << zeroArg << " fill-reservoir --size NUM [OPTIONS] [--] RESERVOIR\n"
+			<< "   " << zeroArg << " generate --size NUM [OPTIONS] [--] FILE_OUT [FILE_OUT...]\n"
+			<< "   " << zeroArg << " serve --socket PATH [OPTIONS]\n"
 			<< "   " << zeroArg << " help | ?\n"
 			<< '\n'
 			<< "Options:\n"
@@ -558,13 +3229,44 @@ namespace xorinator::runtime {
 			<< "   -f | --force  (skip permission checks)\n"
 			<< "   -g NUM | --litter NUM  (add red herring bytes when generating one-time pads)\n"
 			<< "   -G FILE_IN | --nogen FILE_IN  (treat FILE_IN as an already generated one-time pad)\n"
+			<< "   -r | --recursive  (treat FILE_IN and FILE_OUT as directory trees)\n"
+			<< "   -j NUM | --jobs NUM  (use NUM worker threads for recursive and generate operations)\n"
+			<< "   -c | --container  (read or write one-time pads as chunked share containers)\n"
+			<< "   --chunk-size NUM  (size of the chunks of new share containers)\n"
+			<< "   -t NUM | --threshold NUM  (any NUM shares of the new set can be demultiplexed)\n"
+			<< "   -i | --index  (write or check the integrity index of every one-time pad)\n"
+			<< "   -z | --compress  (compress the input before multiplexing, decompress the output after demultiplexing)\n"
+			<< "   --range BEGIN:END  (only verify the blocks that hold the given byte range)\n"
+			<< "   --reservoir RESERVOIR  (take the new one-time pads from a pad reservoir)\n"
+			<< "   --size NUM[K|M|G|T]  (amount of random data to generate)\n"
+			<< "   --durability none|end|periodic  (when written files are synced to the storage device)\n"
+			<< "   --resume  (record checkpoints, and continue an interrupted operation from the last one)\n"
+			<< "   --append  (multiplex only the part of FILE_IN that follows the end of the existing shares)\n"
+			<< "   --raw  (collapse shares that are not share containers, which cannot be checked)\n"
+			<< "   --delta INDEX  (only patch the blocks of the first share that changed since the last multiplexing operation)\n"
+			<< "   --socket PATH  (serve operations on a Unix socket, or send the operation to the server on it)\n"
 			<< '\n'
 			<< "Aliases for \"multiplex\": mux, m\n"
-			<< "Aliases for \"demultiplex\": demux, dmx, d" << std::endl;
+			<< "Aliases for \"demultiplex\": demux, dmx, d\n"
+			<< "Aliases for \"verify\": vfy, v\n"
+			<< "Aliases for \"reshare\": rsh\n"
+			<< "Aliases for \"split-share\": split\n"
+			<< "Aliases for \"collapse\": merge\n"
+			<< "Aliases for \"fill-reservoir\": fill\n"
+			<< "Aliases for \"generate\": gen" << std::endl;
 		return false;
 	}
 
 
+	void seedRngPool(size_t count) {
+		auto engines = std::vector<std::unique_ptr<RngEngine>>(count);
+		for(auto& engine : engines) {
+			engine = std::make_unique<RngEngine>(); }
+		for(auto& engine : engines) {
+			RngEnginePool::instance().give(std::move(engine)); }
+	}
+
+
 	bool run(const CommandLine& cmdln) {
 		using namespace std::string_literals;
 		switch(cmdln.cmdType) {
@@ -572,6 +3274,20 @@ namespace xorinator::runtime {
 				return runMux(cmdln);
 			case CmdType::eDemultiplex:
 				return runDemux(cmdln);
+			case CmdType::eVerify:
+				return runVerify(cmdln);
+			case CmdType::eReshare:
+				return runReshare(cmdln);
+			case CmdType::eSplitShare:
+				return runSplitShare(cmdln);
+			case CmdType::eCollapse:
+				return runCollapse(cmdln);
+			case CmdType::eFillReservoir:
+				return runFillReservoir(cmdln);
+			case CmdType::eGenerate:
+				return runGenerate(cmdln);
+			case CmdType::eServe:
+				return xorinator::server::serve(cmdln);
 			case CmdType::eNone:
 				return usage(cmdln);
 			case CmdType::eError:  default:
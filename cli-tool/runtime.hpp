@@ -23,8 +23,12 @@
 #include <cassert>
 #include <stdexcept>
 #include <random>
+#include <array>
+#include <cstring>
+#include <climits>
 
 #include "clparser.hpp"
+#include "mt64.hpp"
 
 
 
@@ -82,37 +86,37 @@ namespace xorinator {
 		public:
 			inline View(): words_(nullptr), beg_(0), end_(0) { }
 
+			/** Every word of the key seeds its own engine; the engines
+			 * are stepped in lockstep, and their state is stored inline. */
 			class Iterator {
 			private:
-				using RndEnginePtr = std::unique_ptr<RndEngine>;
-				std::unique_ptr<std::array<RndEnginePtr, word_count>> generators_;
+				static_assert(std::is_same_v<RndEngine, std::mt19937_64>,
+					"RngKey iterators implement the std::mt19937_64 keystream");
+				mt64::LockstepEngine<word_count> engines_;
 				size_t remaining_;
 				word_t current_gen_;
 				unsigned current_gen_rsh_;
 
 				void regen_() {
-					for(auto& gen : *generators_) {
-						current_gen_ ^= (*gen)(); }
+					const word_t* gen = engines_.next();
+					for(size_t i=0; i < word_count; ++i) {
+						current_gen_ ^= gen[i]; }
 				}
 
 			public:
 				inline Iterator():
-						generators_(nullptr),
 						remaining_(0),
 						current_gen_(0),
 						current_gen_rsh_(0)
 				{ }
 
 				inline Iterator(const decltype(RngKey::words)& words, size_t beg, size_t end):
-						generators_(std::make_unique<std::array<RndEnginePtr, word_count>>()),
+						engines_(words.data()),
 						remaining_(end - beg),
 						current_gen_(0),
 						current_gen_rsh_(0)
 				{
-					for(size_t i=0; i < generators_->size(); ++i) {
-						(*generators_)[i] = std::make_unique<RndEngine>(RndEngine(words[i]));
-						(*generators_)[i]->discard(beg);
-					}
+					engines_.discard(beg);
 					regen_();
 				}
 
@@ -152,6 +156,65 @@ namespace xorinator {
 	};
 
 
+	/** The XOR of the keystreams of several RngKeys, from the beginning:
+	 * the same as XORing the bytes of their iterators, but every engine
+	 * of every key is a lane of a single mt64::LockstepEngine, and the
+	 * keystream is applied to whole blocks. */
+	template<unsigned keyBits>
+	class RngKeyStream {
+	private:
+		using Key = RngKey<keyBits>;
+		static_assert(Key::bit_count % std::numeric_limits<typename Key::word_t>::digits == 0,
+			"every byte of the keystream must consume one value of every engine");
+
+		mt64::LockstepEngine<> engines_;
+		typename Key::word_t acc_;
+
+		static std::vector<typename Key::word_t> seeds_(const Key* keys, size_t count) {
+			auto r = std::vector<typename Key::word_t>();
+			r.reserve(count * Key::word_count);
+			for(size_t k=0; k < count; ++k) {
+				r.insert(r.end(), keys[k].words.begin(), keys[k].words.end()); }
+			return r;
+		}
+
+	public:
+		RngKeyStream(): acc_(0) { }
+
+		RngKeyStream(const Key* keys, size_t count):
+				engines_(seeds_(keys, count).data(), count * Key::word_count),
+				acc_(0)
+		{ }
+
+		bool empty() const { return engines_.lanes() == 0; }
+
+		/** XORs the next `size` bytes of the keystream into `dst`. */
+		void apply(byte_t* dst, size_t size) {
+			if(empty()) return;
+			const size_t lanes = engines_.lanes();
+			for(size_t i=0; i < size; ++i) {
+				const auto* gen = engines_.next();
+				for(size_t l=0; l < lanes; ++l) {
+					acc_ ^= gen[l]; }
+				dst[i] ^= byte_t(acc_);
+			}
+		}
+
+		/** Skips the next `size` bytes of the keystream; since every
+		 * byte depends on every value generated before it, they are
+		 * generated anyway. */
+		void discard(uint64_t size) {
+			if(empty()) return;
+			const size_t lanes = engines_.lanes();
+			for(uint64_t i=0; i < size; ++i) {
+				const auto* gen = engines_.next();
+				for(size_t l=0; l < lanes; ++l) {
+					acc_ ^= gen[l]; }
+			}
+		}
+	};
+
+
 	class StreamKey {
 	public:
 		std::istream* source;
@@ -261,8 +324,24 @@ namespace xorinator::runtime {
 
 	bool runDemux(const cli::CommandLine&);
 
+	bool runVerify(const cli::CommandLine&);
+
+	bool runReshare(const cli::CommandLine&);
+
+	bool runSplitShare(const cli::CommandLine&);
+
+	bool runCollapse(const cli::CommandLine&);
+
+	bool runFillReservoir(const cli::CommandLine&);
+
+	bool runGenerate(const cli::CommandLine&);
+
 	bool usage(const cli::CommandLine&);
 
 	bool run(const cli::CommandLine&);
 
+	/** Seeds `count` random generators from the random device ahead of
+	 * the operations that will take them (see "xor serve"). */
+	void seedRngPool(size_t count);
+
 }
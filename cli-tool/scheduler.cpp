@@ -0,0 +1,140 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#include "scheduler.hpp"
+
+#include <cassert>
+#include <utility>
+
+
+
+namespace xorinator::runtime {
+
+	WorkStealingPool::WorkStealingPool(size_t workerCount):
+			workers_(workerCount > 0? workerCount : std::max(1u, std::thread::hardware_concurrency())),
+			pending_(0),
+			queued_(0),
+			nextWorker_(0),
+			stopping_(false)
+	{
+		for(size_t i=0; i < workers_.size(); ++i) {
+			workers_[i].thread = std::thread(&WorkStealingPool::workerLoop_, this, i); }
+	}
+
+
+	WorkStealingPool::~WorkStealingPool() {
+		{
+			auto lock = std::unique_lock(stateMtx_);
+			waitIdle_(lock);
+			stopping_ = true;
+		}
+		taskCv_.notify_all();
+		for(auto& worker : workers_) {
+			worker.thread.join(); }
+	}
+
+
+	void WorkStealingPool::push(Task task) {
+		size_t workerIndex;
+		{
+			auto lock = std::lock_guard(stateMtx_);
+			workerIndex = nextWorker_;
+			nextWorker_ = (nextWorker_ + 1) % workers_.size();
+			++ pending_;
+			++ queued_;
+		}
+		{
+			auto lock = std::lock_guard(workers_[workerIndex].mtx);
+			workers_[workerIndex].tasks.push_back(std::move(task));
+		}
+		taskCv_.notify_one();
+	}
+
+
+	void WorkStealingPool::wait() {
+		auto lock = std::unique_lock(stateMtx_);
+		waitIdle_(lock);
+		if(error_) {
+			std::rethrow_exception(std::exchange(error_, nullptr)); }
+	}
+
+
+	void WorkStealingPool::waitIdle_(std::unique_lock<std::mutex>& lock) {
+		idleCv_.wait(lock, [this]() { return pending_ == 0; }); }
+
+
+	bool WorkStealingPool::tryPop_(size_t workerIndex, Task& dst) {
+		{ // The worker's own tasks are taken from the front...
+			auto& own = workers_[workerIndex];
+			auto lock = std::lock_guard(own.mtx);
+			if(! own.tasks.empty()) {
+				dst = std::move(own.tasks.front());
+				own.tasks.pop_front();
+				return true;
+			}
+		}
+		// ... while stolen ones are taken from the back
+		for(size_t i=1; i < workers_.size(); ++i) {
+			auto& victim = workers_[(workerIndex + i) % workers_.size()];
+			auto lock = std::lock_guard(victim.mtx);
+			if(! victim.tasks.empty()) {
+				dst = std::move(victim.tasks.back());
+				victim.tasks.pop_back();
+				return true;
+			}
+		}
+		return false;
+	}
+
+
+	void WorkStealingPool::workerLoop_(size_t workerIndex) {
+		Task task;
+		while(true) {
+			{
+				auto lock = std::unique_lock(stateMtx_);
+				taskCv_.wait(lock, [this]() { return stopping_ || (queued_ > 0); });
+				if(queued_ == 0) {
+					assert(stopping_);
+					return;
+				}
+				/* Claiming the task before looking for it guarantees that
+				 * some queue holds an unclaimed one. */
+				-- queued_;
+			}
+			while(! tryPop_(workerIndex, task)) {
+				std::this_thread::yield(); }
+			std::exception_ptr error;
+			try {
+				task();
+			} catch(...) {
+				error = std::current_exception();
+			}
+			task = nullptr;
+			{
+				auto lock = std::lock_guard(stateMtx_);
+				if(error && ! error_) {
+					error_ = std::move(error); }
+				if(-- pending_ == 0) {
+					idleCv_.notify_all(); }
+			}
+		}
+	}
+
+}
@@ -0,0 +1,91 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <thread>
+
+#include "clparser.hpp"
+
+
+
+namespace xorinator::runtime {
+
+	/** A fixed-size thread pool where every worker owns a task queue:
+	 * a worker runs its own tasks first, in the order they were pushed,
+	 * then steals from the back of the other workers' queues, so that a
+	 * few long tasks don't leave the remaining threads idle. Tasks pushed
+	 * largest first are run largest first, and the last ones pushed are
+	 * the ones that move between workers. */
+	class WorkStealingPool {
+	public:
+		using Task = std::function<void ()>;
+
+	private:
+		struct Worker {
+			std::mutex mtx;
+			std::deque<Task> tasks;
+			std::thread thread;
+		};
+
+		StaticVector<Worker> workers_;
+		std::mutex stateMtx_;
+		std::condition_variable taskCv_;
+		std::condition_variable idleCv_;
+		size_t pending_;
+		size_t queued_;
+		size_t nextWorker_;
+		std::exception_ptr error_;
+		bool stopping_;
+
+		bool tryPop_(size_t workerIndex, Task& dst);
+		void workerLoop_(size_t workerIndex);
+		void waitIdle_(std::unique_lock<std::mutex>&);
+
+	public:
+		/** Starts `workerCount` threads; if `workerCount` is 0, one
+		 * thread per hardware thread is started. */
+		explicit WorkStealingPool(size_t workerCount = 0);
+
+		/** Waits for every pushed task, then joins the workers;
+		 * exceptions of tasks that were not collected by `wait` are
+		 * discarded. */
+		~WorkStealingPool();
+
+		WorkStealingPool(const WorkStealingPool&) = delete;
+		WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+		/** Queues a task, distributing tasks round-robin across the workers. */
+		void push(Task);
+
+		/** Blocks until every task pushed so far has returned, then
+		 * rethrows the first exception a task threw since the last
+		 * call, if any: a failing task doesn't stop the others. */
+		void wait();
+
+		size_t workerCount() const { return workers_.size(); }
+	};
+
+}
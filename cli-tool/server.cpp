@@ -0,0 +1,533 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#include "server.hpp"
+
+#include "runtime.hpp"
+#include "scheduler.hpp"
+#include "fdstream.hpp"
+#include "container.hpp"
+#include "integrity.hpp"
+#include "compress.hpp"
+#include "reservoir.hpp"
+#include "checkpoint.hpp"
+
+#include <vector>
+#include <utility>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+#include <unordered_set>
+
+#ifdef XORINATOR_POSIX_IO
+	extern "C" {
+		#include <fcntl.h>
+		#include <unistd.h>
+		#include <signal.h>
+		#include <sys/socket.h>
+		#include <sys/stat.h>
+		#include <sys/time.h>
+		#include <sys/un.h>
+	}
+#endif
+
+
+
+namespace {
+
+	using xorinator::server::ServerException;
+	using xorinator::cli::CommandLine;
+	using xorinator::cli::CmdType;
+	using xorinator::cli::OptionBits;
+	using CmdlnException = xorinator::cli::InvalidCommandLineException;
+
+	/** Linux passes no more descriptors in one message (SCM_MAX_FD). */
+	constexpr size_t MAX_FDS = 253;
+
+
+	/** Throws if the operation of a command line can't be run by a
+	 * server, which only receives descriptors for its file arguments. */
+	void checkRemoteOperation(const CommandLine& cmdln) {
+		if((cmdln.cmdType != CmdType::eMultiplex) && (cmdln.cmdType != CmdType::eDemultiplex))
+			throw CmdlnException("only multiplexing and demultiplexing operations can be sent to a server");
+		if(cmdln.options & OptionBits::eRecursive)
+			throw CmdlnException("recursive operations cannot be sent to a server");
+		if((! cmdln.roKeys.empty()) || (! cmdln.reservoir.empty()) || (! cmdln.deltaIndex.empty()))
+			throw CmdlnException("\"--nogen\", \"--reservoir\" and \"--delta\" files cannot be used with \"--socket\"");
+		if(cmdln.firstArg.empty())
+			throw CmdlnException("invalid file \"\"");
+		if(cmdln.variadicArgs.size() + 1 > MAX_FDS)
+			throw CmdlnException("an operation sent to a server cannot have more than " + std::to_string(MAX_FDS) + " files");
+	}
+
+
+	#ifdef XORINATOR_POSIX_IO
+
+		constexpr uint32_t REQUEST_MAGIC = 0x76727378; // "xsrv"
+		constexpr size_t REQUEST_HEADER_SIZE = 12;
+		constexpr size_t REPLY_HEADER_SIZE = 8;
+		constexpr size_t MAX_MESSAGE_SIZE = 1 << 20;
+
+		/** How long a connected client may keep the server waiting
+		 * for its request, or for reading the reply. */
+		constexpr timeval CLIENT_TIMEOUT = { 10, 0 };
+
+
+		[[noreturn]] void throwErrno(const std::string& what) {
+			throw ServerException(what + ": " + std::strerror(errno)); }
+
+
+		template<typename T>
+		void putLe(unsigned char* dst, T value) {
+			for(unsigned i=0; i < sizeof(T); ++i) {
+				dst[i] = value >> (i * 8); }
+		}
+
+		template<typename T>
+		T getLe(const unsigned char* src) {
+			T r = 0;
+			for(unsigned i=0; i < sizeof(T); ++i) {
+				r = r | (T(src[i]) << (i * 8)); }
+			return r;
+		}
+
+
+		/** Owns a file descriptor. */
+		class Fd {
+		private:
+			int fd_;
+
+		public:
+			Fd(): fd_(-1) { }
+			explicit Fd(int fd): fd_(fd) { }
+			~Fd() { if(fd_ >= 0) ::close(fd_); }
+
+			Fd(Fd&& mv): fd_(std::exchange(mv.fd_, -1)) { }
+
+			Fd& operator=(Fd&& mv) {
+				std::swap(fd_, mv.fd_);
+				return *this;
+			}
+
+			int get() const { return fd_; }
+		};
+
+
+		sockaddr_un socketAddress(const std::string& path) {
+			sockaddr_un r = { };
+			r.sun_family = AF_UNIX;
+			if(path.size() >= sizeof(r.sun_path)) {
+				throw ServerException("the socket path \"" + path + "\" is too long"); }
+			std::memcpy(r.sun_path, path.c_str(), path.size() + 1);
+			return r;
+		}
+
+		Fd mkSocket() {
+			auto r = Fd(::socket(AF_UNIX, SOCK_STREAM, 0));
+			if(r.get() < 0)  throwErrno("could not create a socket");
+			::fcntl(r.get(), F_SETFD, FD_CLOEXEC);
+			return r;
+		}
+
+
+		/** Sends all of `data`, with the given descriptors attached to
+		 * its first byte. */
+		void sendAll(int sock, const void* data, size_t size, const int* fds = nullptr, size_t fdCount = 0) {
+			#ifdef MSG_NOSIGNAL
+				constexpr int flags = MSG_NOSIGNAL;
+			#else
+				constexpr int flags = 0;
+			#endif
+			auto cursor = reinterpret_cast<const char*>(data);
+			auto control = std::vector<char>((fdCount > 0)? CMSG_SPACE(fdCount * sizeof(int)) : 0);
+			while(size > 0) {
+				iovec iov = { const_cast<char*>(cursor), size };
+				msghdr msg = { };
+				msg.msg_iov = &iov;
+				msg.msg_iovlen = 1;
+				if(! control.empty()) {
+					msg.msg_control = control.data();
+					msg.msg_controllen = control.size();
+					auto* cmsg = CMSG_FIRSTHDR(&msg);
+					cmsg->cmsg_level = SOL_SOCKET;
+					cmsg->cmsg_type = SCM_RIGHTS;
+					cmsg->cmsg_len = CMSG_LEN(fdCount * sizeof(int));
+					std::memcpy(CMSG_DATA(cmsg), fds, fdCount * sizeof(int));
+				}
+				auto wr = ::sendmsg(sock, &msg, flags);
+				if(wr < 0) {
+					if(errno == EINTR)  continue;
+					if((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+						throw ServerException("timed out while writing to the socket"); }
+					throwErrno("could not write to the socket");
+				}
+				control.clear(); // The descriptors went with the first byte
+				cursor += wr;
+				size -= wr;
+			}
+		}
+
+		/** Receives exactly `size` bytes, and appends the descriptors
+		 * attached to them to `fds` if it isn't null.
+		 * Returns `false` if the connection is closed before the first
+		 * byte. */
+		bool recvAll(int sock, void* data, size_t size, std::vector<Fd>* fds = nullptr) {
+			#ifdef MSG_CMSG_CLOEXEC
+				constexpr int flags = MSG_CMSG_CLOEXEC;
+			#else
+				constexpr int flags = 0;
+			#endif
+			auto cursor = reinterpret_cast<char*>(data);
+			auto control = std::vector<char>(fds? CMSG_SPACE(MAX_FDS * sizeof(int)) : 0);
+			size_t done = 0;
+			while(done < size) {
+				iovec iov = { cursor + done, size - done };
+				msghdr msg = { };
+				msg.msg_iov = &iov;
+				msg.msg_iovlen = 1;
+				msg.msg_control = control.empty()? nullptr : control.data();
+				msg.msg_controllen = control.size();
+				auto rd = ::recvmsg(sock, &msg, flags);
+				if(rd < 0) {
+					if(errno == EINTR)  continue;
+					if((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+						throw ServerException("timed out while reading from the socket"); }
+					throwErrno("could not read from the socket");
+				}
+				if(fds && (msg.msg_controllen > 0)) {
+					for(auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+						if((cmsg->cmsg_level != SOL_SOCKET) || (cmsg->cmsg_type != SCM_RIGHTS))  continue;
+						size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+						for(size_t i=0; i < count; ++i) {
+							int fd;
+							std::memcpy(&fd, CMSG_DATA(cmsg) + (i * sizeof(int)), sizeof(int));
+							fds->emplace_back(fd);
+						}
+					}
+				}
+				if(msg.msg_flags & MSG_CTRUNC) {
+					throw ServerException("a request had too many descriptors"); }
+				if(rd == 0) {
+					if(done == 0)  return false;
+					throw ServerException("the connection was closed in the middle of a message");
+				}
+				done += rd;
+			}
+			return true;
+		}
+
+
+		/** Whether the peer of a connection runs as the user of this process. */
+		bool isSameUser(int sock) {
+			#ifdef SO_PEERCRED
+				ucred cred;
+				socklen_t len = sizeof(cred);
+				if(0 != ::getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &len))  return false;
+				return cred.uid == ::geteuid();
+			#else
+				uid_t uid;
+				gid_t gid;
+				if(0 != ::getpeereid(sock, &uid, &gid))  return false;
+				return uid == ::geteuid();
+			#endif
+		}
+
+
+		/** Binds and listens on a socket only the user can connect to,
+		 * replacing the socket file of a server that is gone. */
+		Fd listenOn(const std::string& path) {
+			const auto addr = socketAddress(path);
+			auto sock = mkSocket();
+			if(0 != ::bind(sock.get(), reinterpret_cast<const sockaddr*>(&addr), sizeof(addr))) {
+				if(errno != EADDRINUSE)  throwErrno("could not bind \"" + path + '"');
+				struct stat statResult;
+				if((0 != ::lstat(path.c_str(), &statResult)) || ! S_ISSOCK(statResult.st_mode)) {
+					throw ServerException("\"" + path + "\" already exists, and is not a socket"); }
+				auto probe = mkSocket();
+				if(0 == ::connect(probe.get(), reinterpret_cast<const sockaddr*>(&addr), sizeof(addr))) {
+					throw ServerException("another server is listening on \"" + path + '"'); }
+				if(errno != ECONNREFUSED)  throwErrno("could not probe \"" + path + '"');
+				::unlink(path.c_str());
+				if(0 != ::bind(sock.get(), reinterpret_cast<const sockaddr*>(&addr), sizeof(addr))) {
+					throwErrno("could not bind \"" + path + '"'); }
+			}
+			if(0 != ::chmod(path.c_str(), 0600))  throwErrno("could not restrict the permissions of \"" + path + '"');
+			if(0 != ::listen(sock.get(), SOMAXCONN))  throwErrno("could not listen on \"" + path + '"');
+			return sock;
+		}
+
+
+		/** The buffer that collects what the job running on this
+		 * thread writes to std::cerr, if any. */
+		thread_local std::string* jobMessages = nullptr;
+
+		/** Replaces the buffer of std::cerr while the server runs, so
+		 * that the warnings of each job go to its own client; the
+		 * server's own messages go to the previous buffer. */
+		class JobErrorBuf : public std::streambuf {
+		private:
+			std::streambuf* fallback_;
+
+		protected:
+			int_type overflow(int_type c) override {
+				if(traits_type::eq_int_type(c, traits_type::eof()))  return traits_type::not_eof(c);
+				if(jobMessages == nullptr)  return fallback_->sputc(traits_type::to_char_type(c));
+				jobMessages->push_back(traits_type::to_char_type(c));
+				return c;
+			}
+
+			std::streamsize xsputn(const char* src, std::streamsize n) override {
+				if(jobMessages == nullptr)  return fallback_->sputn(src, n);
+				jobMessages->append(src, n);
+				return n;
+			}
+
+			int sync() override {
+				return (jobMessages == nullptr)? fallback_->pubsync() : 0; }
+
+		public:
+			explicit JobErrorBuf(std::streambuf* fallback): fallback_(fallback) { }
+		};
+
+
+		/** Runs an operation, and returns its exit status and error
+		 * message like ::main would print it, after the warnings the
+		 * operation wrote to std::cerr. */
+		template<typename Fn>
+		std::pair<int, std::string> runJob(Fn&& fn) {
+			using xorinator::runtime::FilePermissionException;
+			using xorinator::container::ContainerFormatException;
+			using xorinator::integrity::IntegrityException;
+			using xorinator::compress::CompressionFormatException;
+			using xorinator::reservoir::ReservoirException;
+			using xorinator::checkpoint::JournalException;
+			std::string messages;
+			jobMessages = &messages;
+			auto result = [&]() -> std::pair<int, std::string> {
+				#define CATCH_EX_(EX_) catch(EX_& ex) { \
+					return { EXIT_FAILURE, "[" #EX_ "] " + std::string(ex.what()) + '.' }; \
+				}
+				try {
+					return { fn()? EXIT_SUCCESS : EXIT_FAILURE, { } };
+				}
+				catch(FilePermissionException& ex) {
+					return { EXIT_FAILURE,
+						"[FilePermissionException] " + std::string(ex.what()) + ".\n"
+						"You can skip permission checks with the \"--force\" option." };
+				}
+				CATCH_EX_(CmdlnException)
+				CATCH_EX_(ContainerFormatException)
+				CATCH_EX_(IntegrityException)
+				CATCH_EX_(CompressionFormatException)
+				CATCH_EX_(ReservoirException)
+				CATCH_EX_(JournalException)
+				CATCH_EX_(ServerException)
+				CATCH_EX_(std::exception)
+				#undef CATCH_EX_
+			}();
+			jobMessages = nullptr;
+			// The client ends the message with a newline of its own
+			messages += result.second;
+			if((! messages.empty()) && (messages.back() == '\n'))  messages.pop_back();
+			if(messages.size() > MAX_MESSAGE_SIZE)  messages.resize(MAX_MESSAGE_SIZE);
+			result.second = std::move(messages);
+			return result;
+		}
+
+
+		/** Runs the operation of a request, whose file arguments are
+		 * replaced by the descriptors it came with. */
+		std::pair<int, std::string> runRequest(const std::string& args, const std::vector<Fd>& fds) {
+			return runJob([&]() {
+				if((! args.empty()) && (args.back() != '\0')) {
+					throw ServerException("invalid request arguments"); }
+				auto argv = std::vector<const char*>();
+				for(size_t i=0; i < args.size(); i = args.find('\0', i) + 1) {
+					argv.push_back(args.c_str() + i); }
+				auto cmdln = CommandLine(argv.size(), argv.data());
+				checkRemoteOperation(cmdln);
+				if(fds.size() != cmdln.variadicArgs.size() + 1) {
+					throw ServerException("the request doesn't have one descriptor per file"); }
+				cmdln.firstArg = "fd:" + std::to_string(fds[0].get());
+				for(size_t i=0; i < cmdln.variadicArgs.size(); ++i) {
+					cmdln.variadicArgs[i] = "fd:" + std::to_string(fds[i+1].get()); }
+				cmdln.firstLiteralArg = fds.size() + 1; // No argument is a literal path anymore
+				cmdln.socketPath.clear();
+				return xorinator::runtime::run(cmdln);
+			});
+		}
+
+
+		void serveConnection(int sock) {
+			if(! isSameUser(sock)) return;
+			if(
+					(0 != ::setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &CLIENT_TIMEOUT, sizeof(CLIENT_TIMEOUT))) ||
+					(0 != ::setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &CLIENT_TIMEOUT, sizeof(CLIENT_TIMEOUT)))
+			) {
+				throwErrno("could not set the timeouts of a connection"); }
+			int status;
+			std::string message;
+			{
+				std::vector<Fd> fds;
+				unsigned char header[REQUEST_HEADER_SIZE];
+				if(! recvAll(sock, header, sizeof(header), &fds)) return;
+				const auto argsSize = getLe<uint32_t>(header + 4);
+				if((getLe<uint32_t>(header) != REQUEST_MAGIC) || (argsSize > MAX_MESSAGE_SIZE) || (getLe<uint32_t>(header + 8) != fds.size())) {
+					throw ServerException("invalid request"); }
+				auto args = std::string(argsSize, '\0');
+				if(! recvAll(sock, args.data(), args.size())) {
+					throw ServerException("the connection was closed in the middle of a request"); }
+				std::tie(status, message) = runRequest(args, fds);
+			} // The descriptors are closed before replying, so that the readers of pipes see their end first
+			unsigned char header[REPLY_HEADER_SIZE];
+			putLe<uint32_t>(header, status);
+			putLe<uint32_t>(header + 4, message.size());
+			sendAll(sock, header, sizeof(header));
+			sendAll(sock, message.data(), message.size());
+		}
+
+	#endif
+
+}
+
+
+
+namespace xorinator::server {
+
+	bool serve(const cli::CommandLine& cmdln) {
+		if(cmdln.socketPath.empty()) {
+			throw CmdlnException("the \"serve\" subcommand needs a socket, given with \"--socket\""); }
+		if(! cmdln.firstArg.empty()) {
+			throw CmdlnException("the \"serve\" subcommand takes no file arguments"); }
+		#ifdef XORINATOR_POSIX_IO
+			// Clients may close their pipes early: that fails their operation, not the server
+			::signal(SIGPIPE, SIG_IGN);
+			const bool quiet = cmdln.options & OptionBits::eQuiet;
+			auto listener = listenOn(cmdln.socketPath);
+			static auto errorBuf = JobErrorBuf(std::cerr.rdbuf());
+			std::cerr.rdbuf(&errorBuf);
+			auto pool = runtime::WorkStealingPool(cmdln.jobCount);
+			// Every multiplexing operation takes one generator, plus one per pad worker
+			runtime::seedRngPool(2 * pool.workerCount());
+			while(true) {
+				int conn = ::accept(listener.get(), nullptr, nullptr);
+				if(conn < 0) {
+					if((errno == EINTR) || (errno == ECONNABORTED))  continue;
+					throwErrno("could not accept a connection on \"" + cmdln.socketPath + '"');
+				}
+				::fcntl(conn, F_SETFD, FD_CLOEXEC);
+				pool.push([conn, quiet]() {
+					auto owned = Fd(conn);
+					try {
+						serveConnection(conn);
+					} catch(std::exception& ex) {
+						if(! quiet)  std::cerr << "[ServerException] " << ex.what() << '.' << std::endl;
+					}
+				});
+			}
+		#else
+			throw ServerException("operations cannot be served on this platform");
+		#endif
+	}
+
+
+	int runRemote(const cli::CommandLine& cmdln, int argc, char const * const * argv) {
+		checkRemoteOperation(cmdln);
+		#ifdef XORINATOR_POSIX_IO
+			const size_t fileCount = cmdln.variadicArgs.size() + 1;
+			auto filePath = [&](size_t i) -> const std::string& {
+				return (i == 0)? cmdln.firstArg : cmdln.variadicArgs[i-1]; };
+			if(! (cmdln.options & OptionBits::eForce)) {
+				auto paths = std::unordered_set<std::string>(fileCount);
+				for(size_t i=0; i < fileCount; ++i) {
+					if(! paths.insert(filePath(i)).second)
+						throw CmdlnException("file arguments must be unique");
+				}
+			}
+
+			auto sock = mkSocket();
+			const auto addr = socketAddress(cmdln.socketPath);
+			if(0 != ::connect(sock.get(), reinterpret_cast<const sockaddr*>(&addr), sizeof(addr))) {
+				throwErrno("could not connect to the server on \"" + cmdln.socketPath + '"'); }
+
+			// The server is reached first, and the inputs are opened before the outputs,
+			// so that no output is truncated if the server or an input is missing
+			auto fds = std::vector<int>(fileCount, -1);
+			auto owned = std::vector<Fd>();
+			owned.reserve(fileCount);
+			for(bool inputs : { true, false }) {
+				for(size_t i=0; i < fileCount; ++i) {
+					const bool input = (cmdln.cmdType == CmdType::eMultiplex) == (i == 0);
+					if(input != inputs)  continue;
+					const std::string& path = filePath(i);
+					if(cmdln.firstLiteralArg > i) {
+						if(path == "-") {
+							fds[i] = input? STDIN_FILENO : STDOUT_FILENO;
+							continue;
+						}
+						if(auto fd = runtime::parseFdPath(path)) {
+							fds[i] = *fd;
+							continue;
+						}
+					}
+					int fd = input?
+						::open(path.c_str(), O_RDONLY | O_CLOEXEC) :
+						::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+					if(fd < 0) {
+						throw std::runtime_error("could not open \"" + path + "\": " + std::strerror(errno)); }
+					owned.emplace_back(fd);
+					fds[i] = fd;
+				}
+			}
+
+			std::string args;
+			for(int i=0; i < argc; ++i) {
+				args.append(argv[i]);
+				args.push_back('\0');
+			}
+			unsigned char header[REQUEST_HEADER_SIZE];
+			putLe<uint32_t>(header, REQUEST_MAGIC);
+			putLe<uint32_t>(header + 4, args.size());
+			putLe<uint32_t>(header + 8, fds.size());
+			sendAll(sock.get(), header, sizeof(header), fds.data(), fds.size());
+			sendAll(sock.get(), args.data(), args.size());
+			owned.clear(); // The server has its own copies
+
+			unsigned char reply[REPLY_HEADER_SIZE];
+			if(! recvAll(sock.get(), reply, sizeof(reply))) {
+				throw ServerException("the server closed the connection without replying"); }
+			const auto messageSize = getLe<uint32_t>(reply + 4);
+			if(messageSize > MAX_MESSAGE_SIZE) {
+				throw ServerException("invalid reply from the server"); }
+			auto message = std::string(messageSize, '\0');
+			if((messageSize > 0) && ! recvAll(sock.get(), message.data(), message.size())) {
+				throw ServerException("the server closed the connection in the middle of its reply"); }
+			if((! message.empty()) && ! (cmdln.options & OptionBits::eQuiet)) {
+				std::cerr << message << std::endl; }
+			return int(getLe<uint32_t>(reply));
+		#else
+			(void) argc;
+			(void) argv;
+			throw ServerException("operations cannot be sent to a server on this platform");
+		#endif
+	}
+
+}
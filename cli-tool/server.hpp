@@ -0,0 +1,64 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#pragma once
+
+#include <string>
+#include <stdexcept>
+
+#include "clparser.hpp"
+
+
+
+/** "xor serve --socket PATH" keeps a process running, with its random
+ * generators seeded and its worker threads started, and runs the
+ * multiplexing and demultiplexing operations it receives on a local
+ * Unix socket; a command line with the "--socket" option is sent to
+ * that process instead of being run.
+ *
+ * The client opens the files of the operation itself, and passes their
+ * descriptors along with its arguments (as SCM_RIGHTS ancillary data),
+ * so the server never opens a path on behalf of a client; only clients
+ * of the same user are served. A request is a 12-byte header (magic,
+ * size of the arguments, number of descriptors) followed by the
+ * arguments, each terminated by a null character; the reply is an
+ * 8-byte header (exit status, size of the message) followed by the
+ * error message of the operation, if any. Every integer is stored in
+ * little-endian byte order. */
+namespace xorinator::server {
+
+	class ServerException : public std::runtime_error {
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+
+	/** Listens on the socket of the "--socket" option, and runs the
+	 * operations it receives on "--jobs" threads, until the process is
+	 * terminated. A stale socket file is replaced. */
+	bool serve(const cli::CommandLine&);
+
+	/** Sends the operation of a command line to the server listening on
+	 * its "--socket" option, with the descriptors of its files; `argv`
+	 * is forwarded as it is. Prints the error of the operation unless
+	 * the "--quiet" option is used, and returns its exit status. */
+	int runRemote(const cli::CommandLine&, int argc, char const * const * argv);
+
+}
@@ -0,0 +1,159 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#include "sha256.hpp"
+
+#include <cstring>
+#include <bit>
+#include <algorithm>
+
+
+
+namespace {
+
+	constexpr std::array<uint32_t, 64> ROUND_CONSTANTS = {
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2 };
+
+	constexpr std::array<uint32_t, 8> INITIAL_STATE = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+
+}
+
+
+
+namespace xorinator {
+
+	Sha256::Sha256():
+			state_(INITIAL_STATE),
+			length_(0),
+			blockFill_(0)
+	{ }
+
+
+	void Sha256::compress_(const uint8_t* block) {
+		using std::rotr;
+		std::array<uint32_t, 64> w;
+		for(unsigned i=0; i < 16; ++i) {
+			w[i] =
+				(uint32_t(block[i*4]) << 24) | (uint32_t(block[i*4 + 1]) << 16) |
+				(uint32_t(block[i*4 + 2]) << 8) | uint32_t(block[i*4 + 3]);
+		}
+		for(unsigned i=16; i < 64; ++i) {
+			uint32_t s0 = rotr(w[i-15], 7) ^ rotr(w[i-15], 18) ^ (w[i-15] >> 3);
+			uint32_t s1 = rotr(w[i-2], 17) ^ rotr(w[i-2], 19) ^ (w[i-2] >> 10);
+			w[i] = w[i-16] + s0 + w[i-7] + s1;
+		}
+		auto v = state_;
+		for(unsigned i=0; i < 64; ++i) {
+			uint32_t s1 = rotr(v[4], 6) ^ rotr(v[4], 11) ^ rotr(v[4], 25);
+			uint32_t ch = (v[4] & v[5]) ^ ((~v[4]) & v[6]);
+			uint32_t t1 = v[7] + s1 + ch + ROUND_CONSTANTS[i] + w[i];
+			uint32_t s0 = rotr(v[0], 2) ^ rotr(v[0], 13) ^ rotr(v[0], 22);
+			uint32_t maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+			uint32_t t2 = s0 + maj;
+			v[7] = v[6];  v[6] = v[5];  v[5] = v[4];  v[4] = v[3] + t1;
+			v[3] = v[2];  v[2] = v[1];  v[1] = v[0];  v[0] = t1 + t2;
+		}
+		for(unsigned i=0; i < 8; ++i) {
+			state_[i] += v[i]; }
+	}
+
+
+	void Sha256::update(const void* data, size_t size) {
+		auto bytes = reinterpret_cast<const uint8_t*>(data);
+		length_ += size;
+		if(blockFill_ > 0) {
+			size_t n = std::min<size_t>(size, block_.size() - blockFill_);
+			std::memcpy(block_.data() + blockFill_, bytes, n);
+			blockFill_ += n;
+			bytes += n;
+			size -= n;
+			if(blockFill_ < block_.size()) return;
+			compress_(block_.data());
+			blockFill_ = 0;
+		}
+		while(size >= block_.size()) {
+			compress_(bytes);
+			bytes += block_.size();
+			size -= block_.size();
+		}
+		std::memcpy(block_.data(), bytes, size);
+		blockFill_ = size;
+	}
+
+
+	Sha256::Digest Sha256::finish() {
+		uint64_t bitLength = length_ * 8;
+		uint8_t pad = 0x80;
+		update(&pad, 1);
+		pad = 0;
+		while(blockFill_ != 56) {
+			update(&pad, 1); }
+		std::array<uint8_t, 8> lengthBytes;
+		for(unsigned i=0; i < 8; ++i) {
+			lengthBytes[i] = uint8_t(bitLength >> (56 - (i * 8))); }
+		update(lengthBytes.data(), lengthBytes.size());
+		Digest r;
+		for(unsigned i=0; i < 8; ++i) {
+			for(unsigned j=0; j < 4; ++j) {
+				r[(i * 4) + j] = uint8_t(state_[i] >> (24 - (j * 8))); }
+		}
+		return r;
+	}
+
+
+	std::string Sha256::toHex(const Digest& digest) {
+		static constexpr char digits[] = "0123456789abcdef";
+		std::string r;
+		r.reserve(digest.size() * 2);
+		for(uint8_t byte : digest) {
+			r.push_back(digits[byte >> 4]);
+			r.push_back(digits[byte & 0xf]);
+		}
+		return r;
+	}
+
+
+	std::optional<Sha256::Digest> Sha256::fromHex(std::string_view hex) {
+		constexpr auto digitValue = [](char c) -> int {
+			if(c >= '0' && c <= '9') return c - '0';
+			if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+			if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+			return -1;
+		};
+		Digest r;
+		if(hex.size() != r.size() * 2) return std::nullopt;
+		for(size_t i=0; i < r.size(); ++i) {
+			int hi = digitValue(hex[i * 2]);
+			int lo = digitValue(hex[(i * 2) + 1]);
+			if((hi < 0) || (lo < 0)) return std::nullopt;
+			r[i] = uint8_t((hi << 4) | lo);
+		}
+		return r;
+	}
+
+}
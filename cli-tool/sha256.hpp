@@ -0,0 +1,62 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#pragma once
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <cstdint>
+#include <cstddef>
+
+
+
+namespace xorinator {
+
+	/** An incremental SHA-256 hash, as specified by FIPS 180-4. */
+	class Sha256 {
+	public:
+		using Digest = std::array<uint8_t, 32>;
+
+	private:
+		std::array<uint32_t, 8> state_;
+		std::array<uint8_t, 64> block_;
+		uint64_t length_;
+		unsigned blockFill_;
+
+		void compress_(const uint8_t*);
+
+	public:
+		Sha256();
+
+		void update(const void* data, size_t size);
+
+		/** Returns the digest of everything hashed so far; the hash
+		 * must not be updated afterwards. */
+		Digest finish();
+
+		static std::string toHex(const Digest&);
+
+		/** Parses a 64-digit hexadecimal digest. */
+		static std::optional<Digest> fromHex(std::string_view);
+	};
+
+}
@@ -0,0 +1,149 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#include <test_tools.hpp>
+
+#include <cli-tool/blockio.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <random>
+#include <mutex>
+
+
+
+namespace {
+
+	constexpr auto eFailure = utest::ResultType::eFailure;
+	constexpr auto eSuccess = utest::ResultType::eSuccess;
+
+	using xorinator::runtime::DeviceWriters;
+
+
+	/** A stream buffer that keeps what is written to it, and the size of
+	 * every write. */
+	class RecordingBuf : public std::streambuf {
+	public:
+		std::string content;
+		std::vector<size_t> writes;
+
+	protected:
+		int_type overflow(int_type c) override {
+			if(! traits_type::eq_int_type(c, traits_type::eof())) {
+				char ch = traits_type::to_char_type(c);
+				xsputn(&ch, 1);
+			}
+			return traits_type::not_eof(c);
+		}
+
+		std::streamsize xsputn(const char_type* src, std::streamsize n) override {
+			content.append(src, n);
+			writes.push_back(n);
+			return n;
+		}
+	};
+
+
+	/** A stream buffer that never accepts anything, like a full disk. */
+	class FullBuf : public std::streambuf {
+	protected:
+		int_type overflow(int_type) override { return traits_type::eof(); }
+		std::streamsize xsputn(const char_type*, std::streamsize) override { return 0; }
+	};
+
+
+	/** Expect every output to receive exactly what was written to it,
+	 * in extents of the size for its device: three outputs on a shared
+	 * device, one on its own. */
+	utest::ResultType test_device_writers(std::ostream& os) {
+		constexpr size_t soloExtent = 100;
+		constexpr size_t sharedExtent = 1000;
+		auto rng = std::minstd_rand(4321);
+		auto bufs = std::vector<RecordingBuf>(4);
+		auto targets = std::vector<std::unique_ptr<std::ostream>>();
+		auto targetPtrs = std::vector<std::ostream*>();
+		for(auto& buf : bufs) {
+			targetPtrs.push_back(targets.emplace_back(std::make_unique<std::ostream>(&buf)).get()); }
+		auto expected = std::vector<std::string>(bufs.size());
+		{
+			auto writers = DeviceWriters(targetPtrs, { 7, 3, 7, 7 }, soloExtent, sharedExtent);
+			if(writers.deviceCount() != 2) {
+				os << "Expected 2 devices, found " << writers.deviceCount() << std::endl;
+				return eFailure;
+			}
+			for(unsigned round=0; round < 200; ++round) {
+				for(size_t i=0; i < bufs.size(); ++i) {
+					auto piece = std::string(rng() % 97, '\0');
+					for(auto& c : piece)  c = char(rng());
+					writers.stream(i).write(piece.data(), piece.size());
+					expected[i] += piece;
+				}
+			}
+			writers.finish();
+		}
+		for(size_t i=0; i < bufs.size(); ++i) {
+			if(bufs[i].content != expected[i]) {
+				os << "Output " << i << " does not have the expected content" << std::endl;
+				return eFailure;
+			}
+			size_t extent = (i == 1)? soloExtent : sharedExtent;
+			for(size_t w=0; w + 1 < bufs[i].writes.size(); ++w) {
+				if(bufs[i].writes[w] != extent) {
+					os << "Output " << i << " was written in pieces of " << bufs[i].writes[w] << " bytes" << std::endl;
+					return eFailure;
+				}
+			}
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect an exception thrown by a target to be rethrown by
+	 * DeviceWriters::finish. */
+	utest::ResultType test_device_writers_error(std::ostream& os) {
+		auto buf = RecordingBuf();
+		auto good = std::ostream(&buf);
+		auto fullBuf = FullBuf();
+		auto bad = std::ostream(&fullBuf);
+		bad.exceptions(std::ios_base::badbit);
+		try {
+			auto writers = DeviceWriters({ &good, &bad }, { 1, 2 }, 16, 16);
+			writers.stream(0) << "some data";
+			writers.stream(1) << "some more data";
+			writers.finish();
+		} catch(std::ios_base::failure&) {
+			return eSuccess;
+		}
+		os << "Expected an exception, none thrown" << std::endl;
+		return eFailure;
+	}
+
+}
+
+
+
+int main(int, char**) {
+	auto batch = utest::TestBatch(std::cout);
+	batch
+		.run("Device writers", test_device_writers)
+		.run("Device writers (failing output)", test_device_writers_error);
+	return batch.failures() == 0? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -201,7 +201,7 @@ namespace {
 	}
 
 
-	const auto cmdLines = std::array<DynArgv, 11> {
+	const auto cmdLines = std::array<DynArgv, 13> {
 		DynArgv { "xor", "mux", "--key", "1234", "in.txt", "-k", "5678", "out.1.txt", "out.2.txt", "--key", "9abc" },
 		DynArgv { "xor", "dmx", "in.txt", "out.1.txt", "out.2.txt", "-q" },
 		DynArgv { "xor", "dmx", "-fq"},
@@ -212,7 +212,9 @@ namespace {
 		DynArgv { "xor", "mux", "-fqinvald" },
 		DynArgv { "xor", "mux" },
 		DynArgv { "xor", "invalid subcommand" },
-		DynArgv { "xor" } };
+		DynArgv { "xor" },
+		DynArgv { "xor", "mux", "-r", "-j", "4", "src", "dst.1", "dst.2" },
+		DynArgv { "xor", "mux", "--durability=sometimes", "src", "dst.1", "dst.2" } };
 
 }
 
@@ -223,6 +225,7 @@ int main(int, char**) {
 	constexpr static auto optNone = xorinator::cli::OptionBits::eNone;
 	constexpr static auto optQuiet = xorinator::cli::OptionBits::eQuiet;
 	constexpr static auto optForce = xorinator::cli::OptionBits::eForce;
+	constexpr static auto optRecursive = xorinator::cli::OptionBits::eRecursive;
 	batch
 		.run("Command with literal argument marker (syntax)", test_literal_cmd)
 		.run("Command with literal argument marker (first argument)", test_literal_pos<true>)
@@ -245,6 +248,9 @@ int main(int, char**) {
 		.run("Unrecognized subcommand", mk_test_cmdln(cmdLines[9],
 			"xor", CmdType::eError, { }, "", { }, optNone))
 		.run("Nothing", mk_test_cmdln(cmdLines[10],
-			"xor", CmdType::eNone, { }, "", { }, optNone));
+			"xor", CmdType::eNone, { }, "", { }, optNone))
+		.run("Multiple arguments, -r and -j options", mk_test_cmdln(cmdLines[11],
+			"xor", CmdType::eMultiplex, { }, "src", { "dst.1", "dst.2" }, optRecursive))
+		.run("Invalid durability mode (fail)", mk_test_cmdln_except<xorinator::cli::InvalidCommandLineException>(cmdLines[12]));
 	return batch.failures() == 0? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,117 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#include <test_tools.hpp>
+
+#include <cli-tool/compress.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <random>
+
+
+
+namespace {
+
+	constexpr auto eFailure = utest::ResultType::eFailure;
+	constexpr auto eSuccess = utest::ResultType::eSuccess;
+
+	using namespace xorinator::compress;
+
+
+	std::string roundTrip(const std::string& content, size_t* compressedSize) {
+		auto src = std::istringstream(content);
+		auto compressedIn = CompressingIStream(src);
+		std::string compressed = { std::istreambuf_iterator<char>(compressedIn), std::istreambuf_iterator<char>() };
+		*compressedSize = compressed.size();
+		auto dst = std::ostringstream();
+		auto decompressedOut = DecompressingOStream(dst);
+		decompressedOut.exceptions(std::ios_base::badbit);
+		decompressedOut.write(compressed.data(), compressed.size());
+		decompressedOut.finish();
+		return dst.str();
+	}
+
+
+	/** Expect empty, compressible and random data to be decompressed
+	 * into an exact copy, and compressible data to shrink. */
+	utest::ResultType test_round_trip(std::ostream& os) {
+		auto rng = std::minstd_rand(1234);
+		std::string empty;
+		std::string random;
+		std::string repetitive;
+		for(unsigned i=0; i < 3 * BLOCK_SIZE + 17; ++i)  random.push_back(char(rng()));
+		for(unsigned i=0; i < 30000; ++i)  repetitive += std::to_string(i % 1000) + ' ';
+		for(const auto* content : { &empty, &repetitive, &random }) {
+			size_t compressedSize;
+			if(roundTrip(*content, &compressedSize) != *content) {
+				os << "Round trip failed for " << content->size() << " bytes" << std::endl;
+				return eFailure;
+			}
+			if(compressedSize > content->size() + 4 + 4 * (content->size() / BLOCK_SIZE + 2)) {
+				os << "Data grew too much: " << content->size() << " to " << compressedSize << std::endl;
+				return eFailure;
+			}
+		}
+		size_t compressedSize;
+		roundTrip(repetitive, &compressedSize);
+		if(compressedSize * 2 > repetitive.size()) {
+			os << "Compressible data did not shrink enough" << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect truncated and corrupted streams to be rejected. */
+	utest::ResultType test_malformed(std::ostream& os) {
+		std::string content;
+		for(unsigned i=0; i < 10000; ++i)  content += std::to_string(i % 100);
+		auto src = std::istringstream(content);
+		auto compressedIn = CompressingIStream(src);
+		std::string compressed = { std::istreambuf_iterator<char>(compressedIn), std::istreambuf_iterator<char>() };
+		auto corrupted = compressed;
+		corrupted[0] = 'Y';
+		for(const auto& bad : { compressed.substr(0, compressed.size() / 2), corrupted, compressed + "x" }) {
+			try {
+				auto dst = std::ostringstream();
+				auto decompressedOut = DecompressingOStream(dst);
+				decompressedOut.exceptions(std::ios_base::badbit);
+				decompressedOut.write(bad.data(), bad.size());
+				decompressedOut.finish();
+				os << "A malformed stream of " << bad.size() << " bytes was accepted" << std::endl;
+				return eFailure;
+			} catch(CompressionFormatException&) { }
+		}
+		return eSuccess;
+	}
+
+}
+
+
+
+int main(int, char**) {
+	auto batch = utest::TestBatch(std::cout);
+	batch
+		.run("Round trip", test_round_trip)
+		.run("Malformed streams", test_malformed);
+	return batch.failures() == 0? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,129 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#include <test_tools.hpp>
+
+#include <cli-tool/gf256.hpp>
+
+#include <iostream>
+#include <vector>
+#include <random>
+
+
+
+namespace {
+
+	constexpr auto eFailure = utest::ResultType::eFailure;
+	constexpr auto eSuccess = utest::ResultType::eSuccess;
+
+	using namespace xorinator::gf256;
+
+
+	/** Carry-less multiplication, reduced bit by bit. */
+	uint8_t slowMul(uint8_t a, uint8_t b) {
+		unsigned r = 0;
+		unsigned aa = a;
+		for(unsigned i=0; i < 8; ++i) {
+			if(b & (1 << i))  r = r ^ (aa << i); }
+		for(unsigned i=15; i >= 8; --i) {
+			if(r & (1 << i))  r = r ^ (0x11d << (i - 8)); }
+		return r;
+	}
+
+
+	/** Expect the table multiplication and inversion to agree with the
+	 * definition of the field. */
+	utest::ResultType test_mul_inv(std::ostream& os) {
+		for(unsigned a=0; a < 256; ++a) {
+			for(unsigned b=0; b < 256; ++b) {
+				if(mul(a, b) != slowMul(a, b)) {
+					os << "Wrong product " << a << " * " << b << std::endl;
+					return eFailure;
+				}
+			}
+			if((a != 0) && (mul(a, inv(a)) != 1)) {
+				os << "Wrong inverse of " << a << std::endl;
+				return eFailure;
+			}
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect the vectorized region multiplication to match the scalar
+	 * one for every factor, with lengths and offsets that are not
+	 * multiples of the vector width. */
+	utest::ResultType test_mul_add(std::ostream& os) {
+		auto rng = std::minstd_rand(1234);
+		auto src = std::vector<uint8_t>(1000 + 3);
+		auto dst = std::vector<uint8_t>(src.size());
+		for(auto& byte : src)  byte = rng();
+		for(auto& byte : dst)  byte = rng();
+		for(unsigned c=0; c < 256; ++c) {
+			auto result = dst;
+			mulAdd(result.data() + 3, src.data() + 3, src.size() - 3, c);
+			for(size_t i=0; i < src.size(); ++i) {
+				uint8_t expect = (i < 3)? dst[i] : (dst[i] ^ slowMul(c, src[i]));
+				if(result[i] != expect) {
+					os << "Wrong result at offset " << i << " for factor " << c << std::endl;
+					return eFailure;
+				}
+			}
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect every 3 of 5 values of a random polynomial of degree 2
+	 * to interpolate its constant term. */
+	utest::ResultType test_lagrange(std::ostream& os) {
+		auto rng = std::minstd_rand(5678);
+		for(unsigned round=0; round < 100; ++round) {
+			uint8_t poly[3] = { uint8_t(rng()), uint8_t(rng()), uint8_t(rng()) };
+			uint8_t values[5];
+			for(unsigned x=1; x <= 5; ++x) {
+				values[x-1] = poly[0] ^ mul(poly[1], x) ^ mul(poly[2], mul(x, x)); }
+			for(unsigned a=0; a < 5; ++a)
+			for(unsigned b=a+1; b < 5; ++b)
+			for(unsigned c=b+1; c < 5; ++c) {
+				auto coefficients = lagrangeAtZero({ uint8_t(a+1), uint8_t(b+1), uint8_t(c+1) });
+				uint8_t secret =
+					mul(coefficients[0], values[a]) ^ mul(coefficients[1], values[b]) ^ mul(coefficients[2], values[c]);
+				if(secret != poly[0]) {
+					os << "Wrong interpolation from points " << a+1 << ", " << b+1 << ", " << c+1 << std::endl;
+					return eFailure;
+				}
+			}
+		}
+		return eSuccess;
+	}
+
+}
+
+
+
+int main(int, char**) {
+	auto batch = utest::TestBatch(std::cout);
+	batch
+		.run("Multiplication and inverse", test_mul_inv)
+		.run("Region multiplication", test_mul_add)
+		.run("Lagrange interpolation", test_lagrange);
+	return batch.failures() == 0? EXIT_SUCCESS : EXIT_FAILURE;
+}
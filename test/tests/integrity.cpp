@@ -0,0 +1,218 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#include <test_tools.hpp>
+
+#include <cli-tool/integrity.hpp>
+#include <cli-tool/sha256.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <array>
+#include <utility>
+
+
+
+namespace {
+
+	constexpr auto eFailure = utest::ResultType::eFailure;
+	constexpr auto eNeutral = utest::ResultType::eNeutral;
+	constexpr auto eSuccess = utest::ResultType::eSuccess;
+
+	using namespace xorinator::integrity;
+
+	const std::string sharePath = "integrity-share.bin";
+	constexpr uint32_t blockSize = 1024;
+
+
+	std::string mkData(size_t size) {
+		auto rng = std::minstd_rand(size);
+		std::string r(size, '\0');
+		for(auto& c : r) {
+			c = char(rng()); }
+		return r;
+	}
+
+
+	/** Write a share through an IndexingOStream, flushing it at odd
+	 * offsets so that blocks are not aligned with the buffer. */
+	bool mkIndexedShare(std::ostream& os, const std::string& data) {
+		try {
+			auto file = std::ofstream(sharePath, std::ios_base::binary);
+			file.exceptions(std::ios_base::badbit);
+			auto indexed = IndexingOStream(file, blockSize);
+			for(size_t i=0; i < data.size(); ++i) {
+				indexed.put(data[i]);
+				if(i % 777 == 0)  indexed.flush();
+			}
+			auto indexFile = std::ofstream(IntegrityIndex::pathFor(sharePath), std::ios_base::binary);
+			indexed.finish().write(indexFile);
+			return true;
+		} catch(std::exception& ex) {
+			os << "Could not write the share: " << ex.what() << std::endl;
+		}
+		return false;
+	}
+
+
+	/** Expect the CRC32C of the standard check string to match the
+	 * reference value, both in one go and in pieces. */
+	utest::ResultType test_crc32c_check(std::ostream& os) {
+		constexpr uint32_t expect = 0xe3069283;
+		const std::string check = "123456789";
+		uint32_t oneGo = crc32c(0, check.data(), check.size());
+		uint32_t pieces = crc32c(crc32c(0, check.data(), 4), check.data() + 4, check.size() - 4);
+		if((oneGo != expect) || (pieces != expect)) {
+			os << std::hex << "Expected " << expect << ", got " << oneGo << " and " << pieces << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+
+	/** Expect the FIPS 180-4 example digests, both when hashing a
+	 * message in one go and one byte at a time. */
+	utest::ResultType test_sha256_vectors(std::ostream& os) {
+		using xorinator::Sha256;
+		const auto vectors = std::array<std::pair<std::string, std::string>, 3> {
+			std::pair { "", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+			std::pair { "abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+			std::pair {
+				"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+				"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" } };
+		for(const auto& [msg, expect] : vectors) {
+			Sha256 oneGo;
+			Sha256 bytewise;
+			oneGo.update(msg.data(), msg.size());
+			for(char c : msg) {
+				bytewise.update(&c, 1); }
+			auto digest = Sha256::toHex(oneGo.finish());
+			auto bytewiseDigest = Sha256::toHex(bytewise.finish());
+			if((digest != expect) || (bytewiseDigest != expect)) {
+				os << "Expected " << expect << " for \"" << msg << "\", got " << digest << " and " << bytewiseDigest << std::endl;
+				return eFailure;
+			}
+			if(Sha256::fromHex(expect) != Sha256::fromHex(digest)) {
+				os << "Could not parse " << expect << std::endl;
+				return eFailure;
+			}
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect a freshly written share to match its index, as a whole
+	 * and in a partial range. */
+	template<size_t dataSize>
+	utest::ResultType test_verify_intact(std::ostream& os) {
+		auto data = mkData(dataSize);
+		if(! mkIndexedShare(os, data))  return eNeutral;
+		try {
+			auto index = IndexReader(IntegrityIndex::pathFor(sharePath));
+			auto share = std::ifstream(sharePath, std::ios_base::binary);
+			if(index.dataSize() != dataSize) {
+				os << "Index size mismatch" << std::endl;
+				return eFailure;
+			}
+			if(verifyShare(share, index, 0, std::numeric_limits<uint64_t>::max()) ||
+			   verifyShare(share, index, dataSize / 3, dataSize / 2)) {
+				os << "Intact share reported as corrupted" << std::endl;
+				return eFailure;
+			}
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect a flipped bit to be detected when checking a range that
+	 * contains it, and only then. */
+	utest::ResultType test_verify_flipped_bit(std::ostream& os) {
+		constexpr size_t dataSize = 20 * blockSize + 5;
+		constexpr size_t flipAt = 13 * blockSize + 100;
+		auto data = mkData(dataSize);
+		if(! mkIndexedShare(os, data))  return eNeutral;
+		try {
+			{
+				auto share = std::fstream(sharePath, std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+				share.seekp(flipAt);
+				share.put(char(data[flipAt] ^ 0x10));
+			}
+			auto index = IndexReader(IntegrityIndex::pathFor(sharePath));
+			auto share = std::ifstream(sharePath, std::ios_base::binary);
+			auto whole = verifyShare(share, index, 0, dataSize);
+			auto before = verifyShare(share, index, 0, 13 * blockSize);
+			auto ranged = verifyShare(share, index, flipAt, flipAt + 1);
+			if((! whole) || (*whole != 13 * blockSize) || before || (! ranged)) {
+				os << "Flipped bit not detected, or detected out of range" << std::endl;
+				return eFailure;
+			}
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect a corrupted index node to be detected. */
+	utest::ResultType test_corrupted_index(std::ostream& os) {
+		auto data = mkData(9 * blockSize);
+		if(! mkIndexedShare(os, data))  return eNeutral;
+		try {
+			{
+				auto index = std::fstream(IntegrityIndex::pathFor(sharePath), std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+				index.seekp(IntegrityIndex::HEADER_SIZE + (4 * 4));
+				index.put('\xff');
+				index.put('\xff');
+			}
+			auto index = IndexReader(IntegrityIndex::pathFor(sharePath));
+			index.verifiedLeaves(4, 5);
+		} catch(IntegrityException&) {
+			return eSuccess;
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		os << "Expected an exception, none thrown" << std::endl;
+		return eFailure;
+	}
+
+}
+
+
+
+int main(int, char**) {
+	auto batch = utest::TestBatch(std::cout);
+	batch
+		.run("CRC32C check value", test_crc32c_check)
+		.run("SHA-256 test vectors", test_sha256_vectors)
+		.run("Intact share (empty)", test_verify_intact<0>)
+		.run("Intact share (one partial block)", test_verify_intact<blockSize / 2>)
+		.run("Intact share (many blocks)", test_verify_intact<blockSize * 37 + 1>)
+		.run("Flipped bit", test_verify_flipped_bit)
+		.run("Corrupted index", test_corrupted_index);
+	return batch.failures() == 0? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,98 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#include <test_tools.hpp>
+
+#include <cli-tool/kernel.hpp>
+
+#include <iostream>
+#include <vector>
+#include <random>
+
+
+
+namespace {
+
+	constexpr auto eFailure = utest::ResultType::eFailure;
+	constexpr auto eSuccess = utest::ResultType::eSuccess;
+
+	using xorinator::kernel::xorBlocks;
+
+
+	/** Expect the kernels to match a byte-wise XOR for every source
+	 * count, including the ones above the unrolled kernels, with a size
+	 * that is not a multiple of the word size. */
+	utest::ResultType test_xor_blocks(std::ostream& os) {
+		constexpr size_t size = 1000 + 5;
+		auto rng = std::minstd_rand(1234);
+		auto sources = std::vector<std::vector<uint8_t>>(20, std::vector<uint8_t>(size));
+		for(auto& source : sources) {
+			for(auto& byte : source)  byte = rng(); }
+		for(size_t count=0; count <= sources.size(); ++count) {
+			auto ptrs = std::vector<const uint8_t*>(count);
+			for(size_t s=0; s < count; ++s)  ptrs[s] = sources[s].data();
+			auto dst = std::vector<uint8_t>(size, 0x5a);
+			xorBlocks(dst.data(), ptrs.data(), count, size);
+			for(size_t i=0; i < size; ++i) {
+				uint8_t expect = 0;
+				for(size_t s=0; s < count; ++s)  expect ^= sources[s][i];
+				if(dst[i] != expect) {
+					os << "Wrong result at offset " << i << " for " << count << " sources" << std::endl;
+					return eFailure;
+				}
+			}
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect the destination to be usable as the first source. */
+	utest::ResultType test_xor_blocks_in_place(std::ostream& os) {
+		constexpr size_t size = 777;
+		auto rng = std::minstd_rand(5678);
+		for(size_t count : { 2, 8, 13 }) {
+			auto sources = std::vector<std::vector<uint8_t>>(count, std::vector<uint8_t>(size));
+			for(auto& source : sources) {
+				for(auto& byte : source)  byte = rng(); }
+			auto expect = std::vector<uint8_t>(size, 0);
+			for(const auto& source : sources) {
+				for(size_t i=0; i < size; ++i)  expect[i] ^= source[i]; }
+			auto ptrs = std::vector<const uint8_t*>(count);
+			for(size_t s=0; s < count; ++s)  ptrs[s] = sources[s].data();
+			xorBlocks(sources[0].data(), ptrs.data(), count, size);
+			if(sources[0] != expect) {
+				os << "Wrong in-place result for " << count << " sources" << std::endl;
+				return eFailure;
+			}
+		}
+		return eSuccess;
+	}
+
+}
+
+
+
+int main(int, char**) {
+	auto batch = utest::TestBatch(std::cout);
+	batch
+		.run("XOR kernels", test_xor_blocks)
+		.run("XOR kernels (in place)", test_xor_blocks_in_place);
+	return batch.failures() == 0? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -25,6 +25,7 @@
 #include <iostream>
 #include <fstream>
 #include <filesystem>
+#include <random>
 
 
 
@@ -120,6 +121,72 @@ namespace {
 		return eSuccess;
 	}
 
+
+	/** Expect the combined keystream of several keys to match the XOR of
+	 * their iterators, across several regenerations of the engines. */
+	utest::ResultType test_rngkey_stream(std::ostream& os) {
+		constexpr size_t genBytes = 5000;
+		auto keys = std::array<xorinator::RngKey<512>, 3> {
+			xorinator::RngKey<512>(std::string_view("first key")),
+			xorinator::RngKey<512>(std::string_view("second key")),
+			xorinator::RngKey<512>(std::string_view("third key")) };
+		std::string expected(genBytes, '\0');
+		for(const auto& key : keys) {
+			auto str = key_to_str(key.view(0, genBytes));
+			for(size_t i=0; i < genBytes; ++i) {
+				expected[i] ^= str[i]; }
+		}
+		auto stream = xorinator::RngKeyStream<512>(keys.data(), keys.size());
+		std::string generated(genBytes, '\0');
+		// Apply the keystream in irregular pieces
+		for(size_t offset=0, piece=1; offset < genBytes; offset += piece, piece = piece * 3 + 1) {
+			piece = std::min(piece, genBytes - offset);
+			stream.apply(reinterpret_cast<xorinator::byte_t*>(generated.data() + offset), piece);
+		}
+		for(size_t i=0; i < genBytes; ++i) {
+			if(generated[i] != expected[i]) {
+				os << "Mismatch at byte " << i << std::endl;
+				return eFailure;
+			}
+		}
+		return eSuccess;
+	}
+
+
+
+	/** Expect every lane of a twist kernel to produce the same values as
+	 * a std::mt19937_64 with the same seed, for a few regenerations. */
+	template<xorinator::mt64::Kernel kernel, size_t lanes>
+	utest::ResultType test_mt64_kernel(std::ostream& os) {
+		namespace mt64 = xorinator::mt64;
+		constexpr size_t twists = 3;
+		if(! mt64::kernelSupported(kernel)) {
+			os << "Kernel not supported by this CPU" << std::endl;
+			return eNeutral;
+		}
+		auto seeds = std::array<uint64_t, lanes>();
+		auto engines = std::vector<std::mt19937_64>();
+		for(size_t l=0; l < lanes; ++l) {
+			seeds[l] = 0x9e3779b97f4a7c15 * (l + 1);
+			engines.emplace_back(seeds[l]);
+		}
+		auto state = std::vector<uint64_t>(mt64::STATE_WORDS * lanes);
+		auto out = std::vector<uint64_t>(mt64::STATE_WORDS * lanes);
+		mt64::seedLanes(state.data(), seeds.data(), lanes);
+		for(size_t t=0; t < twists; ++t) {
+			mt64::twistLanes(state.data(), out.data(), lanes, kernel);
+			for(size_t j=0; j < mt64::STATE_WORDS; ++j) {
+				for(size_t l=0; l < lanes; ++l) {
+					if(out[(j * lanes) + l] != engines[l]()) {
+						os << "Mismatch at lane " << l << ", value " << ((t * mt64::STATE_WORDS) + j) << std::endl;
+						return eFailure;
+					}
+				}
+			}
+		}
+		return eSuccess;
+	}
+
 }
 
 
@@ -127,6 +194,7 @@ namespace {
 int main(int, char**) {
 	constexpr unsigned SHORT_CHARS = 12;
 	constexpr unsigned LONG_CHARS = 4096*4;
+	using xorinator::mt64::Kernel;
 	auto batch = utest::TestBatch(std::cout);
 	batch
 		.run("789a.0x40 == 789a.0x40", test_rng64_to_rng64<0x123456789a, 0x123456789a, 0, SHORT_CHARS, true>)
@@ -136,6 +204,14 @@ int main(int, char**) {
 		.run("4321.0x40 != 789a.0x40 (long)", test_rng64_to_rng64<0x123456789a, 0xa987654321, 0, LONG_CHARS, false>)
 		.run("4321.0x80 == 4321.0x80", test_rng128_to_rng128<0xa987654321, 0xa987654321, 0, SHORT_CHARS, true>)
 		.run("4321.0x40 != 4321.0x80", test_rng64_to_rng128<0xa987654321, 0, SHORT_CHARS, false>)
-		.run("Deterministic key from string", test_rngkey512);
+		.run("Deterministic key from string", test_rngkey512)
+		.run("Combined keystream of several keys", test_rngkey_stream)
+		.run("Scalar MT19937-64 (1 lane)", test_mt64_kernel<Kernel::eScalar, 1>)
+		.run("Scalar MT19937-64 (8 lanes)", test_mt64_kernel<Kernel::eScalar, 8>)
+		.run("AVX2 MT19937-64 (8 lanes)", test_mt64_kernel<Kernel::eAvx2, 8>)
+		.run("AVX2 MT19937-64 (13 lanes)", test_mt64_kernel<Kernel::eAvx2, 13>)
+		.run("AVX-512 MT19937-64 (3 lanes)", test_mt64_kernel<Kernel::eAvx512, 3>)
+		.run("AVX-512 MT19937-64 (8 lanes)", test_mt64_kernel<Kernel::eAvx512, 8>)
+		.run("AVX-512 MT19937-64 (21 lanes)", test_mt64_kernel<Kernel::eAvx512, 21>);
 	return batch.failures() == 0? EXIT_SUCCESS : EXIT_FAILURE;
 }
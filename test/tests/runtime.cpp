@@ -22,11 +22,29 @@
 
 #include <cli-tool/clparser.hpp>
 #include <cli-tool/runtime.hpp>
+#include <cli-tool/container.hpp>
+#include <cli-tool/sha256.hpp>
+#include <cli-tool/reservoir.hpp>
+#include <cli-tool/checkpoint.hpp>
+#include <cli-tool/integrity.hpp>
+#include <cli-tool/delta.hpp>
+#include <cli-tool/server.hpp>
 
 #include <iostream>
 #include <fstream>
 #include <filesystem>
 #include <array>
+#include <iterator>
+#include <algorithm>
+
+#ifdef __unix__
+	extern "C" {
+		#include <fcntl.h>
+		#include <unistd.h>
+		#include <signal.h>
+		#include <sys/wait.h>
+	}
+#endif
 
 
 
@@ -42,6 +60,16 @@ namespace {
 	const std::string otpNoGenPath = "run-tests.sh";
 	const std::string otpDstPath0 = "deterministic-msg.1.xor";
 	const std::string otpDstPath1 = "deterministic-msg.2.xor";
+	const std::string otpDstPath2 = "deterministic-msg.3.xor";
+	const std::string otpNewPath0 = "deterministic-msg.1.new.xor";
+	const std::string otpNewPath1 = "deterministic-msg.2.new.xor";
+	const std::string reservoirPath = "deterministic-msg.reservoir";
+	const std::string deltaIndexPath = "deterministic-msg.blocks";
+	const std::string socketPath = "deterministic-msg.sock";
+	const std::string srcDirPath = "deterministic-tree";
+	const std::string srcCpDirPath = "deterministic-tree.demux";
+	const std::string otpDstDirPath0 = "deterministic-tree.1.xor";
+	const std::string otpDstDirPath1 = "deterministic-tree.2.xor";
 	const std::string message = "rcompat\n";
 	const std::string expectedExceptionMsg = "Expected an exception, none thrown";
 
@@ -274,6 +302,1257 @@ namespace {
 	}
 
 
+	/** Expect a file longer than several blocks to be multiplexed into
+	 * five shares, whose pads are split across two generator threads,
+	 * then demultiplexed into an exact copy of itself. */
+	utest::ResultType test_mux_demux_workers(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		std::string content;
+		for(unsigned i=0; i < 300000; ++i) {
+			content += std::to_string(i * 7) + ' '; }
+		try {
+			{ // Create the file and its shares
+				if(! mkFile(os, srcPath, content))  return eNeutral;
+				std::array<const char*, 9> argv = { "xor", "mux", "-j2", srcPath.c_str(),
+					otpDstPath0.c_str(), otpDstPath1.c_str(), otpNewPath0.c_str(), otpNewPath1.c_str(), srcCpPath.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eFailure;
+				}
+			} { // Demultiplex the shares into the source
+				std::array<const char*, 8> argv = { "xor", "dmx", srcPath.c_str(),
+					otpDstPath0.c_str(), otpDstPath1.c_str(), otpNewPath0.c_str(), otpNewPath1.c_str(), srcCpPath.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eFailure;
+				}
+				if(! cmpFile(os, srcPath, content))  return eFailure;
+			}
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect shares to be written to, and read from, "fd:N" paths. */
+	utest::ResultType test_fd_paths(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		#ifdef __unix__
+			std::string content;
+			for(unsigned i=0; i < 10000; ++i) {
+				content += std::to_string(i * 3) + message; }
+			try {
+				if(! mkFile(os, srcPath, content))  return eNeutral;
+				{ // Multiplex into two file descriptors
+					int fd0 = ::open(otpDstPath0.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+					int fd1 = ::open(otpDstPath1.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+					if((fd0 < 0) || (fd1 < 0))  return eNeutral;
+					std::string fdArg0 = "fd:" + std::to_string(fd0);
+					std::string fdArg1 = "fd:" + std::to_string(fd1);
+					std::array<const char*, 6> argv = { "xor", "mux", "-c", srcPath.c_str(), fdArg0.c_str(), fdArg1.c_str() };
+					if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+						return eFailure;
+					}
+				} { // Demultiplex from a file descriptor and a file into a file descriptor
+					std::filesystem::remove(srcCpPath);
+					int fdIn = ::open(otpDstPath0.c_str(), O_RDONLY);
+					int fdOut = ::open(srcCpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+					if((fdIn < 0) || (fdOut < 0))  return eNeutral;
+					std::string fdArgIn = "fd:" + std::to_string(fdIn);
+					std::string fdArgOut = "fd:" + std::to_string(fdOut);
+					std::array<const char*, 6> argv = { "xor", "dmx", "-c", fdArgOut.c_str(), fdArgIn.c_str(), otpDstPath1.c_str() };
+					if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+						return eFailure;
+					}
+					if(! cmpFiles(os, srcPath, srcCpPath))  return eFailure;
+				}
+			} catch(std::exception& ex) {
+				os << "Exception: " << ex.what() << std::endl;
+				return eFailure;
+			}
+			return eSuccess;
+		#else
+			(void) os;
+			return eNeutral;
+		#endif
+	}
+
+
+	/** Expect an input descriptor that fails to be read (a directory) to
+	 * fail the operation, instead of being taken for an empty input. */
+	utest::ResultType test_fd_read_error(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		#ifdef __unix__
+			try {
+				if(! mkFile(os, srcPath, message))  return eNeutral;
+				std::array<const char*, 6> muxArgv = { "xor", "mux", "-c", srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(muxArgv.size(), muxArgv.data())))  return eNeutral;
+			} catch(std::exception& ex) {
+				os << "Exception: " << ex.what() << std::endl;
+				return eNeutral;
+			}
+			auto expectReadError = [&](const char* cmd, const std::string& in, const std::string& out0, const std::string& out1) {
+				int fd = ::open(".", O_RDONLY | O_DIRECTORY);
+				if(fd < 0)  return eNeutral;
+				std::string fdArg = "fd:" + std::to_string(fd);
+				auto replace = [&](const std::string& path) { return (path == "-")? fdArg.c_str() : path.c_str(); };
+				std::array<const char*, 6> argv = { "xor", cmd, "-c", replace(in), replace(out0), replace(out1) };
+				bool thrown = false;
+				try {
+					xorinator::runtime::run(CommandLine(argv.size(), argv.data()));
+				} catch(std::exception&) {
+					thrown = true;
+				}
+				::close(fd);
+				if(! thrown) {
+					os << expectedExceptionMsg << " (" << cmd << ')' << std::endl;
+					return eFailure;
+				}
+				return eSuccess;
+			};
+			if(expectReadError("mux", "-", otpNewPath0, otpNewPath1) != eSuccess)  return eFailure;
+			if(expectReadError("dmx", srcCpPath, otpDstPath0, "-") != eSuccess)  return eFailure;
+			return eSuccess;
+		#else
+			(void) os;
+			return eNeutral;
+		#endif
+	}
+
+
+	/** Expect a file to be multiplexed and demultiplexed with a
+	 * "--durability" mode, ending up with an exact copy of itself. */
+	template<xorinator::cli::Durability durability>
+	utest::ResultType test_durability(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		using xorinator::cli::Durability;
+		const char* durabilityArg = (durability == Durability::eEnd)? "--durability=end" : "--durability=periodic";
+		std::string content;
+		for(unsigned i=0; i < 20000; ++i) {
+			content += std::to_string(i * 5) + message; }
+		try {
+			if(! mkFile(os, srcPath, content))  return eNeutral;
+			std::array<const char*, 6> muxArgv = { "xor", "mux", durabilityArg, srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+			std::array<const char*, 6> demuxArgv = { "xor", "dmx", durabilityArg, srcCpPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+			if(! xorinator::runtime::run(CommandLine(muxArgv.size(), muxArgv.data()))) {
+				return eFailure; }
+			if(! xorinator::runtime::run(CommandLine(demuxArgv.size(), demuxArgv.data()))) {
+				return eFailure; }
+			if(! cmpFiles(os, srcPath, srcCpPath))  return eFailure;
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect interrupted operations to resume from the last checkpoint
+	 * of their journals, keeping what was written before it. */
+	utest::ResultType test_resume(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		namespace checkpoint = xorinator::checkpoint;
+		#ifdef __unix__
+			constexpr uint64_t offset = 50000;
+			std::string content;
+			for(unsigned i=0; i < 20000; ++i) {
+				content += std::to_string(i * 3) + message; }
+			const std::string nogenArg = "-G" + otpNewPath1;
+			auto commitJournal = [](const std::string& path, const CommandLine& cmdln, std::vector<uint64_t> offsets) {
+				auto journal = checkpoint::Journal(checkpoint::journalPath(path), checkpoint::operationFingerprint(cmdln), offsets.size());
+				journal.commit(offsets);
+			};
+			try {
+				if(! mkFile(os, srcPath, content))  return eNeutral;
+				if(! mkFile(os, otpNewPath1, std::string(content.rbegin(), content.rend()) + message))  return eNeutral;
+				std::filesystem::remove(checkpoint::journalPath(otpDstPath0));
+				std::filesystem::remove(checkpoint::journalPath(srcCpPath));
+				std::array<const char*, 8> muxArgv = { "xor", "mux", "--resume", "-kabc", nogenArg.c_str(), srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+				std::array<const char*, 8> demuxArgv = { "xor", "dmx", "--resume", "-kabc", srcCpPath.c_str(), otpNewPath1.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+				auto muxCmdln = CommandLine(muxArgv.size(), muxArgv.data());
+				auto demuxCmdln = CommandLine(demuxArgv.size(), demuxArgv.data());
+				{ // Multiplex, then resume multiplexing from the middle of the shares
+					if(! xorinator::runtime::run(muxCmdln))  return eFailure;
+					if(std::filesystem::exists(checkpoint::journalPath(otpDstPath0))) {
+						os << "The journal of a complete operation was not removed" << std::endl;
+						return eFailure;
+					}
+					std::filesystem::resize_file(otpDstPath0, offset);
+					std::filesystem::resize_file(otpDstPath1, offset);
+					commitJournal(otpDstPath0, muxCmdln, { offset, offset });
+					if(! xorinator::runtime::run(muxCmdln))  return eFailure;
+					if(! xorinator::runtime::run(demuxCmdln))  return eFailure;
+					if(! cmpFiles(os, srcPath, srcCpPath))  return eFailure;
+				} { // Resume demultiplexing: the data before the checkpoint must be kept
+					std::string expected = std::string(offset, 'A') + content.substr(offset);
+					if(! mkFile(os, srcCpPath, std::string(offset, 'A') + std::string(100, 'B')))  return eNeutral;
+					commitJournal(srcCpPath, demuxCmdln, { offset });
+					if(! xorinator::runtime::run(demuxCmdln))  return eFailure;
+					if(! cmpFile(os, srcCpPath, expected))  return eFailure;
+				} { // Refuse to resume with the journal of another operation
+					commitJournal(srcCpPath, muxCmdln, { offset });
+					try {
+						xorinator::runtime::run(demuxCmdln);
+						os << "Resumed with the journal of another operation" << std::endl;
+						return eFailure;
+					} catch(checkpoint::JournalException&) { }
+					std::filesystem::remove(checkpoint::journalPath(srcCpPath));
+				}
+			} catch(std::exception& ex) {
+				os << "Exception: " << ex.what() << std::endl;
+				return eFailure;
+			}
+			return eSuccess;
+		#else
+			return eNeutral;
+		#endif
+	}
+
+
+	/** Expect a growing file to be multiplexed one tail at a time,
+	 * without rewriting what the shares already hold. */
+	utest::ResultType test_append(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		std::string content;
+		for(unsigned i=0; i < 3000; ++i) {
+			content += std::to_string(i * 11) + message; }
+		const size_t firstPart = content.size() / 3;
+		std::array<const char*, 7> muxArgv = { "xor", "mux", "--append", "-kabc", srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+		std::array<const char*, 6> demuxArgv = { "xor", "dmx", "-kabc", srcCpPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+		auto readFile = [](const std::string& path) {
+			auto file = std::ifstream(path, std::ios_base::binary);
+			return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		};
+		try {
+			std::filesystem::remove(otpDstPath0);
+			std::filesystem::remove(otpDstPath1);
+			if(! mkFile(os, srcPath, content.substr(0, firstPart)))  return eNeutral;
+			if(! xorinator::runtime::run(CommandLine(muxArgv.size(), muxArgv.data())))  return eFailure;
+			const auto prefix0 = readFile(otpDstPath0);
+			const auto prefix1 = readFile(otpDstPath1);
+			for(size_t end : { (2 * firstPart), content.size(), content.size() }) {
+				if(! mkFile(os, srcPath, content.substr(0, end)))  return eNeutral;
+				if(! xorinator::runtime::run(CommandLine(muxArgv.size(), muxArgv.data())))  return eFailure;
+				if(! xorinator::runtime::run(CommandLine(demuxArgv.size(), demuxArgv.data())))  return eFailure;
+				if(! cmpFiles(os, srcPath, srcCpPath))  return eFailure;
+			}
+			if((readFile(otpDstPath0).compare(0, firstPart, prefix0) != 0) || (readFile(otpDstPath1).compare(0, firstPart, prefix1) != 0)) {
+				os << "The existing part of the shares was rewritten" << std::endl;
+				return eFailure;
+			}
+			{ // Refuse to append to shares of different lengths
+				std::filesystem::resize_file(otpDstPath1, firstPart);
+				try {
+					xorinator::runtime::run(CommandLine(muxArgv.size(), muxArgv.data()));
+					os << "Appended to shares of different lengths" << std::endl;
+					return eFailure;
+				} catch(std::runtime_error&) { }
+			} { // Refuse to append to shares longer than the source
+				if(! mkFile(os, srcPath, content.substr(0, firstPart / 2)))  return eNeutral;
+				std::filesystem::resize_file(otpDstPath0, firstPart);
+				try {
+					xorinator::runtime::run(CommandLine(muxArgv.size(), muxArgv.data()));
+					os << "Appended to shares longer than their source" << std::endl;
+					return eFailure;
+				} catch(std::runtime_error&) { }
+			}
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect "--delta" to only rewrite the changed blocks of the first
+	 * share, and the other shares where the source grew, and to refuse
+	 * shares that no longer match its block index. */
+	utest::ResultType test_delta(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		constexpr size_t blockSize = xorinator::delta::DEFAULT_BLOCK_SIZE;
+		std::string content;
+		for(unsigned i=0; i < 40000; ++i) {
+			content += std::to_string(i * 7) + message; }
+		std::array<const char*, 8> muxArgv = { "xor", "mux", "-q", "--delta", deltaIndexPath.c_str(), srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+		std::array<const char*, 5> demuxArgv = { "xor", "dmx", srcCpPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+		auto readFile = [](const std::string& path) {
+			auto file = std::ifstream(path, std::ios_base::binary);
+			return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		};
+		auto muxAndCheck = [&]() {
+			return
+				xorinator::runtime::run(CommandLine(muxArgv.size(), muxArgv.data())) &&
+				xorinator::runtime::run(CommandLine(demuxArgv.size(), demuxArgv.data())) &&
+				cmpFiles(os, srcPath, srcCpPath);
+		};
+		try {
+			std::filesystem::remove(deltaIndexPath);
+			if(! mkFile(os, srcPath, content))  return eNeutral;
+			if(! muxAndCheck())  return eFailure;
+			const auto share0 = readFile(otpDstPath0);
+			const auto share1 = readFile(otpDstPath1);
+			// Change one byte of the third block, and grow the source
+			content[(2 * blockSize) + 10] ^= 1;
+			content += content.substr(0, blockSize / 2);
+			if(! mkFile(os, srcPath, content))  return eNeutral;
+			if(! muxAndCheck())  return eFailure;
+			const auto patched0 = readFile(otpDstPath0);
+			if(readFile(otpDstPath1).compare(0, share1.size(), share1) != 0) {
+				os << "The second share was rewritten" << std::endl;
+				return eFailure;
+			}
+			for(size_t b=0; b * blockSize < share0.size(); ++b) {
+				const size_t len = std::min(blockSize, share0.size() - (b * blockSize));
+				const bool changed = patched0.compare(b * blockSize, len, share0, b * blockSize, len) != 0;
+				if(changed != (b == 2)) {
+					os << "Unexpected " << (changed? "rewritten" : "unchanged") << " block " << b << " of the first share" << std::endl;
+					return eFailure;
+				}
+			}
+			// Shrink the source
+			content.resize(content.size() / 3);
+			if(! mkFile(os, srcPath, content))  return eNeutral;
+			if(! muxAndCheck())  return eFailure;
+			if(readFile(otpDstPath1) != share1.substr(0, content.size())) {
+				os << "The second share was rewritten while shrinking" << std::endl;
+				return eFailure;
+			}
+			// Shares multiplexed again without "--delta" no longer match the index
+			const auto indexed = content;
+			content[10] ^= 1;
+			if(! mkFile(os, srcPath, content))  return eNeutral;
+			std::array<const char*, 6> plainArgv = { "xor", "mux", "-q", srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+			if(! xorinator::runtime::run(CommandLine(plainArgv.size(), plainArgv.data())))  return eFailure;
+			if(! mkFile(os, srcPath, indexed))  return eNeutral;
+			const auto stale0 = readFile(otpDstPath0);
+			try {
+				xorinator::runtime::run(CommandLine(muxArgv.size(), muxArgv.data()));
+				os << expectedExceptionMsg << " (stale block index)" << std::endl;
+				return eFailure;
+			} catch(std::runtime_error&) { }
+			if(readFile(otpDstPath0) != stale0) {
+				os << "A share was patched against a stale block index" << std::endl;
+				return eFailure;
+			}
+			// A missing index multiplexes every share again
+			std::filesystem::remove(deltaIndexPath);
+			if(! muxAndCheck())  return eFailure;
+			if(readFile(otpDstPath1) == share1.substr(0, content.size())) {
+				os << "The second share was kept without a block index" << std::endl;
+				return eFailure;
+			}
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect operations sent to "xor serve" to behave like local ones,
+	 * and their errors to be reported to the client. */
+	utest::ResultType test_serve(std::ostream& os) {
+		#ifdef __unix__
+			using xorinator::cli::CommandLine;
+			std::string content;
+			for(unsigned i=0; i < 2000; ++i) {
+				content += std::to_string(i * 13) + message; }
+			std::filesystem::remove(socketPath);
+			pid_t server = ::fork();
+			if(server < 0)  return eNeutral;
+			if(server == 0) {
+				std::array<const char*, 5> serveArgv = { "xor", "serve", "-q", "--socket", socketPath.c_str() };
+				try {
+					xorinator::runtime::run(CommandLine(serveArgv.size(), serveArgv.data()));
+				} catch(...) { }
+				::_exit(EXIT_FAILURE);
+			}
+			auto stopServer = [&]() {
+				::kill(server, SIGTERM);
+				::waitpid(server, nullptr, 0);
+			};
+			for(unsigned i=0; (i < 500) && ! std::filesystem::exists(socketPath); ++i) {
+				::usleep(10000); }
+
+			std::array<const char*, 7> muxArgv = { "xor", "mux", "--socket", socketPath.c_str(), srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+			std::array<const char*, 7> demuxArgv = { "xor", "dmx", "--socket", socketPath.c_str(), srcCpPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+			std::array<const char*, 10> badArgv = { "xor", "mux", "-q", "-c", "-t5", "--socket", socketPath.c_str(), srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+			std::array<const char*, 8> warnArgv = { "xor", "mux", "-k1234", "--socket", socketPath.c_str(), srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+			const std::string missingSocketPath = socketPath + ".missing";
+			std::array<const char*, 7> missingArgv = { "xor", "mux", "--socket", missingSocketPath.c_str(), srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+			try {
+				if(! mkFile(os, srcPath, content)) {
+					stopServer();
+					return eNeutral;
+				}
+				for(unsigned i=0; i < 3; ++i) {
+					std::filesystem::remove(srcCpPath);
+					if(xorinator::server::runRemote(CommandLine(muxArgv.size(), muxArgv.data()), muxArgv.size(), muxArgv.data()) != EXIT_SUCCESS) {
+						os << "Remote mux failed" << std::endl;
+						stopServer();
+						return eFailure;
+					}
+					if(xorinator::server::runRemote(CommandLine(demuxArgv.size(), demuxArgv.data()), demuxArgv.size(), demuxArgv.data()) != EXIT_SUCCESS) {
+						os << "Remote demux failed" << std::endl;
+						stopServer();
+						return eFailure;
+					}
+					if(! cmpFiles(os, srcPath, srcCpPath)) {
+						stopServer();
+						return eFailure;
+					}
+				}
+				if(xorinator::server::runRemote(CommandLine(badArgv.size(), badArgv.data()), badArgv.size(), badArgv.data()) == EXIT_SUCCESS) {
+					os << "An invalid remote operation succeeded" << std::endl;
+					stopServer();
+					return eFailure;
+				}
+				{ // The warnings of an operation are sent back to the client, which prints them
+					auto warnings = std::ostringstream();
+					auto* stderrBuf = std::cerr.rdbuf(warnings.rdbuf());
+					int status;
+					try {
+						status = xorinator::server::runRemote(CommandLine(warnArgv.size(), warnArgv.data()), warnArgv.size(), warnArgv.data());
+					} catch(...) {
+						std::cerr.rdbuf(stderrBuf);
+						throw;
+					}
+					std::cerr.rdbuf(stderrBuf);
+					if(status != EXIT_SUCCESS) {
+						os << "Remote mux with a key failed" << std::endl;
+						stopServer();
+						return eFailure;
+					}
+					if(warnings.str().find("Warning: ") == std::string::npos) {
+						os << "The client didn't get the warnings of its operation" << std::endl;
+						stopServer();
+						return eFailure;
+					}
+				}
+				{ // Outputs are left alone if the server can't be reached
+					if(! mkFile(os, otpDstPath0, message)) {
+						stopServer();
+						return eNeutral;
+					}
+					try {
+						xorinator::server::runRemote(CommandLine(missingArgv.size(), missingArgv.data()), missingArgv.size(), missingArgv.data());
+						os << expectedExceptionMsg << " (missing server)" << std::endl;
+						stopServer();
+						return eFailure;
+					} catch(xorinator::server::ServerException&) { }
+					if(! cmpFile(os, otpDstPath0, message)) {
+						os << "An output was truncated while the server was missing" << std::endl;
+						stopServer();
+						return eFailure;
+					}
+				}
+			} catch(std::exception& ex) {
+				os << "Exception: " << ex.what() << std::endl;
+				stopServer();
+				return eFailure;
+			}
+			stopServer();
+			return eSuccess;
+		#else
+			(void) os;
+			return eNeutral;
+		#endif
+	}
+
+
+	/** Expect a torn commit to leave the previous one intact. */
+	utest::ResultType test_checkpoint_journal(std::ostream& os) {
+		namespace checkpoint = xorinator::checkpoint;
+		#ifdef __unix__
+			const auto journalPath = checkpoint::journalPath(srcCpPath);
+			const auto fingerprint = checkpoint::Fingerprint { 1, 2, 3 };
+			try {
+				std::filesystem::remove(journalPath);
+				{
+					auto journal = checkpoint::Journal(journalPath, fingerprint, 2);
+					journal.commit({ 10, 11 });
+					journal.commit({ 20, 21 });
+				} { // Corrupt the last commit, in the first slot after the 48-byte header
+					auto file = std::fstream(journalPath, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+					file.seekp(48 + 8);
+					file.put('\xff');
+				} {
+					auto journal = checkpoint::Journal(journalPath, fingerprint, 2);
+					if(journal.offsets() != std::vector<uint64_t> { 10, 11 }) {
+						os << "Unexpected offsets after a torn commit: " << journal.offsets()[0] << ", " << journal.offsets()[1] << std::endl;
+						return eFailure;
+					}
+					journal.commit({ 30, 31 });
+				} {
+					auto journal = checkpoint::Journal(journalPath, fingerprint, 2);
+					if(journal.offsets() != std::vector<uint64_t> { 30, 31 }) {
+						os << "Unexpected offsets after a commit: " << journal.offsets()[0] << ", " << journal.offsets()[1] << std::endl;
+						return eFailure;
+					}
+					journal.remove();
+				}
+			} catch(std::exception& ex) {
+				os << "Exception: " << ex.what() << std::endl;
+				return eFailure;
+			}
+			return eSuccess;
+		#else
+			return eNeutral;
+		#endif
+	}
+
+
+	/** Expect existing outputs to be truncated through the descriptor
+	 * that was checked, and a read-only output to stop the operation
+	 * before any file is written. */
+	utest::ResultType test_checked_outputs(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		#ifdef __unix__
+			std::string content;
+			for(unsigned i=0; i < 10000; ++i) {
+				content += std::to_string(i * 7) + message; }
+			const std::string stale = std::string(content.size() * 2, 'x');
+			try {
+				if(! mkFile(os, srcPath, content))  return eNeutral;
+				{ // Multiplex into longer existing files, then demultiplex
+					if(! (mkFile(os, otpDstPath0, stale) && mkFile(os, otpDstPath1, stale) && mkFile(os, srcCpPath, stale)))  return eNeutral;
+					std::array<const char*, 5> muxArgv = { "xor", "mux", srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+					std::array<const char*, 5> demuxArgv = { "xor", "dmx", srcCpPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+					if(! xorinator::runtime::run(CommandLine(muxArgv.size(), muxArgv.data()))) {
+						return eFailure; }
+					if(! xorinator::runtime::run(CommandLine(demuxArgv.size(), demuxArgv.data()))) {
+						return eFailure; }
+					if(! cmpFiles(os, srcPath, srcCpPath))  return eFailure;
+				} { // Multiplex into a read-only share
+					namespace fs = std::filesystem;
+					if(! (mkFile(os, otpDstPath0, stale) && mkFile(os, otpDstPath1, stale)))  return eNeutral;
+					fs::permissions(otpDstPath1, fs::perms::owner_read);
+					bool thrown = false;
+					try {
+						std::array<const char*, 5> argv = { "xor", "mux", srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+						xorinator::runtime::run(CommandLine(argv.size(), argv.data()));
+					} catch(xorinator::runtime::FilePermissionException&) {
+						thrown = true;
+					}
+					fs::permissions(otpDstPath1, fs::perms::owner_read | fs::perms::owner_write);
+					if(! thrown) {
+						os << expectedExceptionMsg << std::endl;
+						return eFailure;
+					}
+					if(! cmpFile(os, otpDstPath0, stale)) {
+						os << "The writable share was modified" << std::endl;
+						return eFailure;
+					}
+				}
+			} catch(std::exception& ex) {
+				os << "Exception: " << ex.what() << std::endl;
+				return eFailure;
+			}
+			return eSuccess;
+		#else
+			(void) os;
+			return eNeutral;
+		#endif
+	}
+
+
+	/** Expect a file to be multiplexed into share containers, then
+	 * demultiplexed, ending up with an exact copy of itself; the source is
+	 * longer than several chunks, so that they are split across workers. */
+	template<bool nogen>
+	utest::ResultType test_mux_demux_container(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		std::string content;
+		for(unsigned i=0; i < (nogen? 40 : 1000); ++i) { // The nogen file is smaller than 1000 lines
+			content += std::to_string(i * i) + message; }
+		try {
+			{ // Create the file
+				if(! mkFile(os, srcPath, content))  return eNeutral;
+			} { // Run the multiplex subcommand
+				const std::string& firstOtp = (nogen? ("-G"+otpNoGenPath) : otpDstPath0);
+				std::array<const char*, 9> argv = { "xor", "mux", "-c", "--chunk-size=100", "-g", "3000", srcPath.c_str(), firstOtp.c_str(), otpDstPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eFailure;
+				}
+			} { // Run the demultiplex subcommand
+				const std::string& firstOtp = (nogen? ("-G"+otpNoGenPath) : otpDstPath0);
+				std::array<const char*, 7> argv = { "xor", "dmx", "--container", "-j3", srcCpPath.c_str(), firstOtp.c_str(), otpDstPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eFailure;
+				}
+			} { // Compare the files
+				if(! cmpFiles(os, srcPath, srcCpPath))  return eFailure;
+			}
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect demultiplexing an incomplete set of share containers to fail. */
+	utest::ResultType test_demux_container_incomplete(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		try {
+			{ // Create the file and its shares
+				if(! mkFile(os, srcPath, message))  return eNeutral;
+				std::array<const char*, 7> argv = { "xor", "mux", "-c", srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str(), srcCpPath.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eNeutral;
+				}
+			} { // Run the demultiplex subcommand with one share missing
+				std::array<const char*, 6> argv = { "xor", "dmx", "-cq", srcCpPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+				xorinator::runtime::run(CommandLine(argv.size(), argv.data()));
+			}
+		} catch(xorinator::container::ContainerFormatException&) {
+			return eSuccess;
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		os << expectedExceptionMsg << std::endl;
+		return eFailure;
+	}
+
+
+	/** Expect a share container with a malformed chunk, or with an
+	 * oversized chunk size, to fail demultiplexing rather than end it
+	 * early; also when it is read from a pipe, with no known length. */
+	utest::ResultType test_demux_container_corrupt(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		constexpr size_t chunkSize = 100;
+		std::string content;
+		for(unsigned i=0; i < 200; ++i) {
+			content += std::to_string(i) + message; }
+		std::string share;
+		try {
+			if(! mkFile(os, srcPath, content))  return eNeutral;
+			std::array<const char*, 7> argv = { "xor", "mux", "-c", "--chunk-size=100", srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+			if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data())))  return eNeutral;
+			auto file = std::ifstream(otpDstPath1, std::ios_base::binary);
+			share.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eNeutral;
+		}
+		auto expectFormatError = [&](const std::string& corrupt, bool piped, const char* what) {
+			if(! mkFile(os, otpNewPath1, corrupt))  return eNeutral;
+			std::string input = otpNewPath1;
+			#ifdef __unix__
+				int pipeFds[2] = { -1, -1 };
+				if(piped) {
+					if((0 != ::pipe(pipeFds)) || (::write(pipeFds[1], corrupt.data(), corrupt.size()) != ssize_t(corrupt.size())))  return eNeutral;
+					::close(pipeFds[1]);
+					input = "fd:" + std::to_string(pipeFds[0]);
+				}
+			#else
+				if(piped)  return eNeutral;
+			#endif
+			std::array<const char*, 6> argv = { "xor", "dmx", "-c", srcCpPath.c_str(), otpDstPath0.c_str(), input.c_str() };
+			auto r = eFailure;
+			try {
+				xorinator::runtime::run(CommandLine(argv.size(), argv.data()));
+				os << expectedExceptionMsg << " (" << what << ')' << std::endl;
+			} catch(xorinator::container::ContainerFormatException&) {
+				r = eSuccess;
+			} catch(std::exception& ex) {
+				os << "Unexpected exception (" << what << "): " << ex.what() << std::endl;
+			}
+			#ifdef __unix__
+				if(piped)  ::close(pipeFds[0]);
+			#endif
+			return r;
+		};
+		auto misnumbered = share;
+		misnumbered[xorinator::container::ShareHeader::SIZE + (3 * (xorinator::container::ChunkHeader::SIZE + chunkSize))] ^= 0x40;
+		auto oversized = share;
+		std::fill_n(oversized.begin() + 12, 4, '\xff');
+		if(expectFormatError(misnumbered, false, "misnumbered chunk") != eSuccess)  return eFailure;
+		if(expectFormatError(misnumbered, true, "misnumbered chunk, piped") != eSuccess)  return eFailure;
+		if(expectFormatError(oversized, false, "oversized chunks") != eSuccess)  return eFailure;
+		return eSuccess;
+	}
+
+
+	/** Expect freshly multiplexed shares to pass an integrity check,
+	 * a corrupted one to fail it, and "--index" to be refused when
+	 * demultiplexing. */
+	utest::ResultType test_verify_index(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		try {
+			{ // Create the file and its shares
+				if(! mkFile(os, srcPath, std::string(100000, 'x') + message))  return eNeutral;
+				std::array<const char*, 6> argv = { "xor", "mux", "--index", srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eNeutral;
+				}
+			} { // Verify the intact shares
+				std::array<const char*, 5> argv = { "xor", "verify", "-qi", otpDstPath0.c_str(), otpDstPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					os << "Intact shares reported as corrupted" << std::endl;
+					return eFailure;
+				}
+			} { // Corrupt a share, then verify it again
+				auto share = std::fstream(otpDstPath1, std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+				share.seekg(70000);
+				char c = share.peek();
+				share.seekp(70000);
+				share.put(char(c ^ 1));
+			} {
+				std::array<const char*, 4> argv = { "xor", "verify", "-qi", otpDstPath1.c_str() };
+				if(xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					os << "Corrupted share reported as intact" << std::endl;
+					return eFailure;
+				}
+	} { // Demultiplexing doesn't check the indices, so it refuses the option
+				std::array<const char*, 6> argv = { "xor", "dmx", "-qi", srcCpPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+				try {
+					xorinator::runtime::run(CommandLine(argv.size(), argv.data()));
+					os << expectedExceptionMsg << " (demultiplexing with \"--index\")" << std::endl;
+					return eFailure;
+				} catch(xorinator::cli::InvalidCommandLineException&) { }
+			}
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect a set of shares to be verified against the original file
+	 * and against its hash, and a modified original to be rejected. */
+	utest::ResultType test_verify_original(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		using xorinator::Sha256;
+		const std::string content = std::string(3000000, 'y') + message;
+		try {
+			{ // Create the file and its shares
+				if(! mkFile(os, srcPath, content))  return eNeutral;
+				std::array<const char*, 8> argv = { "xor", "mux", "-kabc", "-g", "100", srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eNeutral;
+				}
+			} { // Verify against the original
+				std::array<const char*, 7> argv = { "xor", "verify", "-q", "-kabc", srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					os << "Shares reported as not matching the original" << std::endl;
+					return eFailure;
+				}
+			} { // Verify against the hash of the original
+				Sha256 hash;
+				hash.update(content.data(), content.size());
+				std::string hashArg = "sha256:" + Sha256::toHex(hash.finish());
+				std::array<const char*, 7> argv = { "xor", "verify", "-q", "-kabc", hashArg.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					os << "Shares reported as not matching the hash of the original" << std::endl;
+					return eFailure;
+				}
+			} { // Modify the original, then verify it again
+				if(! mkFile(os, srcPath, content.substr(0, 2000000) + 'z' + content.substr(2000001)))  return eNeutral;
+				std::array<const char*, 7> argv = { "xor", "verify", "-q", "-kabc", srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+				if(xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					os << "Shares reported as matching a modified original" << std::endl;
+					return eFailure;
+				}
+			} { // Verify without the key
+				if(! mkFile(os, srcPath, content))  return eNeutral;
+				std::array<const char*, 6> argv = { "xor", "verify", "-q", srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+				if(xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					os << "Shares reported as matching without their key" << std::endl;
+					return eFailure;
+				}
+			}
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect a set of shares to be replaced by a fresh one, which
+	 * demultiplexes into the same file; with share containers, mixing
+	 * old and new shares must fail, and so must resharing part of a set. */
+	template<bool container>
+	utest::ResultType test_reshare(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		const char* containerOpt = container? "-c" : "-q";
+		std::string content;
+		for(unsigned i=0; i < 1000; ++i) {
+			content += std::to_string(i * 7) + message; }
+		try {
+			{ // Create the file and its shares
+				if(! mkFile(os, srcPath, content))  return eNeutral;
+				std::array<const char*, 8> argv = { "xor", "mux", "-kabc", containerOpt, "-g100", srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eNeutral;
+				}
+			} { // Run the reshare subcommand
+				std::array<const char*, 7> argv = { "xor", "reshare", containerOpt, otpDstPath0.c_str(), otpDstPath1.c_str(), otpNewPath0.c_str(), otpNewPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eFailure;
+				}
+			} { // Demultiplex the new shares
+				std::array<const char*, 7> argv = { "xor", "dmx", "-kabc", containerOpt, srcCpPath.c_str(), otpNewPath0.c_str(), otpNewPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eFailure;
+				}
+				if(! cmpFiles(os, srcPath, srcCpPath))  return eFailure;
+			} { // The new shares must not be copies of the old ones
+				auto readAll = [](const std::string& path) {
+					auto file = std::ifstream(path, std::ios_base::binary);
+					return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+				};
+				if(readAll(otpDstPath0) == readAll(otpNewPath0)) {
+					os << "The reshared file is identical to the original share" << std::endl;
+					return eFailure;
+				}
+			}
+			if constexpr(container) {
+				std::array<const char*, 7> argv = { "xor", "dmx", "-kabc", containerOpt, srcCpPath.c_str(), otpDstPath0.c_str(), otpNewPath1.c_str() };
+				try {
+					xorinator::runtime::run(CommandLine(argv.size(), argv.data()));
+					os << "Old and new shares were mixed" << std::endl;
+					return eFailure;
+				} catch(xorinator::container::ContainerFormatException&) { }
+				// Part of a set can't be reshared, since its new shares would be mixed with the rest
+				std::array<const char*, 8> muxArgv = { "xor", "mux", "-kabc", containerOpt, srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str(), otpDstPath2.c_str() };
+				std::array<const char*, 7> partialArgv = { "xor", "reshare", containerOpt, otpDstPath0.c_str(), otpDstPath1.c_str(), otpNewPath0.c_str(), otpNewPath1.c_str() };
+				std::array<const char*, 8> mixArgv = { "xor", "dmx", "-kabc", containerOpt, srcCpPath.c_str(), otpNewPath0.c_str(), otpDstPath1.c_str(), otpDstPath2.c_str() };
+				if(! xorinator::runtime::run(CommandLine(muxArgv.size(), muxArgv.data())))  return eNeutral;
+				try {
+					xorinator::runtime::run(CommandLine(partialArgv.size(), partialArgv.data()));
+					os << "Part of a set was reshared" << std::endl;
+					return eFailure;
+				} catch(xorinator::container::ContainerFormatException&) { }
+				try {
+					xorinator::runtime::run(CommandLine(mixArgv.size(), mixArgv.data()));
+					os << "A partially reshared share was mixed with the old ones" << std::endl;
+					return eFailure;
+				} catch(xorinator::container::ContainerFormatException&) { }
+			}
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect a share to be split into two, which replace it when
+	 * demultiplexing; with share containers, combining the old share
+	 * with only one of the new ones must fail. */
+	template<bool container>
+	utest::ResultType test_split_share(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		const char* containerOpt = container? "-c" : "-q";
+		std::string content;
+		for(unsigned i=0; i < 1000; ++i) {
+			content += std::to_string(i * 11) + message; }
+		try {
+			{ // Create the file and its shares
+				if(! mkFile(os, srcPath, content))  return eNeutral;
+				std::array<const char*, 6> argv = { "xor", "mux", containerOpt, srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eNeutral;
+				}
+			} { // Split the second share
+				std::array<const char*, 6> argv = { "xor", "split-share", containerOpt, otpDstPath1.c_str(), otpNewPath0.c_str(), otpNewPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eFailure;
+				}
+			} { // Demultiplex the first share with the new ones
+				std::array<const char*, 7> argv = { "xor", "dmx", containerOpt, srcCpPath.c_str(), otpDstPath0.c_str(), otpNewPath0.c_str(), otpNewPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eFailure;
+				}
+				if(! cmpFiles(os, srcPath, srcCpPath))  return eFailure;
+			}
+			if constexpr(container) {
+				std::array<const char*, 7> argv = { "xor", "dmx", containerOpt, srcCpPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str(), otpNewPath1.c_str() };
+				try {
+					xorinator::runtime::run(CommandLine(argv.size(), argv.data()));
+					os << "The old share was combined with a split one" << std::endl;
+					return eFailure;
+				} catch(xorinator::container::ContainerFormatException&) { }
+			}
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect two shares of a set of share containers to be split, and
+	 * every combination of the old and new shares to either demultiplex
+	 * into the original file or be rejected: only the four combinations
+	 * that replace each split share with both of its halves (or with
+	 * none) are valid. */
+	utest::ResultType test_split_siblings(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		std::string content;
+		for(unsigned i=0; i < 1000; ++i) {
+			content += std::to_string(i * 19) + message; }
+		// s0, s1, s2, then the halves of s1 and s2
+		const std::array<std::string, 7> paths = {
+			otpDstPath0, otpDstPath1, otpDstPath2, otpNewPath0, otpNewPath1,
+			"deterministic-msg.3.new.xor", "deterministic-msg.4.new.xor" };
+		const std::array<unsigned, 4> validSets = { 0b0000111, 0b0011101, 0b1100011, 0b1111001 };
+		try {
+			{ // Create the file and its shares, then split the last two
+				if(! mkFile(os, srcPath, content))  return eNeutral;
+				std::array<const char*, 7> muxArgv = { "xor", "mux", "-c", srcPath.c_str(), paths[0].c_str(), paths[1].c_str(), paths[2].c_str() };
+				std::array<const char*, 6> split1Argv = { "xor", "split-share", "-c", paths[1].c_str(), paths[3].c_str(), paths[4].c_str() };
+				std::array<const char*, 6> split2Argv = { "xor", "split-share", "-c", paths[2].c_str(), paths[5].c_str(), paths[6].c_str() };
+				if(! xorinator::runtime::run(CommandLine(muxArgv.size(), muxArgv.data())))  return eNeutral;
+				if(! xorinator::runtime::run(CommandLine(split1Argv.size(), split1Argv.data())))  return eFailure;
+				if(! xorinator::runtime::run(CommandLine(split2Argv.size(), split2Argv.data())))  return eFailure;
+			}
+			for(unsigned set = 1; set < (1u << paths.size()); ++set) {
+				std::vector<const char*> argv = { "xor", "dmx", "-c", srcCpPath.c_str() };
+				for(unsigned i=0; i < paths.size(); ++i) {
+					if(set & (1u << i))  argv.push_back(paths[i].c_str()); }
+				const bool valid = std::find(validSets.begin(), validSets.end(), set) != validSets.end();
+				std::filesystem::remove(srcCpPath);
+				try {
+					if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+						os << "Demultiplexing the combination " << set << " failed" << std::endl;
+						return eFailure;
+					}
+				} catch(std::runtime_error& ex) { // A single share is rejected as a command line error
+					if(! valid)  continue;
+					os << "The valid combination " << set << " was rejected: " << ex.what() << std::endl;
+					return eFailure;
+				}
+				if(! valid) {
+					os << "The invalid combination " << set << " was demultiplexed" << std::endl;
+					return eFailure;
+				}
+				if(! cmpFiles(os, srcPath, srcCpPath))  return eFailure;
+			}
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect two shares of a set to be collapsed into one, which
+	 * replaces them when demultiplexing, a complete set of share
+	 * containers to be rejected, and raw shares to need "--raw". */
+	utest::ResultType test_collapse(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		std::string content;
+		for(unsigned i=0; i < 1000; ++i) {
+			content += std::to_string(i * 13) + message; }
+		try {
+			{ // Create the file and its shares
+				if(! mkFile(os, srcPath, content))  return eNeutral;
+				std::array<const char*, 8> argv = { "xor", "mux", "-c", "-g100", srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str(), otpNewPath0.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eNeutral;
+				}
+			} { // Collapse two of the shares
+				std::array<const char*, 6> argv = { "xor", "collapse", "-c", otpNewPath1.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eFailure;
+				}
+			} { // Demultiplex the collapsed share with the remaining one
+				std::array<const char*, 6> argv = { "xor", "dmx", "-c", srcCpPath.c_str(), otpNewPath1.c_str(), otpNewPath0.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eFailure;
+				}
+				if(! cmpFiles(os, srcPath, srcCpPath))  return eFailure;
+			} { // Collapse the complete set
+				std::array<const char*, 6> argv = { "xor", "collapse", "-c", srcCpPath.c_str(), otpNewPath1.c_str(), otpNewPath0.c_str() };
+				try {
+					xorinator::runtime::run(CommandLine(argv.size(), argv.data()));
+					os << "A complete set was collapsed" << std::endl;
+					return eFailure;
+				} catch(xorinator::container::ContainerFormatException&) { }
+			} { // Collapse two raw shares, which needs "--raw"
+				std::array<const char*, 6> muxArgv = { "xor", "mux", srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str(), otpNewPath0.c_str() };
+				std::array<const char*, 5> unconfirmedArgv = { "xor", "collapse", otpNewPath1.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+				std::array<const char*, 6> rawArgv = { "xor", "collapse", "--raw", otpNewPath1.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+				std::array<const char*, 5> demuxArgv = { "xor", "dmx", srcCpPath.c_str(), otpNewPath1.c_str(), otpNewPath0.c_str() };
+				if(! xorinator::runtime::run(CommandLine(muxArgv.size(), muxArgv.data())))  return eNeutral;
+				try {
+					xorinator::runtime::run(CommandLine(unconfirmedArgv.size(), unconfirmedArgv.data()));
+					os << "Raw shares were collapsed without \"--raw\"" << std::endl;
+					return eFailure;
+				} catch(xorinator::cli::InvalidCommandLineException&) { }
+				if(! xorinator::runtime::run(CommandLine(rawArgv.size(), rawArgv.data())))  return eFailure;
+				if(! xorinator::runtime::run(CommandLine(demuxArgv.size(), demuxArgv.data())))  return eFailure;
+				if(! cmpFiles(os, srcPath, srcCpPath))  return eFailure;
+			}
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect a 2-of-3 threshold set to be demultiplexed from any two
+	 * of its shares, and not from a single one. */
+	utest::ResultType test_threshold(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		std::string content;
+		for(unsigned i=0; i < 1000; ++i) {
+			content += std::to_string(i * 17) + message; }
+		try {
+			{ // Create the file and its shares
+				if(! mkFile(os, srcPath, content))  return eNeutral;
+				std::array<const char*, 9> argv = { "xor", "mux", "-c", "--threshold=2", "--chunk-size=1000", srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str(), otpNewPath0.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eFailure;
+				}
+			}
+			const auto pairs = std::array<std::array<const std::string*, 2>, 3> {
+				std::array<const std::string*, 2> { &otpDstPath0, &otpDstPath1 },
+				std::array<const std::string*, 2> { &otpNewPath0, &otpDstPath0 },
+				std::array<const std::string*, 2> { &otpDstPath1, &otpNewPath0 } };
+			for(const auto& pair : pairs) {
+				std::filesystem::remove(srcCpPath);
+				std::array<const char*, 6> argv = { "xor", "dmx", "-c", srcCpPath.c_str(), pair[0]->c_str(), pair[1]->c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eFailure;
+				}
+				if(! cmpFiles(os, srcPath, srcCpPath))  return eFailure;
+			}
+			{ // Demultiplex a single share
+				std::array<const char*, 5> argv = { "xor", "dmx", "-c", srcCpPath.c_str(), otpDstPath1.c_str() };
+				try {
+					xorinator::runtime::run(CommandLine(argv.size(), argv.data()));
+					os << "A single share of a 2-of-3 set was demultiplexed" << std::endl;
+					return eFailure;
+				} catch(xorinator::cli::InvalidCommandLineException&) { }
+			}
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect a threshold set with a truncated share to be rejected before
+	 * its output is written. */
+	utest::ResultType test_threshold_truncated(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		std::string content;
+		for(unsigned i=0; i < 1000; ++i) {
+			content += std::to_string(i * 13) + message; }
+		try {
+			{ // Create the file and its shares
+				if(! mkFile(os, srcPath, content))  return eNeutral;
+				std::array<const char*, 9> argv = { "xor", "mux", "-c", "--threshold=2", "--chunk-size=1000", srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str(), otpNewPath0.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eFailure;
+				}
+			}
+			std::filesystem::resize_file(otpDstPath1, std::filesystem::file_size(otpDstPath1) - 100);
+			std::filesystem::remove(srcCpPath);
+			std::array<const char*, 6> argv = { "xor", "dmx", "-c", srcCpPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+			try {
+				xorinator::runtime::run(CommandLine(argv.size(), argv.data()));
+				os << "A truncated share was demultiplexed" << std::endl;
+				return eFailure;
+			} catch(xorinator::container::ContainerFormatException&) { }
+			if(std::filesystem::exists(srcCpPath) && (std::filesystem::file_size(srcCpPath) != 0)) {
+				os << "The output was written before the truncated share was found" << std::endl;
+				return eFailure;
+			}
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect a compressible file to be multiplexed into shares smaller than
+	 * itself, then demultiplexed into an exact copy; share containers
+	 * must be decompressed without the "--compress" option. */
+	template<bool useContainer>
+	utest::ResultType test_compress(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		std::string content;
+		for(unsigned i=0; i < 20000; ++i) {
+			content += std::to_string(i % 100) + message; }
+		const char* containerArg = useContainer? "-c" : "--litter=64";
+		const char* dmxCompressArg = useContainer? "-q" : "-z";
+		try {
+			{ // Create the file and its shares
+				if(! mkFile(os, srcPath, content))  return eNeutral;
+				std::array<const char*, 7> argv = { "xor", "mux", "--compress", containerArg, srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eFailure;
+				}
+				if(std::filesystem::file_size(otpDstPath0) * 4 > content.size()) {
+					os << "The shares were not compressed" << std::endl;
+					return eFailure;
+				}
+			} { // Demultiplex the shares
+				std::filesystem::remove(srcCpPath);
+				std::array<const char*, 7> argv = { "xor", "dmx", dmxCompressArg, containerArg, srcCpPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eFailure;
+				}
+				if(! cmpFiles(os, srcPath, srcCpPath))  return eFailure;
+			}
+			if constexpr(useContainer) { // Verify the shares against the original
+				std::array<const char*, 6> argv = { "xor", "verify", "-c", srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eFailure;
+				}
+			}
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect multiplexing operations to take their pads from disjoint
+	 * regions of a pad reservoir, and to generate them once it is
+	 * exhausted. */
+	utest::ResultType test_reservoir(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		constexpr size_t reservoirSize = 30000;
+		std::string content;
+		for(unsigned i=0; i < 1000; ++i) {
+			content += std::to_string(i * 19) + message; }
+		try {
+			{ // Create the file and the reservoir
+				if(! mkFile(os, srcPath, content))  return eNeutral;
+				std::filesystem::remove(reservoirPath);
+				std::filesystem::remove(xorinator::reservoir::journalPath(reservoirPath));
+				std::array<const char*, 5> argv = { "xor", "fill-reservoir", "--size", "30000", reservoirPath.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eFailure;
+				}
+				if(std::filesystem::file_size(reservoirPath) != reservoirSize) {
+					os << "Wrong reservoir size" << std::endl;
+					return eFailure;
+				}
+			}
+			for(unsigned round=0; round < 3; ++round) {
+				{ // Multiplex the file, then check the remaining reservoir
+					std::array<const char*, 8> argv = { "xor", "mux", "-q", "--reservoir", reservoirPath.c_str(), srcPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+					if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+						return eFailure;
+					}
+					auto available = xorinator::reservoir::Reservoir(reservoirPath).available();
+					auto expected = (content.size() * (round+1) > reservoirSize)? 0 : reservoirSize - (content.size() * (round+1));
+					if(available != expected) {
+						os << "Round " << round << ": " << available << " bytes left in the reservoir, expected " << expected << std::endl;
+						return eFailure;
+					}
+				} { // Demultiplex the shares
+					std::filesystem::remove(srcCpPath);
+					std::array<const char*, 5> argv = { "xor", "dmx", srcCpPath.c_str(), otpDstPath0.c_str(), otpDstPath1.c_str() };
+					if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+						return eFailure;
+					}
+					if(! cmpFiles(os, srcPath, srcCpPath))  return eFailure;
+				}
+			}
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect the generate subcommand to write files of the given size,
+	 * with different and non-trivial content, replacing existing ones. */
+	utest::ResultType test_generate(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		constexpr size_t size = 3 * 1000 * 1000;
+		try {
+			{ // Generate two files, one of which exists already
+				if(! mkFile(os, otpDstPath0, std::string(2 * size, 'x')))  return eNeutral;
+				std::filesystem::remove(otpDstPath1);
+				std::array<const char*, 6> argv = { "xor", "gen", "-j3", "--size=3000000", otpDstPath0.c_str(), otpDstPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eFailure;
+				}
+			} { // Check them
+				std::string content[2];
+				for(unsigned i=0; const auto* path : { &otpDstPath0, &otpDstPath1 }) {
+					auto file = std::ifstream(*path, std::ios_base::binary);
+					content[i++] = std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+				}
+				for(const auto& c : content) {
+					if(c.size() != size) {
+						os << "Wrong size: " << c.size() << std::endl;
+						return eFailure;
+					}
+					size_t zeroes = std::count(c.begin(), c.end(), '\0');
+					if((zeroes < size / 512) || (zeroes > size / 128)) {
+						os << "Suspicious number of zero bytes: " << zeroes << std::endl;
+						return eFailure;
+					}
+				}
+				if(content[0] == content[1]) {
+					os << "The generated files are identical" << std::endl;
+					return eFailure;
+				}
+			}
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect a directory tree to be recursively multiplexed, then
+	 * demultiplexed, ending up with an exact copy of every file. */
+	utest::ResultType test_mux_demux_recursive(std::ostream& os) {
+		using xorinator::cli::CommandLine;
+		namespace fs = std::filesystem;
+		const auto relPaths = std::array<std::string, 4> {
+			"a.txt", "empty.txt", "sub/b.txt", "sub/deeper/c.txt" };
+		try {
+			{ // Create the tree
+				for(const auto& dir : { srcDirPath, srcCpDirPath, otpDstDirPath0, otpDstDirPath1 }) {
+					fs::remove_all(dir); }
+				fs::create_directories(fs::path(srcDirPath) / "sub/deeper");
+				for(size_t i=0; const auto& relPath : relPaths) {
+					std::string content = (i == 1)? "" : std::string(i * 1000, char('a' + i)) + message;
+					if(! mkFile(os, srcDirPath + '/' + relPath, content))  return eNeutral;
+					++i;
+				}
+			} { // Run the multiplex subcommand
+				std::array<const char*, 9> argv = { "xor", "mux", "-r", "-j2", "-k1234", "-c", srcDirPath.c_str(), otpDstDirPath0.c_str(), otpDstDirPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eFailure;
+				}
+			} { // Run the demultiplex subcommand
+				std::array<const char*, 8> argv = { "xor", "dmx", "--recursive", "-k1234", "-c", srcCpDirPath.c_str(), otpDstDirPath0.c_str(), otpDstDirPath1.c_str() };
+				if(! xorinator::runtime::run(CommandLine(argv.size(), argv.data()))) {
+					return eFailure;
+				}
+			} { // Compare the files
+				for(const auto& relPath : relPaths) {
+					if(! cmpFiles(os, srcDirPath + '/' + relPath, srcCpDirPath + '/' + relPath))  return eFailure; }
+			}
+		} catch(std::exception& ex) {
+			os << "Exception: " << ex.what() << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
 	/** Expect a demultiplexing operation to match a hardcoded result: this test
 	 * should fail if retrocompatibility is broken (even if multiplexing and
 	 * demultiplexing operations are literally just bitwise XOR operations). */
@@ -317,6 +1596,36 @@ int main(int, char**) {
 		.run("No output (demux)", test_no_pad<false>)
 		.run("Mux & demux", test_mux_demux<0, false>)
 		.run("Mux & demux (--litter=64)", test_mux_demux<64, false>)
-		.run("Mux & demux (nogen)", test_mux_demux<0, true>);
+		.run("Mux & demux (nogen)", test_mux_demux<0, true>)
+		.run("Mux & demux (5 shares, 2 generator threads)", test_mux_demux_workers)
+		.run("Mux & demux (container)", test_mux_demux_container<false>)
+		.run("Mux & demux (container, nogen)", test_mux_demux_container<true>)
+		.run("Demux with an incomplete share set (container)", test_demux_container_incomplete)
+		.run("Demux a corrupt share container", test_demux_container_corrupt)
+		.run("Mux & demux (recursive, container)", test_mux_demux_recursive)
+		.run("Verify integrity indices", test_verify_index)
+		.run("Verify against the original", test_verify_original)
+		.run("Reshare", test_reshare<false>)
+		.run("Reshare (container)", test_reshare<true>)
+		.run("Split a share", test_split_share<false>)
+		.run("Split a share (container)", test_split_share<true>)
+		.run("Split sibling shares (container)", test_split_siblings)
+		.run("Collapse shares", test_collapse)
+		.run("Threshold share set", test_threshold)
+		.run("Threshold share set with a truncated share", test_threshold_truncated)
+		.run("Mux & demux (--compress)", test_compress<false>)
+		.run("Mux & demux (--compress, container)", test_compress<true>)
+		.run("Pad reservoir", test_reservoir)
+		.run("Generate pads", test_generate)
+		.run("File descriptor paths", test_fd_paths)
+		.run("File descriptor read error", test_fd_read_error)
+		.run("Checked outputs", test_checked_outputs)
+		.run("Resume from a checkpoint", test_resume)
+		.run("Checkpoint journal", test_checkpoint_journal)
+		.run("Mux --append", test_append)
+		.run("Mux --delta", test_delta)
+		.run("Mux & demux through \"xor serve\"", test_serve)
+		.run("Mux & demux (--durability=end)", test_durability<xorinator::cli::Durability::eEnd>)
+		.run("Mux & demux (--durability=periodic)", test_durability<xorinator::cli::Durability::ePeriodic>);
 	return batch.failures() == 0? EXIT_SUCCESS : EXIT_FAILURE;
 }
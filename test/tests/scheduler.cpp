@@ -0,0 +1,152 @@
+/* Copyright (c) 2021 Parola Marco
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE. */
+
+#include <test_tools.hpp>
+
+#include <cli-tool/scheduler.hpp>
+
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+
+
+namespace {
+
+	constexpr auto eFailure = utest::ResultType::eFailure;
+	constexpr auto eSuccess = utest::ResultType::eSuccess;
+
+	using xorinator::runtime::WorkStealingPool;
+
+
+	/** Records the order in which tasks run. */
+	struct RunLog {
+		std::mutex mtx;
+		std::vector<unsigned> order;
+
+		void add(unsigned task) {
+			auto lock = std::lock_guard(mtx);
+			order.push_back(task);
+		}
+
+		size_t size() {
+			auto lock = std::lock_guard(mtx);
+			return order.size();
+		}
+	};
+
+
+	/** Expect a single worker to run its tasks in the order they were
+	 * pushed, including the ones pushed while it was busy. */
+	utest::ResultType test_owner_order(std::ostream& os) {
+		auto log = RunLog();
+		std::atomic_bool release = false;
+		{
+			auto pool = WorkStealingPool(1);
+			pool.push([&]() {
+				while(! release) std::this_thread::yield();
+				log.add(0);
+			});
+			for(unsigned i=1; i < 10; ++i) {
+				pool.push([&log, i]() { log.add(i); }); }
+			release = true;
+		}
+		for(unsigned i=0; i < log.order.size(); ++i) {
+			if(log.order[i] != i) {
+				os << "Task " << log.order[i] << " ran in position " << i << std::endl;
+				return eFailure;
+			}
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect a worker that runs out of tasks to steal the last ones
+	 * pushed to another worker first. Two tasks block both workers while
+	 * the others are pushed, round-robin; then one of them is released. */
+	utest::ResultType test_steal_order(std::ostream& os) {
+		auto log = RunLog();
+		std::atomic_bool releaseFirst = false;
+		std::atomic_bool releaseSecond = false;
+		std::atomic_uint started = 0;
+		{
+			auto pool = WorkStealingPool(2);
+			pool.push([&]() { ++ started; while(! releaseFirst) std::this_thread::yield(); });
+			pool.push([&]() { ++ started; while(! releaseSecond) std::this_thread::yield(); });
+			while(started < 2) std::this_thread::yield();
+			for(unsigned i=2; i < 8; ++i) {
+				pool.push([&log, i]() { log.add(i); }); }
+			releaseFirst = true;
+			while(log.size() < 6) std::this_thread::yield();
+			releaseSecond = true;
+		}
+		// Either worker may have been released: it runs its own tasks, then the other's from the back
+		const auto ownEven = std::vector<unsigned> { 2, 4, 6, 7, 5, 3 };
+		const auto ownOdd = std::vector<unsigned> { 3, 5, 7, 6, 4, 2 };
+		if((log.order != ownEven) && (log.order != ownOdd)) {
+			os << "Unexpected order:";
+			for(unsigned task : log.order) os << ' ' << task;
+			os << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+
+	/** Expect an exception thrown by a task to be rethrown by `wait`,
+	 * once, without stopping the other tasks or the workers. */
+	utest::ResultType test_task_exception(std::ostream& os) {
+		std::atomic_uint done = 0;
+		auto pool = WorkStealingPool(2);
+		pool.push([]() { throw 42; });
+		for(unsigned i=0; i < 8; ++i) {
+			pool.push([&]() { ++ done; }); }
+		try {
+			pool.wait();
+			os << "The exception of a task was lost" << std::endl;
+			return eFailure;
+		} catch(int) { }
+		if(done != 8) {
+			os << "Only " << done << " of 8 tasks ran" << std::endl;
+			return eFailure;
+		}
+		pool.push([&]() { ++ done; });
+		pool.wait();
+		if(done != 9) {
+			os << "The pool stopped running tasks after an exception" << std::endl;
+			return eFailure;
+		}
+		return eSuccess;
+	}
+
+}
+
+
+
+int main(int, char**) {
+	auto batch = utest::TestBatch(std::cout);
+	batch
+		.run("Work stealing pool (owner order)", test_owner_order)
+		.run("Work stealing pool (steal order)", test_steal_order)
+		.run("Work stealing pool (task exception)", test_task_exception);
+	return batch.failures() == 0? EXIT_SUCCESS : EXIT_FAILURE;
+}